@@ -0,0 +1,535 @@
+
+/*
+ * @file lzt_bench.cxx
+ * @brief Microbenchmarks for the reconstruction hot paths. The inputs are synthetic
+ *        (fixed seed) but all cells are built from the real detector grids
+ *        ($LZT_PATH/geometry/DetectorATLASModel/data/detector_sampling_*.dat), so
+ *        the collection sizes and lookups are the same used by the simulation.
+ *        Each benchmark reports items/s where the item is the natural unit of the
+ *        kernel (step, cell, cluster or seed).
+ *
+ *        usage: lzt_bench [--benchmark_filter=<regex>] [--benchmark_format=json]
+ */
+
+#include "CaloCell/CaloCellContainer.h"
+#include "CaloCell/RawCell.h"
+#include "CaloCluster/CaloCluster.h"
+#include "CaloRings/CaloRings.h"
+#include "EventInfo/EventInfoContainer.h"
+#include "GaugiKernel/DataHandle.h"
+#include "GaugiKernel/StoreGate.h"
+#include "G4Kernel/CaloPhiRange.h"
+#include "G4Kernel/constants.h"
+#include "CaloCellCollection.h"
+#include "PulseGenerator.h"
+#include "OptimalFilter.h"
+#include "CaloCellMerge.h"
+#include "CaloClusterMaker.h"
+#include "ShowerShapes.h"
+#include "CaloNtupleMaker.h"
+#include "CaloRingerBuilder.h"
+#include "G4Step.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4SystemOfUnits.hh"
+#include "TVector3.h"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <stdexcept>
+
+using namespace CaloSampling;
+
+
+namespace{
+
+  /*! The same seed for all benchmarks to keep the inputs reproducible */
+  const unsigned bench_seed = 17;
+  /*! Keep the benchmark output clean */
+  const int bench_output_level = MSG::WARNING;
+
+  /*! Bunch crossing and pulse configuration for each technology (see CaloCellBuilder.py) */
+  struct bunch_t{
+    int nsamples;
+    int bcid_start;
+    int bcid_end;
+    float duration;
+    std::string shaper;
+    std::vector<float> ofweights;
+  };
+
+  const bunch_t lar_bunch  = { 5, -24, 5, 25, "pulseLar.dat" , {-0.0000853580,0.265132,0.594162,0.389505,0.124353} };
+  const bunch_t tile_bunch = { 7, -8 , 7, 25, "pulseTile.dat", {-0.3781, -0.3572, 0.1808, 0.8125, 0.2767, -0.2056, -0.3292} };
+
+  const bunch_t& bunch( int sampling ){ return sampling < HAD1 ? lar_bunch : tile_bunch; }
+
+  /*! Only the samplings with a grid file in the ATLAS model */
+  const std::vector<int> samplings = {EM2, EM3, HAD1, HAD2, HAD3};
+
+
+  /*! One cell line (C) from the grid file */
+  struct cell_t{ int sampling; float eta, phi, deta, dphi, rmin, rmax; std::string hash; };
+
+  /*! The layer line (L) and all cells from the grid file */
+  struct grid_t{
+    int sampling;
+    float etamin, etamax, etabins, phimin, phimax, phibins, rmin, rmax;
+    std::vector<cell_t> cells;
+  };
+
+
+  std::string datapath( std::string file )
+  {
+    const char *lzt_path = std::getenv("LZT_PATH");
+    return std::string( lzt_path ? lzt_path : "." ) + "/geometry/DetectorATLASModel/data/" + file;
+  }
+
+
+  /*! Read the grid file only once for each sampling */
+  const grid_t& grid( int sampling )
+  {
+    static std::map<int, grid_t> grids;
+    auto it = grids.find( sampling );
+    if ( it != grids.end() ) return it->second;
+
+    std::string path = datapath( "detector_sampling_" + std::to_string(sampling) + ".dat" );
+    std::ifstream file( path );
+    if ( !file.is_open() )
+      throw std::runtime_error( "It's not possible to open " + path + ". Please, check the LZT_PATH." );
+
+    grid_t g;
+    std::string line;
+    while ( std::getline(file, line) ){
+      std::istringstream ss(line);
+      std::string command;
+      ss >> command;
+      if ( command == "L" ){
+        ss >> g.sampling >> g.etamin >> g.etamax >> g.etabins >> g.phimin >> g.phimax >> g.phibins >> g.rmin >> g.rmax;
+      }else if ( command == "C" ){
+        cell_t c;
+        ss >> c.sampling >> c.eta >> c.phi >> c.deta >> c.dphi >> c.rmin >> c.rmax >> c.hash;
+        g.cells.push_back(c);
+      }
+    }
+    return grids.emplace( sampling, g ).first->second;
+  }
+
+
+  xAOD::RawCell* raw_cell( const cell_t &c )
+  {
+    const auto &b = bunch( c.sampling );
+    return new xAOD::RawCell( c.eta, c.phi, c.deta, c.dphi, c.rmin, c.rmax, c.hash, (CaloSample)c.sampling,
+                              b.duration, b.nsamples, b.bcid_start, b.bcid_end, special_bcid_for_truth_reconstruction );
+  }
+
+
+  /*! Build the collection for one sampling in the same way of CaloCellMaker::pre_execute */
+  xAOD::CaloCellCollection* collection( int sampling )
+  {
+    const auto &g = grid( sampling );
+    auto *col = new xAOD::CaloCellCollection( g.etamin, g.etamax, g.etabins, g.phimin, g.phimax, g.phibins,
+                                              g.rmin, g.rmax, (CaloSample)g.sampling );
+    for ( const auto &c : g.cells ) col->push_back( raw_cell(c) );
+    return col;
+  }
+
+
+  std::string collection_key( int sampling ){ return "Collection_" + std::to_string(sampling); }
+
+
+  /*! Random step positions inside of the cells of one sampling */
+  std::vector<TVector3> positions( int sampling, unsigned n, std::mt19937 &gen )
+  {
+    const auto &g = grid( sampling );
+    std::uniform_int_distribution<size_t> pick( 0, g.cells.size()-1 );
+    std::uniform_real_distribution<float> flat( -0.5, 0.5 );
+    std::vector<TVector3> vec(n);
+    for ( auto &pos : vec ){
+      const auto &c = g.cells[ pick(gen) ];
+      float radius = c.rmin + (c.rmax-c.rmin) * (flat(gen)+0.5);
+      pos.SetPtEtaPhi( radius, c.eta + c.deta*flat(gen), c.phi + c.dphi*flat(gen) );
+    }
+    return vec;
+  }
+
+
+  /*! Random steps (position, time and energy) inside of the bunch crossing window of one sampling */
+  std::vector<std::unique_ptr<G4Step>> steps( int sampling, unsigned n, std::mt19937 &gen )
+  {
+    const auto &b = bunch( sampling );
+    std::uniform_real_distribution<float> time( b.bcid_start*b.duration, (b.bcid_end+1)*b.duration );
+    std::exponential_distribution<float> edep( 1./MeV );
+    auto pos = positions( sampling, n, gen );
+    std::vector<std::unique_ptr<G4Step>> vec;
+    for ( unsigned i=0; i<n; ++i ){
+      auto *step = new G4Step();
+      step->SetTotalEnergyDeposit( edep(gen) );
+      step->GetPreStepPoint()->SetPosition( G4ThreeVector( pos[i].X(), pos[i].Y(), pos[i].Z() ) );
+      // RawCell converts the global time using t*mm/c_light
+      step->GetPreStepPoint()->SetGlobalTime( time(gen) * c_light/mm );
+      vec.push_back( std::unique_ptr<G4Step>(step) );
+    }
+    return vec;
+  }
+
+
+  /*! Random raw cells with a fraction of bunch crossings with energy (0-100%) */
+  std::vector<std::unique_ptr<xAOD::RawCell>> raw_cells( int sampling, unsigned n, int occupancy, std::mt19937 &gen )
+  {
+    const auto &g = grid( sampling );
+    const auto &b = bunch( sampling );
+    std::uniform_int_distribution<size_t> pick( 0, g.cells.size()-1 );
+    std::uniform_int_distribution<int> percent( 0, 99 );
+    std::exponential_distribution<float> energy( 1./(100*MeV) );
+    std::vector<std::unique_ptr<xAOD::RawCell>> vec;
+    for ( unsigned i=0; i<n; ++i ){
+      auto *cell = raw_cell( g.cells[ pick(gen) ] );
+      auto samples = cell->rawEnergySamples();
+      for ( auto &e : samples ) e = percent(gen) < occupancy ? energy(gen) : 0;
+      cell->setRawEnergySamples( samples );
+      std::vector<float> pulse( b.nsamples );
+      for ( auto &p : pulse ) p = energy(gen);
+      cell->setPulse( pulse );
+      vec.push_back( std::unique_ptr<xAOD::RawCell>(cell) );
+    }
+    return vec;
+  }
+
+
+  /*! Record the event info and all collections with one electromagnetic shower per seed */
+  void record_event( SG::EventContext &ctx, unsigned nseeds, std::mt19937 &gen )
+  {
+    std::uniform_real_distribution<float> eta( -0.8, 0.8 );
+    std::uniform_real_distribution<float> phi( -pi, pi );
+    std::normal_distribution<float> noise( 0, 50*MeV );
+
+    std::vector<xAOD::seed_t> seeds;
+    for ( unsigned i=0; i<nseeds; ++i )
+      seeds.push_back( xAOD::seed_t{ 50*GeV, eta(gen), phi(gen), 0, 0, 0, 11 } );
+
+    {
+      SG::WriteHandle<xAOD::EventInfoContainer> event( "EventInfo", ctx );
+      event.record( std::unique_ptr<xAOD::EventInfoContainer>( new xAOD::EventInfoContainer() ) );
+      auto *evt = new xAOD::EventInfo();
+      evt->setEventNumber( 0 );
+      evt->setAvgmu( 0 );
+      for ( auto &seed : seeds ) evt->push_back( seed );
+      event->push_back( evt );
+    }
+
+    // Fraction of the seed energy and the shower width for each sampling
+    std::map<int, std::pair<float,float>> shower = { {EM2 ,{0.60,0.025}}, {EM3 ,{0.10,0.050}},
+                                                     {HAD1,{0.02,0.100}}, {HAD2,{0.01,0.100}}, {HAD3,{0.01,0.100}} };
+    for ( int sampling : samplings ){
+      SG::WriteHandle<xAOD::CaloCellCollection> col( collection_key(sampling), ctx );
+      col.record( std::unique_ptr<xAOD::CaloCellCollection>( collection(sampling) ) );
+      for ( const auto &it : **col ){
+        auto *cell = it.second;
+        float truth = 0;
+        for ( auto &seed : seeds ){
+          float deta = seed.eta - cell->eta();
+          float dphi = CaloPhiRange::diff( seed.phi, cell->phi() );
+          float dr = std::sqrt( deta*deta + dphi*dphi );
+          truth += seed.et * std::cosh(seed.eta) * shower[sampling].first * std::exp( -dr/shower[sampling].second );
+        }
+        cell->setTruthRawEnergy( truth );
+        cell->setEnergy( truth + noise(gen) );
+      }
+    }
+  }
+
+
+  template<class T> void configure( T &alg )
+  {
+    alg.setProperty( "OutputLevel", bench_output_level );
+    alg.initialize();
+  }
+
+
+  std::vector<std::string> collection_keys()
+  {
+    std::vector<std::string> keys;
+    for ( int sampling : samplings ) keys.push_back( collection_key(sampling) );
+    return keys;
+  }
+
+
+  size_t total_cells()
+  {
+    size_t n=0;
+    for ( int sampling : samplings ) n+=grid(sampling).cells.size();
+    return n;
+  }
+
+}
+
+
+
+/*
+ * Step -> cell lookup for each sampling. Item: one step
+ */
+static void BM_CaloCellCollection_retrieve( benchmark::State &state )
+{
+  std::mt19937 gen( bench_seed );
+  std::unique_ptr<xAOD::CaloCellCollection> col( collection( state.range(0) ) );
+  auto pos = positions( state.range(0), 4096, gen );
+  xAOD::RawCell *cell = nullptr;
+  size_t i=0;
+  for ( auto _ : state ){
+    benchmark::DoNotOptimize( col->retrieve( pos[ i++ % pos.size() ], cell ) );
+    benchmark::DoNotOptimize( cell );
+  }
+  state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(BM_CaloCellCollection_retrieve)->Arg(EM2)->Arg(EM3)->Arg(HAD1)->Arg(HAD2)->Arg(HAD3);
+
+
+
+/*
+ * Energy deposit into the bunch crossing samples. Item: one step
+ */
+static void BM_RawCell_Fill( benchmark::State &state )
+{
+  std::mt19937 gen( bench_seed );
+  int sampling = state.range(0);
+  std::unique_ptr<xAOD::RawCell> cell( raw_cell( grid(sampling).cells.front() ) );
+  auto vec = steps( sampling, 4096, gen );
+  size_t i=0;
+  for ( auto _ : state ){
+    cell->Fill( vec[ i++ % vec.size() ].get() );
+  }
+  benchmark::DoNotOptimize( cell->rawEnergy() );
+  state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(BM_RawCell_Fill)->Arg(EM2)->Arg(HAD1);
+
+
+
+/*
+ * Pulse sum over all bunch crossings. Args: sampling and bunch occupancy (%). Item: one cell
+ */
+static void BM_PulseGenerator_executeTool( benchmark::State &state )
+{
+  std::mt19937 gen( bench_seed );
+  int sampling = state.range(0);
+  PulseGenerator tool( "PulseGenerator" );
+  tool.setProperty( "NSamples"  , bunch(sampling).nsamples );
+  tool.setProperty( "ShaperFile", datapath( bunch(sampling).shaper ) );
+  tool.setProperty( "BunchIdStart" , bunch(sampling).bcid_start );
+  tool.setProperty( "BunchIdEnd"   , bunch(sampling).bcid_end );
+  tool.setProperty( "BunchDuration", bunch(sampling).duration );
+  configure( tool );
+  auto cells = raw_cells( sampling, 1024, state.range(1), gen );
+  for ( auto _ : state ){
+    for ( auto &cell : cells ) tool.executeTool( nullptr, cell.get() );
+  }
+  state.SetItemsProcessed( state.iterations() * cells.size() );
+}
+BENCHMARK(BM_PulseGenerator_executeTool)->Args({EM2,10})->Args({EM2,100})->Args({HAD1,10})->Args({HAD1,100});
+
+
+
+/*
+ * Energy estimation from the pulse. Item: one cell
+ */
+static void BM_OptimalFilter_executeTool( benchmark::State &state )
+{
+  std::mt19937 gen( bench_seed );
+  int sampling = state.range(0);
+  OptimalFilter tool( "OptimalFilter" );
+  tool.setProperty( "Weights", bunch(sampling).ofweights );
+  configure( tool );
+  auto cells = raw_cells( sampling, 1024, 0, gen );
+  for ( auto _ : state ){
+    for ( auto &cell : cells ) tool.executeTool( nullptr, cell.get() );
+  }
+  state.SetItemsProcessed( state.iterations() * cells.size() );
+}
+BENCHMARK(BM_OptimalFilter_executeTool)->Arg(EM2)->Arg(HAD1);
+
+
+
+/*
+ * Raw cells from all collections into the reco and truth containers. Item: one raw cell
+ */
+static void BM_CaloCellMerge( benchmark::State &state )
+{
+  std::mt19937 gen( bench_seed );
+  CaloCellMerge merge( "CaloCellMerge" );
+  merge.setProperty( "CollectionKeys", collection_keys() );
+  configure( merge );
+  SG::EventContext ctx( "EventContext" );
+  ctx.setMsgLevel( MSG::WARNING );
+  for ( auto _ : state ){
+    state.PauseTiming();
+    ctx.clear();
+    record_event( ctx, 1, gen );
+    state.ResumeTiming();
+    merge.post_execute( ctx );
+  }
+  state.SetItemsProcessed( state.iterations() * total_cells() );
+}
+BENCHMARK(BM_CaloCellMerge)->Unit(benchmark::kMillisecond);
+
+
+
+/*
+ * Hottest cell, 0.1x0.1 center and cluster window searches (with shower shapes).
+ * Arg: number of seeds. Item: one seed
+ */
+static void BM_CaloClusterMaker( benchmark::State &state )
+{
+  std::mt19937 gen( bench_seed );
+  CaloCellMerge merge( "CaloCellMerge" );
+  merge.setProperty( "CollectionKeys", collection_keys() );
+  configure( merge );
+  CaloClusterMaker cluster( "CaloClusterMaker" );
+  configure( cluster );
+  SG::EventContext ctx( "EventContext" );
+  ctx.setMsgLevel( MSG::WARNING );
+  for ( auto _ : state ){
+    state.PauseTiming();
+    ctx.clear();
+    record_event( ctx, state.range(0), gen );
+    merge.post_execute( ctx );
+    state.ResumeTiming();
+    cluster.post_execute( ctx );
+  }
+  state.SetItemsProcessed( state.iterations() * state.range(0) );
+}
+BENCHMARK(BM_CaloClusterMaker)->Arg(1)->Arg(4)->Arg(16)->Unit(benchmark::kMillisecond);
+
+
+
+/*
+ * Shower shapes on top of 0.4x0.4 clusters. Item: one cluster
+ */
+static void BM_ShowerShapes( benchmark::State &state )
+{
+  std::mt19937 gen( bench_seed );
+  CaloCellMerge merge( "CaloCellMerge" );
+  merge.setProperty( "CollectionKeys", collection_keys() );
+  configure( merge );
+  ShowerShapes tool( "ShowerShapes" );
+  tool.setMsgLevel( MSG::WARNING );
+  tool.initialize();
+  SG::EventContext ctx( "EventContext" );
+  ctx.setMsgLevel( MSG::WARNING );
+  record_event( ctx, 16, gen );
+  merge.post_execute( ctx );
+
+  SG::ReadHandle<xAOD::EventInfoContainer> event( "EventInfo", ctx );
+  SG::ReadHandle<xAOD::CaloCellContainer> container( "Cells", ctx );
+  const auto *evt = (**event.ptr()).front();
+  std::vector<std::unique_ptr<xAOD::CaloCluster>> clusters;
+  for ( auto &seed : evt->allSeeds() ){
+    auto *clus = new xAOD::CaloCluster( 0, seed.eta, seed.phi, 0.2, 0.2 );
+    for ( const auto cell : **container.ptr() ){
+      if ( std::abs( seed.eta - cell->eta() ) < 0.2 && std::abs( CaloPhiRange::diff( seed.phi, cell->phi() ) ) < 0.2 )
+        clus->push_back( cell );
+    }
+    clusters.push_back( std::unique_ptr<xAOD::CaloCluster>(clus) );
+  }
+
+  for ( auto _ : state ){
+    for ( auto &clus : clusters ) tool.executeTool( evt, clus.get() );
+  }
+  state.SetItemsProcessed( state.iterations() * clusters.size() );
+}
+BENCHMARK(BM_ShowerShapes);
+
+
+
+/*
+ * Ring energy accumulation over all cells. Args: sampling, number of rings. Item: one cell
+ */
+static void BM_RingSet_add( benchmark::State &state )
+{
+  std::mt19937 gen( bench_seed );
+  CaloCellMerge merge( "CaloCellMerge" );
+  merge.setProperty( "CollectionKeys", collection_keys() );
+  configure( merge );
+  SG::EventContext ctx( "EventContext" );
+  ctx.setMsgLevel( MSG::WARNING );
+  record_event( ctx, 1, gen );
+  merge.post_execute( ctx );
+
+  SG::ReadHandle<xAOD::EventInfoContainer> event( "EventInfo", ctx );
+  SG::ReadHandle<xAOD::CaloCellContainer> container( "Cells", ctx );
+  auto seed = (**event.ptr()).front()->allSeeds().front();
+  const auto &g = grid( state.range(0) );
+  xAOD::RingSet rs( (CaloSample)state.range(0), state.range(1), (g.etamax-g.etamin)/g.etabins, (g.phimax-g.phimin)/g.phibins );
+
+  for ( auto _ : state ){
+    rs.clear();
+    for ( const auto cell : **container.ptr() ) rs.add( cell, seed.eta, seed.phi );
+    benchmark::DoNotOptimize( rs.pattern().data() );
+  }
+  state.SetItemsProcessed( state.iterations() * container->size() );
+}
+BENCHMARK(BM_RingSet_add)->Args({EM2,8})->Args({HAD1,4});
+
+
+
+/*
+ * Cluster and rings matching plus the tree filling for each seed (DumpCells on).
+ * Arg: number of seeds. Item: one seed
+ */
+static void BM_CaloNtupleMaker_Fill( benchmark::State &state )
+{
+  std::mt19937 gen( bench_seed );
+
+  CaloCellMerge merge( "CaloCellMerge" );
+  merge.setProperty( "CollectionKeys", collection_keys() );
+  configure( merge );
+
+  std::vector<std::unique_ptr<Gaugi::Algorithm>> algs;
+  for ( std::string prefix : {"", "Truth"} ){
+    auto *cluster = new CaloClusterMaker( prefix + "CaloClusterMaker" );
+    cluster->setProperty( "CellsKey"  , prefix + "Cells"    );
+    cluster->setProperty( "ClusterKey", prefix + "Clusters" );
+    cluster->setProperty( "TruthKey"  , prefix + "Particles");
+    configure( *cluster );
+    algs.push_back( std::unique_ptr<Gaugi::Algorithm>(cluster) );
+
+    auto *ringer = new CaloRingerBuilder( prefix + "CaloRingerBuilder" );
+    ringer->setProperty( "RingerKey"    , prefix + "Rings"    );
+    ringer->setProperty( "ClusterKey"   , prefix + "Clusters" );
+    ringer->setProperty( "DeltaEtaRings", std::vector<float>{0.00325, 0.025, 0.050, 0.1, 0.1, 0.2} );
+    ringer->setProperty( "DeltaPhiRings", std::vector<float>{pi/32, pi/128, pi/128, pi/128, pi/32, pi/32, pi/32} );
+    ringer->setProperty( "NRings"       , std::vector<int>{64, 8, 8, 4, 4, 4} );
+    ringer->setProperty( "LayerRings"   , std::vector<int>{1, 2, 3, 4, 5, 6} );
+    configure( *ringer );
+    algs.push_back( std::unique_ptr<Gaugi::Algorithm>(ringer) );
+  }
+
+  CaloNtupleMaker ntuple( "CaloNtupleMaker" );
+  ntuple.setProperty( "RingerKey"       , std::string("Rings")         );
+  ntuple.setProperty( "TruthRingerKey"  , std::string("TruthRings")    );
+  ntuple.setProperty( "ClusterKey"      , std::string("Clusters")      );
+  ntuple.setProperty( "TruthClusterKey" , std::string("TruthClusters") );
+  ntuple.setProperty( "DumpCells"       , true                         );
+  configure( ntuple );
+
+  SG::StoreGate store( "lzt_bench_ntuple" );
+  store.setMsgLevel( MSG::WARNING );
+  ntuple.bookHistograms( store );
+
+  SG::EventContext ctx( "EventContext" );
+  ctx.setMsgLevel( MSG::WARNING );
+  record_event( ctx, state.range(0), gen );
+  merge.post_execute( ctx );
+  for ( auto &alg : algs ) alg->post_execute( ctx );
+
+  for ( auto _ : state ){
+    ntuple.fillHistograms( ctx, store );
+  }
+  state.SetItemsProcessed( state.iterations() * state.range(0) );
+}
+BENCHMARK(BM_CaloNtupleMaker_Fill)->Arg(1)->Arg(4);
+
+
+
+BENCHMARK_MAIN();
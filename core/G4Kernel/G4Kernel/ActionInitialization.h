@@ -4,13 +4,14 @@
 #include "GaugiKernel/MsgStream.h"
 #include "GaugiKernel/Algorithm.h"
 #include "G4Kernel/PrimaryGenerator.h"
+#include "G4Kernel/RunConfig.h"
 #include "G4VUserActionInitialization.hh"
 
 
 class ActionInitialization : public G4VUserActionInitialization, public MsgService
 {
   public:
-    ActionInitialization( PrimaryGenerator *gen, std::vector<Gaugi::Algorithm*> acc, std::string output );
+    ActionInitialization( PrimaryGenerator *gen, std::vector<Gaugi::Algorithm*> acc, const RunConfig &config );
     virtual ~ActionInitialization();
 
     virtual void BuildForMaster() const;
@@ -21,7 +22,7 @@ class ActionInitialization : public G4VUserActionInitialization, public MsgServi
 
     std::vector<Gaugi::Algorithm*> m_acc;
     PrimaryGenerator *m_generator;
-    std::string m_output;
+    RunConfig m_config;
 };
 
 #endif
@@ -0,0 +1,83 @@
+#ifndef AllocAccounting_h
+#define AllocAccounting_h
+
+#include "GaugiKernel/MsgStream.h"
+#include "GaugiKernel/StoreGate.h"
+#include "GaugiKernel/AllocCounter.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+
+/*
+ * Per thread heap allocation accounting. The allocations are attributed to
+ * each algorithm phase (pre_execute, execute, post_execute, fillHistograms)
+ * and to the whole stepping callback. Only works when the library is compiled
+ * with LZT_ALLOC_COUNTING and its operator new replaces the one of the process
+ * (checked at construction, the guard can not be used otherwise).
+ */
+class AllocAccounting : public MsgService
+{
+  public:
+
+    enum Phase{
+      PRE_EXECUTE=0,
+      EXECUTE,
+      POST_EXECUTE,
+      FILL_HISTOGRAMS,
+      NUMBER_OF_PHASES
+    };
+
+    /** Constructor. guard is the max number of allocations per step allowed for each algorithm **/
+    AllocAccounting( std::vector<std::string> algs, float guard );
+
+    /** Destructor **/
+    ~AllocAccounting()=default;
+
+    /** Take the counter snapshot before the algorithm call **/
+    void start(){ m_start = Gaugi::AllocCounter::snapshot(); };
+
+    /** Attribute the allocations since start to the algorithm phase **/
+    void stop( unsigned alg, Phase phase );
+
+    /** Take the counter snapshot before the stepping callback **/
+    void BeginOfStep(){ m_step = Gaugi::AllocCounter::snapshot(); };
+
+    /** Attribute the allocations since BeginOfStep to the stepping callback **/
+    void EndOfStep();
+
+    /** Count one more event **/
+    void EndOfEvent(){ m_nevents++; };
+
+    /** Write the summary tree into the store gate and apply the step guard **/
+    void write( SG::StoreGate &store );
+
+    /** Number of algorithms above the step guard in all threads. The RunManager fails the run if not zero **/
+    static unsigned violations(){ return s_violations; };
+
+
+  private:
+
+    void add( Gaugi::alloc_t &, const Gaugi::alloc_t &begin );
+
+    /*! True if the allocations of this library and of libstdc++ are counted */
+    static bool counting();
+
+    std::vector<std::string> m_algs;
+    // One counter per algorithm and phase
+    std::vector< std::vector<Gaugi::alloc_t> > m_counters;
+    // Total allocations inside of the stepping callback
+    Gaugi::alloc_t m_stepping;
+
+    Gaugi::alloc_t m_start;
+    Gaugi::alloc_t m_step;
+
+    unsigned long long m_nsteps;
+    unsigned long long m_nevents;
+    float m_guard;
+    bool m_counting;
+
+    static std::atomic<unsigned> s_violations;
+};
+
+#endif
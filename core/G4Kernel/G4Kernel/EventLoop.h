@@ -5,9 +5,17 @@
 #include "GaugiKernel/MsgStream.h"
 #include "GaugiKernel/Algorithm.h"
 #include "GaugiKernel/StoreGate.h"
+#include "GaugiKernel/MetricsExporter.h"
+#include "G4Kernel/StepAccounting.h"
+#include "G4Kernel/MemoryAccounting.h"
+#include "G4Kernel/AllocAccounting.h"
+#include "G4Kernel/StepRecorder.h"
+#include "G4Kernel/ShowerLibraryBuilder.h"
+#include "G4Kernel/RunConfig.h"
 #include "G4Run.hh"
 #include "globals.hh"
 #include "G4Step.hh"
+#include <set>
 #include <string>
 #include <vector>
 
@@ -16,8 +24,8 @@ class EventLoop : public G4Run, public MsgService
 {
   public:
 
-    /** Constructor **/
-    EventLoop( std::vector<Gaugi::Algorithm*>, std::string output );
+    /** Constructor. Create the optional accounting, recorders and builders of the config **/
+    EventLoop( std::vector<Gaugi::Algorithm*>, const RunConfig &config );
     
     /** Destructor **/
     virtual ~EventLoop();
@@ -30,6 +38,12 @@ class EventLoop : public G4Run, public MsgService
     void ExecuteEvent(const G4Step *step);
     /** Pos execution used in event action step **/
     void EndOfEvent();
+    /** Track bookkeeping used in tracking action **/
+    void PreTracking(const G4Track *track);
+    /** Set the current geant event. False if it was done by the checkpointed run (skipped) **/
+    bool prepare( int evt );
+    /** True if the current event is skipped **/
+    bool skipped() const { return m_skip; };
 
 
     SG::EventContext& getContext();
@@ -37,6 +51,9 @@ class EventLoop : public G4Run, public MsgService
 
   private:
 
+    /*! Record the completed events and the tree entries, then flush the thread file */
+    void checkpoint();
+
     // Store gate
     SG::StoreGate m_store;
 
@@ -45,6 +62,33 @@ class EventLoop : public G4Run, public MsgService
     
     // list of alg tools to be executed in loop
     std::vector < Gaugi::Algorithm* > m_toolHandles;
+
+    // step and track accounting (optional)
+    StepAccounting *m_stepAccounting;
+
+    // memory accounting (optional)
+    MemoryAccounting *m_memoryAccounting;
+
+    // heap allocation accounting (optional)
+    AllocAccounting *m_allocAccounting;
+
+    // step record for the replay (optional)
+    StepRecorder *m_stepRecorder;
+
+    // frozen shower library builder (optional)
+    ShowerLibraryBuilder *m_showerLibrary;
+
+    // progress counters read by the metrics exporter (optional)
+    Gaugi::metric_counter_t *m_metrics;
+
+    // checkpoint (optional). Current event, events done by the checkpointed run and by this thread
+    // since the last checkpoint
+    int m_checkpointInterval;
+    std::string m_checkpointFile;
+    int m_event;
+    bool m_skip;
+    std::set<int> m_completed;
+    std::vector<int> m_done;
 };
 
   
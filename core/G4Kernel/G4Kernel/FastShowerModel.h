@@ -0,0 +1,43 @@
+#ifndef FastShowerModel_h
+#define FastShowerModel_h
+
+#include "GaugiKernel/MsgStream.h"
+#include "G4VFastSimulationModel.hh"
+#include "G4Region.hh"
+#include "G4Step.hh"
+#include <string>
+
+
+/*
+ * Base of the EM fast simulation models (e+/e-/gamma). The derived models kill the
+ * particle and create energy spots that go through the EventLoop as ordinary steps,
+ * so the CaloCellMaker (and the step accounting/recorder) can not tell them apart
+ * from the full simulation.
+ */
+class FastShowerModel : public G4VFastSimulationModel, public MsgService
+{
+  public:
+
+    FastShowerModel( std::string name, G4Region *envelope );
+
+    virtual ~FastShowerModel();
+
+    virtual G4bool IsApplicable( const G4ParticleDefinition & ) override;
+
+
+  protected:
+
+    /*! Send one spot to the algorithms as a step */
+    void deposit( const G4Track *track, const G4ThreeVector &pos, double time, double edep );
+
+    /*! Kill the primary. The energy was already given to the algorithms by the spots */
+    void kill( G4FastStep &fastStep ) const;
+
+
+  private:
+
+    // Reused for all spots (the models are created per worker thread)
+    G4Step m_step;
+};
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef FrozenShowerModel_h
+#define FrozenShowerModel_h
+
+#include "G4Kernel/FastShowerModel.h"
+#include "G4Kernel/ShowerLibrary.h"
+#include <memory>
+#include <string>
+
+
+/*
+ * Replay of frozen showers. Each e+/e-/gamma with a shower in the library for the
+ * envelope (region), particle and energy bin is killed and replaced by a random shower
+ * of that bin, rotated to the particle direction (with a random angle around it) and
+ * scaled to the particle energy.
+ */
+class FrozenShowerModel : public FastShowerModel
+{
+  public:
+
+    FrozenShowerModel( std::string name, G4Region *envelope, std::shared_ptr<const ShowerLibrary> library );
+
+    virtual ~FrozenShowerModel();
+
+    virtual G4bool ModelTrigger( const G4FastTrack & ) override;
+
+    virtual void DoIt( const G4FastTrack &, G4FastStep & ) override;
+
+
+  private:
+
+    std::shared_ptr<const ShowerLibrary> m_library;
+
+    std::string m_region;
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef MemoryAccounting_h
+#define MemoryAccounting_h
+
+#include "GaugiKernel/MsgStream.h"
+#include "GaugiKernel/StoreGate.h"
+#include "GaugiKernel/DataHandle.h"
+#include "GaugiKernel/Algorithm.h"
+#include <string>
+#include <vector>
+#include <map>
+
+
+/*
+ * Per thread memory accounting. The approximated footprint of each event
+ * context key and each algorithm is sampled at the end of every event
+ * (before the context is cleared) and the process RSS is sampled at the
+ * event boundaries. The summary is dumped into the output file at the end
+ * of the run.
+ */
+class MemoryAccounting : public MsgService
+{
+  public:
+
+    /** Constructor **/
+    MemoryAccounting();
+
+    /** Destructor **/
+    ~MemoryAccounting()=default;
+
+    /** Sample the RSS before the event starts **/
+    void BeginOfEvent();
+
+    /** Sample all keys, algorithms and the RSS before the context is cleared **/
+    void EndOfEvent( const SG::EventContext &ctx, const std::vector<Gaugi::Algorithm*> &algs );
+
+    /** Write the summary trees into the store gate **/
+    void write( SG::StoreGate &store );
+
+
+  private:
+
+    struct footprint_t{
+      size_t peak=0;
+      double sum=0;
+      unsigned long nevents=0;
+    };
+
+    /** Current resident set size in bytes **/
+    size_t rss() const;
+
+    void add( footprint_t &, size_t bytes );
+
+    std::map<std::string, footprint_t> m_keys;
+    std::map<std::string, footprint_t> m_algs;
+
+    // RSS (in bytes) at the begin and end of each event
+    std::vector<size_t> m_rssBegin;
+    std::vector<size_t> m_rssEnd;
+};
+
+#endif
@@ -26,5 +26,8 @@ class PrimaryGenerator : public G4VPrimaryGenerator,
 
     virtual PrimaryGenerator* copy()=0;
 
+    /** Called in place of GeneratePrimaryVertex for the events completed by a checkpointed run **/
+    virtual void skipEvent( G4Event* ) {;};
+
 };
 #endif
@@ -3,6 +3,7 @@
 
 #include "GaugiKernel/MsgStream.h"
 #include "GaugiKernel/Algorithm.h"
+#include "G4Kernel/RunConfig.h"
 
 /** geant 4 includes **/
 #include "G4UserRunAction.hh"
@@ -13,7 +14,7 @@ class G4Run;
 class RunAction : public G4UserRunAction, public MsgService
 {
   public:
-    RunAction( std::vector<Gaugi::Algorithm*>, std::string output);
+    RunAction( std::vector<Gaugi::Algorithm*>, const RunConfig &config );
     virtual ~RunAction();
     virtual G4Run* GenerateRun();
     virtual void BeginOfRunAction(const G4Run*);
@@ -23,7 +24,7 @@ class RunAction : public G4UserRunAction, public MsgService
   private:
 
     std::vector<Gaugi::Algorithm*> m_acc;
-    std::string m_output;
+    RunConfig m_config;
 };
 #endif
 
@@ -0,0 +1,52 @@
+#ifndef RunConfig_h
+#define RunConfig_h
+
+#include <string>
+#include <vector>
+
+
+/*
+ * Settings of the per thread actions (run, event loop, stacking and stepping). Filled by the
+ * RunManager properties (where the defaults are) and given as a whole to the ActionInitialization,
+ * so the threads build their own accounting, recorders and triage from the same values.
+ * Everything is disabled by default.
+ */
+struct RunConfig
+{
+  std::string output;
+  // Step and track accounting. Readout window [tmin, tmax] in ns
+  bool useStepAccounting=false;
+  std::vector<float> timeWindow;
+  bool useMemoryAccounting=false;
+  // Allocation accounting. Max allocations per step for each algorithm (-1 to disable)
+  bool useAllocAccounting=false;
+  float allocGuard=-1;
+  // Step record (one file per thread). Disabled if empty
+  std::string stepRecordFile;
+  std::string stepRecordKey;
+  // Frozen shower library builder (one file per thread). Disabled if empty. Bins in MeV
+  std::string showerLibraryFile;
+  std::vector<std::string> showerLibraryRegions;
+  std::vector<float> showerLibraryBins;
+  int showerLibraryMaxShowers=0;
+  // Track triage. Time in ns, lengths in mm and energies in MeV (zero is no cut)
+  bool useTrackTriage=false;
+  float triageMaxTime=0;
+  float triageMaxRadius=0;
+  float triageMaxZ=0;
+  bool killNeutrinos=false;
+  std::vector<int> triageParticles;
+  std::vector<float> triageMinEnergy;
+  // RoI mode (zero is disabled). Min radius in mm
+  float roiDeltaR=0;
+  float roiMinRadius=0;
+  std::string roiEventKey;
+  // Checkpoint (zero is disabled). Each N events a thread flushes its file and records its completed
+  // events into <checkpointPrefix>_<thread>.checkpoint
+  int checkpointInterval=0;
+  std::string checkpointPrefix;
+  // Events completed by the checkpointed run (resume). They are not simulated again
+  std::vector<int> completedEvents;
+};
+
+#endif
@@ -4,6 +4,7 @@
 
 #include "G4VUserDetectorConstruction.hh"
 #include "G4Kernel/PrimaryGenerator.h"
+#include "G4Kernel/RunConfig.h"
 #include "GaugiKernel/Algorithm.h"
 #include "GaugiKernel/MsgStream.h"
 #include "GaugiKernel/Property.h"
@@ -28,14 +29,60 @@ class RunManager: public MsgService,
 
     void setDetectorConstruction( G4VUserDetectorConstruction * );
 
+    /*! Files with the events of the checkpointed runs (resume). They must be merged with the thread files */
+    const std::vector<std::string>& checkpointParts() const { return m_checkpointParts; };
+
 
   private:
 
+    /*! Apply the production cuts and user limits per region and report all regions */
+    void configureRegions();
+
+    /*! Take the seed and the completed events of the checkpoint (resume) and record this run */
+    void prepareCheckpoint( G4long &seed );
+
+    /*! Remove the checkpoint records after a complete run (the part files are kept to be merged) */
+    void removeCheckpoint();
+
+    /*! Events of a checkpointed file: the record lines up to the one that matches the tree entries of the file */
+    bool readCheckpoint( const std::string &name, std::vector<int> &events );
+
     int m_nThreads;
 
     bool m_runVis;
-    
-    std::string m_output;
+
+    // Settings of the per thread actions
+    RunConfig m_config;
+
+    std::string m_metricsFile;
+
+    std::string m_metricsFormat;
+
+    float m_metricsInterval;
+
+    int m_seed;
+
+    bool m_resume;
+
+    std::vector<std::string> m_checkpointParts;
+
+    bool m_useFastSimulation;
+
+    std::string m_physicsList;
+
+    float m_defaultCut;
+
+    std::vector<std::string> m_cutRegions;
+
+    std::vector<float> m_cuts;
+
+    std::vector<std::string> m_limitRegions;
+
+    std::vector<float> m_maxStepLength;
+
+    std::vector<float> m_maxTrackTime;
+
+    std::vector<float> m_minKineticEnergy;
 
     std::vector< Gaugi::Algorithm* > m_acc;
 
@@ -0,0 +1,82 @@
+#ifndef ShowerLibrary_h
+#define ShowerLibrary_h
+
+#include "GaugiKernel/MsgStream.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <map>
+
+
+/*
+ * Frozen showers of e+/e-/gamma, binned by region, particle and energy. The showers
+ * are written by the ShowerLibraryBuilder (one file per thread) and replayed by the
+ * FrozenShowerModel.
+ *
+ * File layout (native endianness):
+ *   header : char[8] "LZTSHLIB", uint32 version, uint32 nedges, float edges[nedges]
+ *   shower : uint32 length, char[length] region, int32 pdg, float energy,
+ *            uint32 nhits, hit_t[nhits]
+ */
+namespace ShowerLib{
+
+  const char     magic[8] = {'L','Z','T','S','H','L','I','B'};
+  const uint32_t version  = 1;
+
+  /*! Position (mm) along the direction (l) and in the transverse plane (u,v), time (ns)
+   *  with respect to the entry point and the energy fraction of the shower */
+  struct hit_t{
+    float l;
+    float u;
+    float v;
+    float t;
+    float e;
+  };
+
+  struct shower_t{
+    int32_t pdg;
+    float energy;
+    std::vector<hit_t> hits;
+  };
+
+  /*! Index of the energy bin (-1 if outside of the edges) */
+  int find_bin( const std::vector<float> &edges, float energy );
+
+}
+
+
+class ShowerLibrary : public MsgService
+{
+  public:
+
+    ShowerLibrary();
+
+    /*! Read all showers of the file. The energy bins must match the files already read */
+    bool read( const std::string &path );
+
+    /*! Shared (read only) library for all threads. The files are read once */
+    static std::shared_ptr<const ShowerLibrary> load( const std::vector<std::string> &paths );
+
+    /*! A random shower of the bin (nullptr if there is no shower for it) */
+    const ShowerLib::shower_t* find( const std::string &region, int pdg, float energy ) const;
+
+    /*! True if there is at least one shower for this region, particle and energy */
+    bool contains( const std::string &region, int pdg, float energy ) const;
+
+    const std::vector<float>& edges() const { return m_edges; };
+
+    size_t size() const { return m_nshowers; };
+
+
+  private:
+
+    const std::vector<ShowerLib::shower_t>* showers( const std::string &region, int pdg, float energy ) const;
+
+    std::vector<float> m_edges;
+    // region -> pdg -> energy bin -> showers
+    std::map<std::string, std::map<int, std::vector<std::vector<ShowerLib::shower_t>>>> m_showers;
+    size_t m_nshowers;
+};
+
+#endif
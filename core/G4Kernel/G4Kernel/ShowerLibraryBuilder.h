@@ -0,0 +1,67 @@
+#ifndef ShowerLibraryBuilder_h
+#define ShowerLibraryBuilder_h
+
+#include "GaugiKernel/MsgStream.h"
+#include "G4Kernel/ShowerLibrary.h"
+#include "G4Step.hh"
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <tuple>
+#include <map>
+
+
+/*
+ * Per thread builder of the frozen shower library. Each e+/e-/gamma entering (or
+ * created inside) one of the regions with energy inside of the library bins becomes
+ * the root of a shower, and all deposits of its descendants are kept with respect to
+ * its entry point and direction. The showers are written at the end of each event.
+ */
+class ShowerLibraryBuilder : public MsgService
+{
+  public:
+
+    /** Constructor. One file per thread (path with the thread index) **/
+    ShowerLibraryBuilder( std::string path, std::vector<std::string> regions, std::vector<float> edges,
+                          int maxShowers );
+
+    /** Destructor. Close the file **/
+    ~ShowerLibraryBuilder();
+
+    /** Attach the step to its shower (if any) **/
+    void Fill( const G4Step *step );
+
+    /** Write all showers of the event **/
+    void EndOfEvent();
+
+
+  private:
+
+    struct root_t{
+      std::string region;
+      int pdg;
+      float energy;
+      double time;
+      G4ThreeVector pos, dir, u, v;
+      std::vector<ShowerLib::hit_t> hits;
+    };
+
+    /*! Try to start a new shower with this step (-1 if the track does not qualify) */
+    int start( const G4Step *step );
+
+    template<class T> void write( const T &value ){ m_file.write( reinterpret_cast<const char*>(&value), sizeof(T) ); };
+
+    std::ofstream m_file;
+    std::vector<std::string> m_regions;
+    std::vector<float> m_edges;
+    int m_maxShowers;
+    // track id -> shower index (-1 if the track is not part of any shower)
+    std::unordered_map<int, int> m_tracks;
+    std::vector<root_t> m_roots;
+    // number of showers written for each (region, pdg, bin)
+    std::map<std::tuple<std::string, int, int>, int> m_counts;
+    unsigned long long m_nshowers;
+};
+
+#endif
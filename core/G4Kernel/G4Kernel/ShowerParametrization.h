@@ -0,0 +1,47 @@
+#ifndef ShowerParametrization_h
+#define ShowerParametrization_h
+
+#include "G4Kernel/FastShowerModel.h"
+#include <string>
+
+
+/*
+ * GFlash-like fast simulation of the electromagnetic showers (Grindhammer & Peters
+ * parametrization). The sampling structure of the envelope (e.g. the lead/LAr layers
+ * of EM1, EM2 and EM3) is replaced by an effective homogeneous medium and each e+/e-/gamma
+ * inside the energy window is killed and replaced by energy spots sampled from the
+ * longitudinal (gamma) and radial (core + tail) profiles, with the correlated fluctuations.
+ */
+class ShowerParametrization : public FastShowerModel
+{
+  public:
+
+    /*! The energy window is in MeV */
+    ShowerParametrization( std::string name, G4Region *envelope, float minEnergy, float maxEnergy );
+
+    virtual ~ShowerParametrization();
+
+    virtual G4bool ModelTrigger( const G4FastTrack & ) override;
+
+    virtual void DoIt( const G4FastTrack &, G4FastStep & ) override;
+
+
+  private:
+
+    /*! Effective X0, Moliere radius, Z and critical energy of the envelope */
+    void computeMedium( G4Region *envelope );
+
+    float m_minEnergy;
+
+    float m_maxEnergy;
+
+    double m_x0;
+
+    double m_rm;
+
+    double m_z;
+
+    double m_ec;
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef StackingAction_h
+#define StackingAction_h
+
+#include "GaugiKernel/MsgStream.h"
+#include "G4Kernel/TrackTriage.h"
+#include "G4UserStackingAction.hh"
+#include "globals.hh"
+#include <memory>
+
+
+class StackingAction : public G4UserStackingAction, public MsgService
+{
+  public:
+    StackingAction( std::shared_ptr<TrackTriage> triage );
+    virtual ~StackingAction();
+
+    virtual G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track* track);
+
+    virtual void PrepareNewEvent();
+
+  private:
+
+    std::shared_ptr<TrackTriage> m_triage;
+};
+
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef StepAccounting_h
+#define StepAccounting_h
+
+#include "GaugiKernel/MsgStream.h"
+#include "GaugiKernel/StoreGate.h"
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include <string>
+#include <tuple>
+#include <map>
+
+class G4Region;
+class G4ParticleDefinition;
+
+
+/*
+ * Per thread accounting of the geant steps and tracks. The counters are
+ * splitted by region, particle definition and time bin (inside or outside
+ * of the readout window) and dumped into the output file at the end of
+ * the run.
+ */
+class StepAccounting : public MsgService
+{
+  public:
+
+    /** Constructor. The time window must be given in ns **/
+    StepAccounting( float tmin, float tmax );
+
+    /** Destructor **/
+    ~StepAccounting()=default;
+
+    /** Called by the tracking action when a new track starts **/
+    void PreTracking( const G4Track *track );
+
+    /** Called by the stepping action for each step **/
+    void Fill( const G4Step *step );
+
+    /** Write the summary tree into the store gate **/
+    void write( SG::StoreGate &store );
+
+
+  private:
+
+    struct counter_t{
+      unsigned long long steps=0;
+      unsigned long long tracks=0;
+      double cputime=0; // in seconds
+      double edep=0; // in MeV
+    };
+
+    typedef std::tuple<const G4Region*, const G4ParticleDefinition*, bool> key_t;
+
+    /** Thread cpu time in seconds **/
+    double cputime() const;
+
+    /** Check if the time (in ns) is inside of the readout window **/
+    bool inWindow( double t ) const;
+
+    float m_tmin;
+    float m_tmax;
+    // cpu time of the last stepping/tracking callback
+    double m_lastTime;
+
+    std::map< key_t, counter_t > m_counters;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef StepRecorder_h
+#define StepRecorder_h
+
+#include "GaugiKernel/MsgStream.h"
+#include "GaugiKernel/DataHandle.h"
+#include "G4Step.hh"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+
+
+/*
+ * Per thread recorder of all steps seen by the EventLoop. Each event is written
+ * as one block (event info, new volume names and the steps) into a compact
+ * binary file that can be fed back to the same algorithm sequence by StepReplay,
+ * without running Geant4.
+ *
+ * File layout (native endianness):
+ *   header : char[8] "LZTSTEPS", uint32 version
+ *   event  : uint32 'EVNT', int32 eventNumber, float avgmu, int32 interactions, int32 totalEnergy,
+ *            uint32 nseeds, seed_t[nseeds],
+ *            uint32 nvolumes, { uint32 id, uint32 length, char[length] }[nvolumes],
+ *            uint64 nsteps, step_record_t[nsteps]
+ *
+ * Version 3: the number of interactions of the event (not in the older versions).
+ * Version 2: the highest bit of the step volume id is the main event (truth) tag.
+ * Version 1 files have the truth copy of the main event in the truth bunch.
+ */
+namespace StepRecord{
+
+  const char     magic[8] = {'L','Z','T','S','T','E','P','S'};
+  const uint32_t version  = 3;
+  const uint32_t main_event_bit = 0x80000000;
+  const uint32_t marker   = 0x45564E54; // EVNT
+
+  /*! Position and time are kept in double to give the same cells of the simulation */
+  struct step_record_t{
+    double x;
+    double y;
+    double z;
+    double time;
+    float  edep;
+    uint32_t volume;
+  };
+
+}
+
+
+class StepRecorder : public MsgService
+{
+  public:
+
+    /** Constructor. One file per thread (path with the thread index) **/
+    StepRecorder( std::string path, std::string eventKey );
+
+    /** Destructor. Close the file **/
+    ~StepRecorder();
+
+    /** Keep the step into the event buffer **/
+    void Fill( const G4Step *step );
+
+    /** Write the event info and all buffered steps **/
+    void EndOfEvent( SG::EventContext &ctx );
+
+
+  private:
+
+    template<class T> void write( const T &value ){ m_file.write( reinterpret_cast<const char*>(&value), sizeof(T) ); };
+
+    std::ofstream m_file;
+    std::string m_eventKey;
+    // Steps of the current event (the capacity is kept between events)
+    std::vector<StepRecord::step_record_t> m_steps;
+    // Volume name to id and the names not written yet
+    std::map<std::string, uint32_t> m_volumes;
+    std::vector<std::string> m_newVolumes;
+    unsigned long long m_nevents;
+};
+
+#endif
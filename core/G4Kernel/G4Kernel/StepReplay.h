@@ -0,0 +1,42 @@
+#ifndef StepReplay_h
+#define StepReplay_h
+
+#include "GaugiKernel/Algorithm.h"
+#include "GaugiKernel/MsgStream.h"
+#include "GaugiKernel/Property.h"
+
+#include <vector>
+#include <string>
+
+
+/*
+ * Replay driver for the files written by the StepRecorder. All recorded steps
+ * are fed back to the algorithm sequence through the same EventLoop used by
+ * the simulation, but without Geant4. Only the pre step point position, the
+ * global time and the energy deposit are available to the algorithms.
+ */
+class StepReplay: public MsgService, 
+                  public Gaugi::PropertyService
+{
+  public:
+
+    StepReplay( std::string name );
+    ~StepReplay();
+    
+    /** Replay evt events from all input files (all events if negative) **/
+    void run( int evt=-1 );
+
+    void push_back( Gaugi::Algorithm* );
+
+
+  private:
+
+    std::vector<std::string> m_inputFiles;
+
+    std::string m_output;
+
+    std::string m_eventKey;
+
+    std::vector< Gaugi::Algorithm* > m_acc;
+};
+#endif
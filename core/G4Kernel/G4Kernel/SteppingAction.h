@@ -2,18 +2,24 @@
 #define SteppingAction_h
 
 #include "GaugiKernel/MsgStream.h"
+#include "G4Kernel/TrackTriage.h"
 #include "G4UserSteppingAction.hh"
 #include "g4root.hh"
+#include <memory>
 
 class DetectorConstruction;
 
 class SteppingAction : public G4UserSteppingAction, public MsgService
 {
   public:
-    SteppingAction();
+    SteppingAction( std::shared_ptr<TrackTriage> triage=nullptr );
     virtual ~SteppingAction();
     virtual void UserSteppingAction(const G4Step* step);
-  
+
+  private:
+
+    // kill the tracks that can not reach any readout sample (optional)
+    std::shared_ptr<TrackTriage> m_triage;
 };
 
 
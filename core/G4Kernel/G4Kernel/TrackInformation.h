@@ -0,0 +1,42 @@
+#ifndef TrackInformation_h
+#define TrackInformation_h
+
+#include "G4VUserPrimaryParticleInformation.hh"
+#include "G4VUserTrackInformation.hh"
+#include "G4Track.hh"
+
+
+/*
+ * Tag of the primary particles of the main event (signal). The tracking action moves
+ * it into the TrackInformation of the primary track.
+ */
+class PrimaryParticleInformation : public G4VUserPrimaryParticleInformation
+{
+  public:
+    PrimaryParticleInformation();
+    virtual ~PrimaryParticleInformation();
+    virtual void Print() const;
+};
+
+
+/*
+ * Ancestry of the tracks coming from the main event. It is given to all secondaries
+ * of a main track at the end of its tracking, so the truth deposits can be kept in
+ * the same simulation of the reco deposits. Tracks without information are pileup.
+ */
+class TrackInformation : public G4VUserTrackInformation
+{
+  public:
+    TrackInformation();
+    virtual ~TrackInformation();
+    virtual void Print() const;
+
+    /*! True if the track comes from a main event primary (false for null tracks) */
+    static bool fromMainEvent( const G4Track *track )
+    {
+      // This is the only track information used by the framework
+      return track && track->GetUserInformation();
+    };
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef TrackTriage_h
+#define TrackTriage_h
+
+#include "GaugiKernel/MsgStream.h"
+#include "GaugiKernel/DataHandle.h"
+#include "G4Kernel/RunConfig.h"
+#include "G4Track.hh"
+#include "G4Step.hh"
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+
+
+/*
+ * Per thread triage of the tracks that can not reach any readout sample: neutrinos,
+ * tracks after the latest readout time, tracks outside of the calorimeter envelope
+ * (radius and |z|), tracks outside of the RoIs (Delta R around the event seeds) and new
+ * tracks below the kinetic energy threshold of its species.
+ * Used by the stacking action (new tracks) and by the stepping action (tracks in flight).
+ * The number of killed tracks for each reason is reported at the end of the thread.
+ */
+class TrackTriage : public MsgService
+{
+  public:
+
+    enum Reason{
+      KEEP = -1,
+      NEUTRINO = 0,
+      TIME,
+      ENVELOPE,
+      ENERGY,
+      ROI,
+      NREASONS
+    };
+
+    /** Constructor. Time in ns, lengths in mm and energies in MeV (zero is no cut). Inside of 
+     *  the RoI min radius the direction is used in place of the position. Without UseTrackTriage
+     *  only the RoI cut is applied **/
+    TrackTriage( const RunConfig &config );
+
+    /** Destructor. Report the counters **/
+    ~TrackTriage();
+
+    /*! Read the seeds of the event (RoI mode only) */
+    void BeginOfEvent( SG::EventContext &ctx );
+
+    /*! Check a new track before it is pushed into the stack */
+    Reason classify( const G4Track *track );
+
+    /*! Check the track at the end of the step. The energy threshold is left to the G4UserLimits */
+    Reason check( const G4Step *step );
+
+
+  private:
+
+    Reason count( Reason reason, bool stacking );
+
+    /*! True if the eta/phi is outside of all RoIs */
+    bool outside( const G4ThreeVector &v ) const;
+
+    float m_maxTime;
+    float m_maxRadius;
+    float m_maxZ;
+    bool m_killNeutrinos;
+    // pdg -> min kinetic energy
+    std::map<int, float> m_minEnergy;
+    float m_roiDeltaR;
+    float m_roiMinRadius;
+    std::string m_eventKey;
+    // eta/phi of the seeds in the current event
+    std::vector<std::pair<float,float>> m_seeds;
+    // killed tracks for each reason in the stacking and in the stepping action
+    unsigned long long m_stacked[NREASONS];
+    unsigned long long m_stepped[NREASONS];
+    unsigned long long m_total;
+};
+
+#endif
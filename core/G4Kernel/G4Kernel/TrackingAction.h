@@ -0,0 +1,22 @@
+#ifndef TrackingAction_h
+#define TrackingAction_h
+
+#include "GaugiKernel/MsgStream.h"
+#include "G4UserTrackingAction.hh"
+#include "globals.hh"
+
+
+class TrackingAction : public G4UserTrackingAction, public MsgService
+{
+  public:
+    TrackingAction();
+    virtual ~TrackingAction();
+
+    virtual void PreUserTrackingAction(const G4Track* track);
+
+    /*! Give the main event tag to all secondaries of a main track */
+    virtual void PostUserTrackingAction(const G4Track* track);
+};
+
+
+#endif
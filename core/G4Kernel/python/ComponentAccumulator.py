@@ -2,11 +2,21 @@
 __all__ = ["ComponentAccumulator"]
 
 from Gaugi import Logger
+from Gaugi.messenger.macros import *
+from G4Kernel.utilities import treatPropertyValue
 
 
 class ComponentAccumulator( Logger ):
 
-  __allow_keys = ["NumberOfThreads", "OutputFile", "RunVis"]
+  __allow_keys = ["NumberOfThreads", "OutputFile", "RunVis", "UseStepAccounting", "TimeWindow",
+                  "UseMemoryAccounting", "UseAllocAccounting", "AllocationGuard",
+                  "MetricsFile", "MetricsFormat", "MetricsInterval", "Seed", "CheckpointInterval", "Resume",
+                  "StepRecordFile", "StepRecordEventKey", "ShowerLibraryFile", "ShowerLibraryRegions",
+                  "ShowerLibraryBins", "ShowerLibraryMaxShowers", "PhysicsList", "DefaultCut",
+                  "ProductionCutRegions", "ProductionCuts", "UserLimitRegions", "MaxStepLength",
+                  "MaxTrackTime", "MinKineticEnergy", "UseTrackTriage", "TriageMaxTime", "TriageMaxRadius",
+                  "TriageMaxZ", "KillNeutrinos", "TriageParticles", "TriageMinEnergy",
+                  "RoIDeltaR", "RoIMinRadius", "RoIEventKey"]
 
   def __init__( self, name , detector, **kw):
 
@@ -16,11 +26,14 @@ class ComponentAccumulator( Logger ):
     from ROOT import RunManager
     self.__core = RunManager(name)
     self.__core.setDetectorConstruction( detector.core() )
+    # The fast simulation models are attached by the detector, but the process must be in the physics list
+    if getattr( detector, '__UseFastSimulation', False ) or getattr( detector, '__UseShowerLibrary', False ):
+      self.__core.setProperty( "UseFastSimulation", True )
     self.__numberOfEvents = 10000
     for key, value in kw.items():
       if key in self.__allow_keys:
         setattr( self, '__' + key , value )
-        self.__core.setProperty( key, value )
+        self.__core.setProperty( key, treatPropertyValue(value) )
       else:
         MSG_FATAL( self, "Property with name %s is not allow for %s object", key , self.__class__.__name__)
 
@@ -35,7 +48,7 @@ class ComponentAccumulator( Logger ):
 
   def setProperty( self, key, value ):
     if key in self.__allow_keys:
-      self.core().setProperty( key, value )
+      self.core().setProperty( key, treatPropertyValue(value) )
     else:
       MSG_FATAL( self, "Property with name %s is not allow for %s object", key, self.__class__.__name__)
 
@@ -62,3 +75,10 @@ class ComponentAccumulator( Logger ):
   def setNumberOfEvents( self, evt ):
     self.__numberOfEvents = evt
 
+
+  #
+  # Files with the events done before the resume of this run (to be merged with the thread files)
+  #
+  def checkpointParts( self ):
+    return [ str(part) for part in self.__core.checkpointParts() ]
+
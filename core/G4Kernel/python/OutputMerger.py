@@ -0,0 +1,198 @@
+
+__all__ = ["OutputMerger", "merge_outputs"]
+
+from Gaugi import Logger
+from Gaugi.messenger.macros import *
+import threading
+import os
+
+
+# PyROOT is not used by more than one merge thread at the same time
+_root_lock = threading.Lock()
+
+
+def entries( fname ):
+  """
+    Returns the number of entries of each tree (path in the file) or None if the file
+    can not be opened.
+  """
+  with _root_lock:
+    import ROOT
+    f = ROOT.TFile.Open( fname )
+    if not f or f.IsZombie():
+      return None
+    counts = {}
+    def walk( directory, path ):
+      # Only the highest cycle of each key
+      for name in sorted( set( key.GetName() for key in directory.GetListOfKeys() ) ):
+        obj = directory.Get( name )
+        if obj.InheritsFrom('TDirectory'):
+          walk( obj, path + name + '/' )
+        elif obj.InheritsFrom('TTree'):
+          counts[path + name] = obj.GetEntries()
+    walk( f, '' )
+    f.Close()
+    return counts
+
+
+def compression( fname ):
+  with _root_lock:
+    import ROOT
+    f = ROOT.TFile.Open( fname )
+    if not f or f.IsZombie():
+      return None
+    settings = f.GetCompressionSettings()
+    f.Close()
+    return settings
+
+
+def merge_files( output, files, remove=True, logger=None ):
+  """
+    Merge the files into the output with hadd. The baskets are copied without unzipping
+    (fast cloning) when the compression of the inputs is the same of the output, which
+    takes the compression of the first input. The inputs are removed only if the output
+    has all their entries.
+  """
+  import subprocess, shutil
+  logger = logger if logger else Logger.getModuleLogger("OutputMerger")
+  if len(files) == 1:
+    if remove:
+      os.rename( files[0], output )
+    else:
+      shutil.copyfile( files[0], output )
+    return True
+
+  if len( set( compression(fname) for fname in files ) ) > 1:
+    MSG_WARNING( logger, 'The inputs of %s have different compression settings. Their baskets will be recompressed.', output )
+
+  expected = {}
+  for fname in files:
+    counts = entries( fname )
+    if counts is None:
+      MSG_ERROR( logger, 'It is not possible to open %s', fname )
+      return False
+    for tree, n in counts.items():
+      expected[tree] = expected.get(tree, 0) + n
+
+  if subprocess.call( ['hadd', '-ff', output] + files ) != 0:
+    MSG_ERROR( logger, 'It is not possible to merge into %s', output )
+    if os.path.exists( output ):
+      os.remove( output )
+    return False
+
+  counts = entries( output )
+  if counts != expected:
+    MSG_ERROR( logger, 'The entries of %s (%s) do not match the inputs (%s). Keeping the inputs.', output, counts, expected )
+    os.remove( output )
+    return False
+
+  if remove:
+    for fname in files:
+      os.remove( fname )
+  return True
+
+
+
+class OutputMerger( Logger ):
+
+  #
+  # Incremental merge of the outputs of a job. The files are given as soon as they are
+  # finished and each batch of files is merged into a partial file by one of the workers
+  # while the job goes on. Close merges the partial files and the remaining inputs into
+  # the output.
+  #
+  # A tag can be given with each file and onMerge( partial, tags ) is called after each
+  # partial merge (e.g. to record the progress of the job). A failed partial merge keeps
+  # its inputs for the final merge.
+  #
+  def __init__( self, output, maxWorkers=2, batchSize=10, prefix=None, remove=True, onMerge=None ):
+    Logger.__init__(self)
+    from concurrent.futures import ThreadPoolExecutor
+    self._output    = output
+    self._batchSize = max(batchSize, 2)
+    self._prefix    = prefix if prefix else output.replace('.root', '')
+    self._remove    = remove
+    self._onMerge   = onMerge
+    self._pending   = []
+    self._parts     = []
+    self._names     = set()
+    self._lock      = threading.Lock()
+    self._pool      = ThreadPoolExecutor( max_workers=max(int(maxWorkers), 1) )
+
+
+  def add( self, fname, tag=None ):
+    with self._lock:
+      self._pending.append( (fname, tag) )
+      if len(self._pending) < self._batchSize:
+        return
+      batch = self._pending; self._pending = []
+      part = self.next_part()
+    self._pool.submit( self.merge_part, part, batch )
+
+
+  def add_part( self, fname, tags ):
+    # Partial file merged by a previous job (resume)
+    with self._lock:
+      self._names.add( fname )
+      self._parts.append( (fname, tags) )
+
+
+  def next_part( self ):
+    k = 0
+    while ('%s_part%d.root' % (self._prefix, k)) in self._names or os.path.exists( '%s_part%d.root' % (self._prefix, k) ):
+      k += 1
+    part = '%s_part%d.root' % (self._prefix, k)
+    self._names.add( part )
+    return part
+
+
+  def merge_part( self, part, batch ):
+    files = [fname for fname, _ in batch]
+    # The inputs are only removed after the part is recorded, so a job killed in between
+    # still finds them (or the recorded part) when resumed
+    ok = merge_files( part, files, remove=False, logger=self )
+    with self._lock:
+      if ok:
+        tags = [tag for _, tag in batch]
+        self._parts.append( (part, tags) )
+        if self._onMerge:
+          self._onMerge( part, tags )
+      else:
+        MSG_WARNING( self, 'The files of %s are kept for the final merge', part )
+        self._pending.extend( batch )
+    if ok and self._remove:
+      for fname in files:
+        os.remove( fname )
+
+
+  def wait( self ):
+    # Wait for the running merges (no more files can be added)
+    self._pool.shutdown( wait=True )
+
+
+  def close( self ):
+    self.wait()
+    parts  = [fname for fname, _ in self._parts]
+    inputs = [fname for fname, _ in self._pending]
+    if not parts and not inputs:
+      return True
+    MSG_INFO( self, 'Merging %d files into %s', len(parts) + len(inputs), self._output )
+    if not merge_files( self._output, parts + inputs, remove=self._remove, logger=self ):
+      return False
+    # The partial files are always removed
+    if not self._remove:
+      for fname in parts:
+        os.remove( fname )
+    self._parts = []; self._pending = []
+    return True
+
+
+
+def merge_outputs( output, files, maxWorkers=2, batchSize=10, remove=True ):
+  """
+    Merge a list of finished files, in batches of batchSize merged in parallel.
+  """
+  merger = OutputMerger( output, maxWorkers=maxWorkers, batchSize=batchSize, remove=remove )
+  for fname in files:
+    merger.add( fname )
+  return merger.close()
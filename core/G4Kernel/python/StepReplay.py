@@ -0,0 +1,62 @@
+
+__all__ = ["StepReplay"]
+
+from Gaugi import Logger
+from Gaugi.messenger.macros import *
+from G4Kernel.utilities import treatPropertyValue
+
+
+class StepReplay( Logger ):
+
+  __allow_keys = ["InputFiles", "OutputFile", "EventKey"]
+
+  def __init__( self, name , **kw):
+
+    Logger.__init__(self)
+    import ROOT
+    ROOT.gSystem.Load('liblorenzett')
+    from ROOT import StepReplay as StepReplayCore
+    self.__core = StepReplayCore(name)
+    self.__numberOfEvents = -1
+    for key, value in kw.items():
+      if key in self.__allow_keys:
+        setattr( self, '__' + key , value )
+        self.__core.setProperty( key, treatPropertyValue(value) )
+      else:
+        MSG_FATAL( self, "Property with name %s is not allow for %s object", key , self.__class__.__name__)
+
+
+  def run( self, evt=None ):
+    if evt is None:
+      evt = self.__numberOfEvents
+    self.__core.run(evt)
+
+
+  def setProperty( self, key, value ):
+    if key in self.__allow_keys:
+      self.core().setProperty( key, treatPropertyValue(value) )
+    else:
+      MSG_FATAL( self, "Property with name %s is not allow for %s object", key, self.__class__.__name__)
+
+ 
+  def getProperty( self, key ):
+    if key in self.__allow_keys:
+      return getattr( self, '__' + key )
+    else:
+      MSG_FATAL( self, "Property with name %s is not allow for %s object", key, self.__class__.__name__)
+
+
+  def __add__( self, algs ):
+    if type(algs) is not list:
+      algs =[algs]
+    for alg in algs:
+      self.__core.push_back( alg.core() )
+    return self
+
+  
+  def core(self):
+    return self.__core
+
+
+  def setNumberOfEvents( self, evt ):
+    self.__numberOfEvents = evt
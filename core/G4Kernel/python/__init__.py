@@ -9,10 +9,18 @@ from . import ComponentAccumulator
 __all__.extend(ComponentAccumulator.__all__)
 from .ComponentAccumulator import *
 
+from . import StepReplay
+__all__.extend(StepReplay.__all__)
+from .StepReplay import *
+
 from . import ParticleGun
 __all__.extend(ParticleGun.__all__)
 from .ParticleGun import *
 
+from . import OutputMerger
+__all__.extend(OutputMerger.__all__)
+from .OutputMerger import *
+
 
 
 
@@ -4,18 +4,20 @@
 #include "G4Kernel/RunAction.h"
 #include "G4Kernel/EventAction.h"
 #include "G4Kernel/SteppingAction.h"
+#include "G4Kernel/TrackingAction.h"
+#include "G4Kernel/StackingAction.h"
 #include "G4MTRunManager.hh"
 #include <iostream>
 
 ActionInitialization::ActionInitialization( PrimaryGenerator *gen,
                                             std::vector<Gaugi::Algorithm*> acc , 
-                                            std::string output)
+                                            const RunConfig &config )
  : 
   IMsgService("ActionInitialization"), 
   G4VUserActionInitialization(),
   m_acc(acc),
   m_generator(gen),
-  m_output(output)
+  m_config(config)
 {
 
   for ( auto toolHandle : m_acc )
@@ -51,8 +53,17 @@ void ActionInitialization::BuildForMaster() const
 void ActionInitialization::Build() const
 {
   SetUserAction(new PrimaryGeneratorAction(m_generator));
-  SetUserAction(new RunAction(m_acc, m_output));
+  SetUserAction(new RunAction(m_acc, m_config));
   SetUserAction(new EventAction());
-  SetUserAction(new SteppingAction());
+  if ( m_config.useTrackTriage || m_config.roiDeltaR > 0 ){
+    // One triage per thread, shared by the stacking and the stepping actions. The RoI mode can run alone
+    auto triage = std::make_shared<TrackTriage>( m_config );
+    SetUserAction(new StackingAction(triage));
+    SetUserAction(new SteppingAction(triage));
+  }else{
+    SetUserAction(new SteppingAction());
+  }
+  // Needed by the main event (truth) tagging and by the step accounting
+  SetUserAction(new TrackingAction());
 }  
 
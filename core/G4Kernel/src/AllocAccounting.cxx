@@ -0,0 +1,133 @@
+
+#include "G4Kernel/AllocAccounting.h"
+#include "TTree.h"
+
+using namespace Gaugi;
+
+
+namespace{
+  // Out of line (and volatile) so the compiler can not elide the allocations of the self check
+  __attribute__((noinline)) void allocate_int()
+  {
+    int * volatile ptr = new int(1);
+    delete ptr;
+  }
+
+  // Allocated inside of libstdc++ (std::string is an extern template)
+  __attribute__((noinline)) void allocate_string()
+  {
+    static volatile std::size_t capacity = 0;
+    std::string str;
+    str.reserve( 256 );
+    capacity = str.capacity();
+  }
+}
+
+
+std::atomic<unsigned> AllocAccounting::s_violations(0);
+
+
+AllocAccounting::AllocAccounting( std::vector<std::string> algs, float guard ):
+  IMsgService("AllocAccounting"),
+  m_algs(algs),
+  m_counters( algs.size(), std::vector<alloc_t>(NUMBER_OF_PHASES) ),
+  m_nsteps(0),
+  m_nevents(0),
+  m_guard(guard),
+  m_counting( counting() )
+{
+  if ( !m_counting ){
+    std::string reason = AllocCounter::enabled() ? "The operator new of the GaugiKernel does not replace the one of the process" :
+                                                   "The library was not compiled with LZT_ALLOC_COUNTING";
+    // Zero allocations would always pass the guard
+    if ( m_guard >= 0 ){
+      MSG_FATAL( reason << ". The AllocationGuard can not be checked." );
+    }
+    MSG_WARNING( reason << ". The allocations will not be reported." );
+  }
+}
+
+
+bool AllocAccounting::counting()
+{
+  if ( !AllocCounter::enabled() ) return false;
+  alloc_t begin = AllocCounter::snapshot();
+  allocate_int();
+  alloc_t middle = AllocCounter::snapshot();
+  allocate_string();
+  alloc_t end = AllocCounter::snapshot();
+  return middle.count > begin.count && end.count > middle.count;
+}
+
+
+void AllocAccounting::add( alloc_t &counter, const alloc_t &begin )
+{
+  alloc_t end = AllocCounter::snapshot();
+  counter.count += end.count - begin.count;
+  counter.bytes += end.bytes - begin.bytes;
+}
+
+
+void AllocAccounting::stop( unsigned alg, Phase phase )
+{
+  add( m_counters[alg][phase], m_start );
+}
+
+
+void AllocAccounting::EndOfStep()
+{
+  add( m_stepping, m_step );
+  m_nsteps++;
+}
+
+
+void AllocAccounting::write( SG::StoreGate &store )
+{
+  if ( !m_counting ) return;
+
+  const char* phases[] = {"pre_execute", "execute", "post_execute", "fillHistograms"};
+
+  std::string name, phase;
+  unsigned long long count, bytes;
+  double per_event, per_step;
+
+  store.mkdir( "AllocAccounting" );
+  TTree *tree = new TTree( "allocations", "" );
+  tree->Branch( "name"      , &name       );
+  tree->Branch( "phase"     , &phase      );
+  tree->Branch( "count"     , &count      );
+  tree->Branch( "bytes"     , &bytes      );
+  tree->Branch( "per_event" , &per_event  );
+  tree->Branch( "per_step"  , &per_step   );
+  store.add( tree );
+
+  auto fill = [&]( std::string n, std::string p, const alloc_t &a ){
+    name      = n;
+    phase     = p;
+    count     = a.count;
+    bytes     = a.bytes;
+    per_event = m_nevents ? double(a.count)/m_nevents : 0;
+    per_step  = m_nsteps  ? double(a.count)/m_nsteps  : 0;
+    tree->Fill();
+    MSG_INFO( std::setw(25) << n << std::setw(16) << p << " allocations = " << count << " (" << bytes
+              << " bytes) per event = " << per_event << " per step = " << per_step );
+  };
+
+  for ( unsigned alg=0; alg < m_algs.size(); ++alg )
+  {
+    for ( unsigned p=0; p < NUMBER_OF_PHASES; ++p )
+      fill( m_algs[alg], phases[p], m_counters[alg][p] );
+
+    // Regression guard: the step path must not allocate
+    double allocs_per_step = m_nsteps ? double(m_counters[alg][EXECUTE].count)/m_nsteps : 0;
+    if ( m_guard >= 0 && allocs_per_step > m_guard ){
+      MSG_ERROR( m_algs[alg] << " allocates " << allocs_per_step << " times per step (allowed: " << m_guard
+                 << "). Please, check the execute method." );
+      s_violations++;
+    }
+  }
+
+  fill( "SteppingAction", "execute", m_stepping );
+}
+
+
@@ -1,18 +1,59 @@
 
 #include "G4Kernel/EventLoop.h"
 #include "G4Threading.hh"
+#include <fstream>
 #include <iostream>
 
 
 
-EventLoop::EventLoop( std::vector<Gaugi::Algorithm*> acc , std::string output): 
+EventLoop::EventLoop( std::vector<Gaugi::Algorithm*> acc , const RunConfig &config ): 
   IMsgService("EventLoop"),
   G4Run(), 
-  m_store( output , G4Threading::G4GetThreadId() ),
+  m_store( config.output , G4Threading::G4GetThreadId() ),
   m_ctx( "EventContext" ),
-  m_toolHandles(acc)
+  m_toolHandles(acc),
+  m_stepAccounting(nullptr),
+  m_memoryAccounting(nullptr),
+  m_allocAccounting(nullptr),
+  m_stepRecorder(nullptr),
+  m_showerLibrary(nullptr),
+  m_metrics(nullptr),
+  m_checkpointInterval(config.checkpointInterval),
+  m_event(-1),
+  m_skip(false),
+  m_completed(config.completedEvents.begin(), config.completedEvents.end())
 
 {
+  if ( m_checkpointInterval > 0 ){
+    // Same name of the thread file (see StoreGate)
+    int thread = G4Threading::G4GetThreadId();
+    m_checkpointFile = config.checkpointPrefix + ( thread >= 0 ? "_" + std::to_string( thread ) : "" ) + ".checkpoint";
+    MSG_INFO( "Checkpoint each " << m_checkpointInterval << " events into " << m_checkpointFile );
+  }
+
+  if ( config.useStepAccounting ){
+    MSG_INFO( "Step accounting enabled with time window " << config.timeWindow << " ns" );
+    m_stepAccounting = new StepAccounting( config.timeWindow.at(0), config.timeWindow.at(1) );
+  }
+  if ( config.useMemoryAccounting ){
+    MSG_INFO( "Memory accounting enabled" );
+    m_memoryAccounting = new MemoryAccounting();
+  }
+  if ( config.useAllocAccounting ){
+    MSG_INFO( "Allocation accounting enabled" );
+    std::vector<std::string> names;
+    for ( auto alg : m_toolHandles ) names.push_back( alg->name() );
+    m_allocAccounting = new AllocAccounting( names, config.allocGuard );
+  }
+  if ( !config.stepRecordFile.empty() )
+    m_stepRecorder = new StepRecorder( config.stepRecordFile, config.stepRecordKey );
+  if ( !config.showerLibraryFile.empty() )
+    m_showerLibrary = new ShowerLibraryBuilder( config.showerLibraryFile, config.showerLibraryRegions,
+                                                config.showerLibraryBins, config.showerLibraryMaxShowers );
+
+  if ( auto metrics = Gaugi::MetricsExporter::instance() )
+    m_metrics = metrics->counter( G4Threading::G4GetThreadId() );
+
   // Pre execution of all tools in sequence
   for( auto &toolHandle : m_toolHandles){
     MSG_INFO( "Booking histograms for " << toolHandle->name() );
@@ -24,47 +65,144 @@ EventLoop::EventLoop( std::vector<Gaugi::Algorithm*> acc , std::string output):
 
 
 EventLoop::~EventLoop()
-{;}
+{
+  // Dump the accounting summary before the store gate writes the file
+  if ( m_stepAccounting ){
+    m_stepAccounting->write( m_store );
+    delete m_stepAccounting;
+  }
+  if ( m_memoryAccounting ){
+    m_memoryAccounting->write( m_store );
+    delete m_memoryAccounting;
+  }
+  if ( m_allocAccounting ){
+    m_allocAccounting->write( m_store );
+    delete m_allocAccounting;
+  }
+  if ( m_stepRecorder ) delete m_stepRecorder;
+  if ( m_showerLibrary ) delete m_showerLibrary;
+}
+
+
 
 
+bool EventLoop::prepare( int evt )
+{
+  m_event = evt;
+  m_skip = m_completed.count( evt ) > 0;
+  return !m_skip;
+}
 
 
 void EventLoop::BeginOfEvent()
 {
+  if ( m_skip ) return;
+
+  // The throughput is measured from the first event (after the geometry and physics initialization)
+  if ( m_metrics ){
+    if ( auto metrics = Gaugi::MetricsExporter::instance() ) metrics->startEventLoop();
+  }
+
+  if ( m_memoryAccounting ) m_memoryAccounting->BeginOfEvent();
+
   // Pre execution of all tools in sequence
-  for( auto &toolHandle : m_toolHandles){
+  for( unsigned i=0; i < m_toolHandles.size(); ++i ){
+    auto toolHandle = m_toolHandles[i];
     MSG_INFO( "Launching pre execute step for " << toolHandle->name() );
+    if ( m_allocAccounting ) m_allocAccounting->start();
     if (toolHandle->pre_execute( m_ctx ).isFailure() ){
       MSG_FATAL("It's not possible to pre execute " << toolHandle->name());
     }
+    if ( m_allocAccounting ) m_allocAccounting->stop( i, AllocAccounting::PRE_EXECUTE );
   }
 }
 
 
 void EventLoop::ExecuteEvent( const G4Step* step )
 {
-  for( auto &toolHandle : m_toolHandles){
+  if ( m_allocAccounting ) m_allocAccounting->BeginOfStep();
+
+  if ( m_stepAccounting ) m_stepAccounting->Fill( step );
+
+  if ( m_stepRecorder ) m_stepRecorder->Fill( step );
+
+  if ( m_showerLibrary ) m_showerLibrary->Fill( step );
+
+  for( unsigned i=0; i < m_toolHandles.size(); ++i ){
+    auto toolHandle = m_toolHandles[i];
+    if ( m_allocAccounting ) m_allocAccounting->start();
     if (toolHandle->execute( m_ctx, step ).isFailure() ){
       MSG_FATAL("Execution failure for  " << toolHandle->name());
     }
+    if ( m_allocAccounting ) m_allocAccounting->stop( i, AllocAccounting::EXECUTE );
   }
+
+  if ( m_allocAccounting ) m_allocAccounting->EndOfStep();
+  if ( m_metrics ) Gaugi::increment( m_metrics->steps );
 }
 
 
 void EventLoop::EndOfEvent()
 {
-  for( auto &toolHandle : m_toolHandles){
+  if ( m_skip ) return;
+
+  // Write the steps before any algorithm touches the event info
+  if ( m_stepRecorder ) m_stepRecorder->EndOfEvent( m_ctx );
+  if ( m_showerLibrary ) m_showerLibrary->EndOfEvent();
+
+  for( unsigned i=0; i < m_toolHandles.size(); ++i ){
+    auto toolHandle = m_toolHandles[i];
     MSG_INFO( "Launching post execute step for " << toolHandle->name() );
+    if ( m_allocAccounting ) m_allocAccounting->start();
     if (toolHandle->post_execute( m_ctx ).isFailure() ){
       MSG_FATAL("It's not possible to post execute for " << toolHandle->name());
     }
+    if ( m_allocAccounting ) m_allocAccounting->stop( i, AllocAccounting::POST_EXECUTE );
+    if ( m_allocAccounting ) m_allocAccounting->start();
     if (toolHandle->fillHistograms( m_ctx , m_store).isFailure() ){
       MSG_FATAL("It's not possible to fill histograms for " << toolHandle->name());
     }
+    if ( m_allocAccounting ) m_allocAccounting->stop( i, AllocAccounting::FILL_HISTOGRAMS );
   }
 
+  // Sample the memory footprint before release the event
+  if ( m_memoryAccounting ) m_memoryAccounting->EndOfEvent( m_ctx, m_toolHandles );
+  if ( m_allocAccounting ) m_allocAccounting->EndOfEvent();
+  if ( m_metrics ) Gaugi::increment( m_metrics->events );
+
   // Clear all storable pointers
   m_ctx.clear();
+
+  if ( m_checkpointInterval > 0 ){
+    m_done.push_back( m_event );
+    if ( (int)m_done.size() >= m_checkpointInterval ) checkpoint();
+  }
+}
+
+
+void EventLoop::checkpoint()
+{
+  // One line per checkpoint with the tree entries after the flush and the new events. The line is
+  // appended before the flush, so a killed flush leaves a file that matches the previous line (the
+  // resume takes the events of the lines up to the one that matches the file)
+  {
+    auto entries = m_store.entries();
+    std::ofstream out( m_checkpointFile, std::ios::app );
+    out << "entries " << entries.size();
+    for ( const auto &tree : entries ) out << " " << tree.first << " " << tree.second;
+    out << " events " << m_done.size();
+    for ( int evt : m_done ) out << " " << evt;
+    out << " end" << std::endl;
+  }
+  m_store.flush();
+  MSG_INFO( "Checkpoint after " << m_done.size() << " new events" );
+  m_done.clear();
+}
+
+
+void EventLoop::PreTracking( const G4Track* track )
+{
+  if ( m_stepAccounting ) m_stepAccounting->PreTracking( track );
 }
 
 
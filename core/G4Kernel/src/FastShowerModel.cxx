@@ -0,0 +1,47 @@
+
+#include "G4Kernel/FastShowerModel.h"
+#include "G4Kernel/EventLoop.h"
+#include "G4RunManager.hh"
+#include "G4Electron.hh"
+#include "G4Positron.hh"
+#include "G4Gamma.hh"
+
+
+FastShowerModel::FastShowerModel( std::string name, G4Region *envelope ):
+  G4VFastSimulationModel( name, envelope ),
+  IMsgService( name )
+{;}
+
+
+FastShowerModel::~FastShowerModel()
+{;}
+
+
+G4bool FastShowerModel::IsApplicable( const G4ParticleDefinition &particle )
+{
+  return &particle == G4Electron::Definition() || &particle == G4Positron::Definition() ||
+         &particle == G4Gamma::Definition();
+}
+
+
+void FastShowerModel::deposit( const G4Track *track, const G4ThreeVector &pos, double time, double edep )
+{
+  G4StepPoint *point = m_step.GetPreStepPoint();
+  m_step.SetTrack( const_cast<G4Track*>(track) );
+  point->SetTouchableHandle( track->GetTouchableHandle() );
+  point->SetPosition( pos );
+  point->SetGlobalTime( time );
+  m_step.SetTotalEnergyDeposit( edep );
+
+  EventLoop* loop = static_cast<EventLoop*> (G4RunManager::GetRunManager()->GetNonConstCurrentRun());
+  loop->ExecuteEvent( &m_step );
+}
+
+
+void FastShowerModel::kill( G4FastStep &fastStep ) const
+{
+  // Do not propose any deposit here, otherwise the stepping action would see the full 
+  // shower energy in the trigger position
+  fastStep.KillPrimaryTrack();
+  fastStep.ProposePrimaryTrackPathLength( 0 );
+}
@@ -0,0 +1,49 @@
+
+#include "G4Kernel/FrozenShowerModel.h"
+#include "G4PhysicalConstants.hh"
+#include "Randomize.hh"
+#include <cmath>
+
+using namespace ShowerLib;
+
+
+FrozenShowerModel::FrozenShowerModel( std::string name, G4Region *envelope, std::shared_ptr<const ShowerLibrary> library ):
+  FastShowerModel( name, envelope ),
+  m_library( library ),
+  m_region( envelope->GetName() )
+{;}
+
+
+FrozenShowerModel::~FrozenShowerModel()
+{;}
+
+
+G4bool FrozenShowerModel::ModelTrigger( const G4FastTrack &fastTrack )
+{
+  const G4Track *track = fastTrack.GetPrimaryTrack();
+  return m_library->contains( m_region, track->GetParticleDefinition()->GetPDGEncoding(), track->GetKineticEnergy() );
+}
+
+
+void FrozenShowerModel::DoIt( const G4FastTrack &fastTrack, G4FastStep &fastStep )
+{
+  const G4Track *track = fastTrack.GetPrimaryTrack();
+  double energy = track->GetKineticEnergy();
+  const shower_t *shower = m_library->find( m_region, track->GetParticleDefinition()->GetPDGEncoding(), energy );
+
+  const G4ThreeVector &origin = track->GetPosition();
+  const G4ThreeVector &dir    = track->GetMomentumDirection();
+  // Random rotation around the direction
+  double phi = twopi*G4UniformRand();
+  G4ThreeVector a = dir.orthogonal().unit();
+  G4ThreeVector b = dir.cross(a);
+  G4ThreeVector u = a*std::cos(phi) + b*std::sin(phi);
+  G4ThreeVector v = dir.cross(u);
+  double time = track->GetGlobalTime();
+
+  for ( const auto &hit : shower->hits ){
+    deposit( track, origin + dir*hit.l + u*hit.u + v*hit.v, time + hit.t, hit.e*energy );
+  }
+
+  kill( fastStep );
+}
@@ -1,5 +1,6 @@
 
 #include "G4Kernel/RunManager.h"
+#include "G4Kernel/StepReplay.h"
 #include "G4Kernel/ParticleGun.h"
 #include "G4Kernel/PrimaryGenerator.h"
 
@@ -12,6 +13,7 @@
 
 
 #pragma link C++ class RunManager+;
+#pragma link C++ class StepReplay+;
 #pragma link C++ class ParticleGun+;
 #pragma link C++ class PrimaryGenerator+;
 
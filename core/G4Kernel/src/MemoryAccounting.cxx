@@ -0,0 +1,102 @@
+
+#include "G4Kernel/MemoryAccounting.h"
+#include "TTree.h"
+#include <algorithm>
+#include <fstream>
+#include <unistd.h>
+
+
+MemoryAccounting::MemoryAccounting():
+  IMsgService("MemoryAccounting")
+{;}
+
+
+size_t MemoryAccounting::rss() const
+{
+  // The second field of statm is the number of resident pages
+  size_t pages=0, resident=0;
+  std::ifstream statm("/proc/self/statm");
+  if( !(statm >> pages >> resident) ) return 0;
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+
+void MemoryAccounting::add( footprint_t &f, size_t bytes )
+{
+  f.peak = std::max( f.peak, bytes );
+  f.sum += bytes;
+  f.nevents++;
+}
+
+
+void MemoryAccounting::BeginOfEvent()
+{
+  m_rssBegin.push_back( rss() );
+}
+
+
+void MemoryAccounting::EndOfEvent( const SG::EventContext &ctx, const std::vector<Gaugi::Algorithm*> &algs )
+{
+  for ( const auto &it : ctx.memory() )
+    add( m_keys[it.first], it.second );
+
+  for ( const auto alg : algs )
+    add( m_algs[alg->name()], alg->memory() );
+
+  m_rssEnd.push_back( rss() );
+}
+
+
+void MemoryAccounting::write( SG::StoreGate &store )
+{
+  store.mkdir( "MemoryAccounting" );
+
+  {
+    std::string name, type;
+    unsigned long long peak;
+    double average;
+    TTree *tree = new TTree( "footprint", "" );
+    tree->Branch( "name"    , &name     );
+    tree->Branch( "type"    , &type     );
+    tree->Branch( "peak"    , &peak     );
+    tree->Branch( "average" , &average  );
+    store.add( tree );
+
+    auto fill = [&]( const std::map<std::string, footprint_t> &m, std::string t ){
+      for ( const auto &it : m ){
+        name    = it.first;
+        type    = t;
+        peak    = it.second.peak;
+        average = it.second.nevents ? it.second.sum/it.second.nevents : 0;
+        tree->Fill();
+        MSG_INFO( std::setw(10) << type << std::setw(25) << name << " peak = " << peak/1024.
+                  << " kB average = " << average/1024. << " kB" );
+      }
+    };
+
+    fill( m_keys, "key" );
+    fill( m_algs, "algorithm" );
+  }
+
+  {
+    int event;
+    unsigned long long rss_begin, rss_end;
+    TTree *tree = new TTree( "rss", "" );
+    tree->Branch( "event"     , &event      );
+    tree->Branch( "rss_begin" , &rss_begin  );
+    tree->Branch( "rss_end"   , &rss_end    );
+    store.add( tree );
+
+    size_t peak=0;
+    for ( unsigned i=0; i < m_rssEnd.size(); ++i ){
+      event     = i;
+      rss_begin = i < m_rssBegin.size() ? m_rssBegin[i] : 0;
+      rss_end   = m_rssEnd[i];
+      peak      = std::max( peak, m_rssEnd[i] );
+      tree->Fill();
+    }
+    MSG_INFO( "Peak RSS sampled at the end of the events: " << peak/(1024.*1024.) << " MB" );
+  }
+}
+
+
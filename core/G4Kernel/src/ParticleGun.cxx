@@ -12,7 +12,7 @@
 #include "G4ParticleDefinition.hh"
 #include "G4TransportationManager.hh"
 
-#include "G4Kernel/constants.h"
+#include "G4Kernel/TrackInformation.h"
 
 ParticleGun::ParticleGun( std::string name):
     IMsgService(name),
@@ -89,8 +89,8 @@ void ParticleGun::GeneratePrimaryVertex( G4Event* anEvent )
   m_gun->SetParticleTime( 0 );
   m_gun->SetParticleMomentumDirection(G4ThreeVector(pos.x(),pos.y(),pos.z()));
   m_gun->GeneratePrimaryVertex(anEvent);
-  m_gun->SetParticleTime( (special_bcid_for_truth_reconstruction * 25.) * c_light/mm );// in ns
-  m_gun->GeneratePrimaryVertex(anEvent);
+  // Simulated once. The truth deposits come from the main event tag
+  anEvent->GetPrimaryVertex( anEvent->GetNumberOfPrimaryVertex()-1 )->GetPrimary()->SetUserInformation( new PrimaryParticleInformation() );
 
   
   xAOD::seed_t seed{et, (float)pos.PseudoRapidity(), (float)pos.Phi(), (float)pos.x(), (float)pos.y(), (float)pos.z(), pdgid};
@@ -1,6 +1,8 @@
 
 
 #include "G4Kernel/PrimaryGeneratorAction.h"
+#include "G4Kernel/EventLoop.h"
+#include "G4RunManager.hh"
 #include "G4Event.hh"
 
 
@@ -25,6 +27,13 @@ PrimaryGeneratorAction::~PrimaryGeneratorAction()
 void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
 {
   if(m_generator){
+    // The events of the checkpoint are kept empty (no primaries)
+    EventLoop *loop = static_cast<EventLoop*>( G4RunManager::GetRunManager()->GetNonConstCurrentRun() );
+    if ( !loop->prepare( anEvent->GetEventID() ) ){
+      MSG_INFO( "Skipping the event " << anEvent->GetEventID() << " (done by the checkpointed run)" );
+      m_generator->skipEvent(anEvent);
+      return;
+    }
     MSG_INFO( "GeneratePrimaryVertex..." );
     m_generator->GeneratePrimaryVertex(anEvent);
   }else
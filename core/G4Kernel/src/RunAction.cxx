@@ -10,11 +10,11 @@
 
 #include <iostream>
 
-RunAction::RunAction( std::vector<Gaugi::Algorithm*> acc, std::string output )
+RunAction::RunAction( std::vector<Gaugi::Algorithm*> acc, const RunConfig &config )
  : IMsgService("RunAction"),
    G4UserRunAction(),
    m_acc(acc),
-   m_output(output)
+   m_config(config)
 {;}
 
 
@@ -27,7 +27,7 @@ RunAction::~RunAction()
 G4Run* RunAction::GenerateRun()
 {
   MSG_INFO("Creating the EventLoop...");
-  return new EventLoop(m_acc, m_output);
+  return new EventLoop(m_acc, m_config);
 }
 
 
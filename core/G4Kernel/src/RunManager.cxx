@@ -2,7 +2,9 @@
 
 #include "G4Kernel/RunManager.h"
 #include "G4Kernel/ActionInitialization.h"
+#include "G4Kernel/AllocAccounting.h"
 #include "GaugiKernel/Algorithm.h"
+#include "GaugiKernel/MetricsExporter.h"
 
 
 
@@ -13,15 +15,29 @@
 #endif
 #include "G4UImanager.hh"
 #include "G4UIcommand.hh"
-#include "FTFP_BERT.hh"
+#include "G4PhysListFactory.hh"
+#include "G4FastSimulationPhysics.hh"
+#include "G4StepLimiterPhysics.hh"
+#include "G4RegionStore.hh"
+#include "G4ProductionCuts.hh"
+#include "G4UserLimits.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
 #include "Randomize.hh"
 #include "G4VisExecutive.hh"
 #include "G4UIExecutive.hh"
+#include "TFile.h"
+#include "TTree.h"
 
 
 #include <iostream>
 #include "time.h"
 #include <cstdlib>
+#include <cfloat>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
 
 
 RunManager::RunManager( std::string name ): 
@@ -33,8 +49,62 @@ RunManager::RunManager( std::string name ):
 #ifdef G4MULTITHREADED
   declareProperty( "NumberOfThreads", m_nThreads=1              );
 #endif
-  declareProperty( "OutputFile"     , m_output="Example.root"   );
+  declareProperty( "OutputFile"     , m_config.output="Example.root"   );
   declareProperty( "RunVis"         , m_runVis=false            );
+  declareProperty( "UseStepAccounting", m_config.useStepAccounting=false );
+  // Readout window (in ns) used to split the step accounting. Default: LAr bunches from -24 to 5
+  declareProperty( "TimeWindow"     , m_config.timeWindow={-600.,150.} );
+  declareProperty( "UseMemoryAccounting", m_config.useMemoryAccounting=false );
+  // Need the LZT_ALLOC_COUNTING build. The guard is the max allocations per step for each algorithm. The run
+  // fails above it (-1 to only report)
+  declareProperty( "UseAllocAccounting", m_config.useAllocAccounting=false );
+  declareProperty( "AllocationGuard"   , m_config.allocGuard=-1           );
+  // Periodic progress snapshot (json lines or prometheus textfile). Disabled if empty
+  declareProperty( "MetricsFile"    , m_metricsFile=""          );
+  declareProperty( "MetricsFormat"  , m_metricsFormat="json"    );
+  declareProperty( "MetricsInterval", m_metricsInterval=30      );
+  // Geant4 master seed (zero is the clock system)
+  declareProperty( "Seed"           , m_seed=0                  );
+  // Flush the thread files and record their completed events each N events (zero is disabled). A resumed
+  // run takes the seed of the checkpoint and skips the completed events, kept in the <output>_ckpt<k> files
+  declareProperty( "CheckpointInterval", m_config.checkpointInterval=0 );
+  declareProperty( "Resume"         , m_resume=false            );
+  // Record all steps (one file per thread) to be replayed by the StepReplay. Disabled if empty
+  declareProperty( "StepRecordFile"     , m_config.stepRecordFile=""         );
+  declareProperty( "StepRecordEventKey" , m_config.stepRecordKey="EventInfo" );
+  // Register the fast simulation process for e+/e-/gamma (set when the detector has fast simulation models)
+  declareProperty( "UseFastSimulation"  , m_useFastSimulation=false   );
+  // Build the frozen shower library (one file per thread) for the e+/e-/gamma inside the energy bins (MeV)
+  declareProperty( "ShowerLibraryFile"      , m_config.showerLibraryFile=""                        );
+  declareProperty( "ShowerLibraryRegions"   , m_config.showerLibraryRegions={"EM1","EM2","EM3"}    );
+  declareProperty( "ShowerLibraryBins"      , m_config.showerLibraryBins={10,20,50,100,200,500,1000} );
+  declareProperty( "ShowerLibraryMaxShowers", m_config.showerLibraryMaxShowers=200                 );
+  // Reference physics list (any name known by the G4PhysListFactory) and the default range cut (mm)
+  declareProperty( "PhysicsList"          , m_physicsList="FTFP_BERT" );
+  declareProperty( "DefaultCut"           , m_defaultCut=0.7          );
+  // Range cut (mm) for gamma, e-, e+ and proton in each region
+  declareProperty( "ProductionCutRegions" , m_cutRegions={}           );
+  declareProperty( "ProductionCuts"       , m_cuts={}                 );
+  // G4UserLimits for each region: max step (mm), max track time (ns) and min kinetic energy (MeV). Zero is no limit
+  declareProperty( "UserLimitRegions"     , m_limitRegions={}         );
+  declareProperty( "MaxStepLength"        , m_maxStepLength={}        );
+  declareProperty( "MaxTrackTime"         , m_maxTrackTime={}         );
+  declareProperty( "MinKineticEnergy"     , m_minKineticEnergy={}     );
+  // Kill the tracks that can not reach any readout sample. The max time (ns) is the end of the latest
+  // readout window ((BunchIdEnd+1)*25 ns of the tile) and the envelope (mm) covers the ATLAS calorimeter.
+  // New tracks of the particles (pdg) below the min kinetic energy (MeV) are killed too. Zero is no cut
+  declareProperty( "UseTrackTriage"       , m_config.useTrackTriage=false    );
+  declareProperty( "TriageMaxTime"        , m_config.triageMaxTime=200       );
+  declareProperty( "TriageMaxRadius"      , m_config.triageMaxRadius=4500    );
+  declareProperty( "TriageMaxZ"           , m_config.triageMaxZ=7000         );
+  declareProperty( "KillNeutrinos"        , m_config.killNeutrinos=true      );
+  declareProperty( "TriageParticles"      , m_config.triageParticles={}      );
+  declareProperty( "TriageMinEnergy"      , m_config.triageMinEnergy={}      );
+  // RoI mode: kill the tracks outside of Delta R around the event seeds (zero is disabled). Below the min
+  // radius (mm, the start of the dead material before the calorimeter) the track direction is used instead
+  declareProperty( "RoIDeltaR"            , m_config.roiDeltaR=0             );
+  declareProperty( "RoIMinRadius"         , m_config.roiMinRadius=1100       );
+  declareProperty( "RoIEventKey"          , m_config.roiEventKey="EventInfo" );
 
 }
 
@@ -73,7 +143,11 @@ void RunManager::run( int evt )
   G4Random::setTheEngine(new CLHEP::RanecuEngine);
 
   //G4long seed = abs(((time(NULL) * 181) * ((getpid() - 83) * 359)) % 104729);
-  G4long seed = abs(((time(NULL) * 181) * ((83) * 359)) % 104729);
+  G4long seed = m_seed > 0 ? m_seed : abs(((time(NULL) * 181) * ((83) * 359)) % 104729);
+  // The master draws the seeds of each event in order, so the seed and the completed events are
+  // all the random state needed to resume
+  prepareCheckpoint( seed );
+  MSG_INFO( "Using the seed " << seed );
   CLHEP::HepRandom::setTheSeed(seed);
 
   // Construct the default run manager
@@ -95,12 +169,42 @@ void RunManager::run( int evt )
   }
 
 
-  G4VModularPhysicsList* physicsList = new FTFP_BERT;
+  G4PhysListFactory factory;
+  if ( !factory.IsReferencePhysList( m_physicsList ) ){
+    MSG_FATAL( "The physics list " << m_physicsList << " is not available." );
+  }
+  MSG_INFO( "Using the physics list " << m_physicsList << " with default cut of " << m_defaultCut << " mm" );
+  G4VModularPhysicsList* physicsList = factory.GetReferencePhysList( m_physicsList );
+  physicsList->SetDefaultCutValue( m_defaultCut*mm );
+  if ( !m_limitRegions.empty() ){
+    // Needed to apply the max step and the special cuts (time and energy) of the G4UserLimits
+    physicsList->RegisterPhysics( new G4StepLimiterPhysics() );
+  }
+  if ( m_useFastSimulation ){
+    MSG_INFO( "Activating the fast simulation for e+, e- and gamma" );
+    G4FastSimulationPhysics* fastSimulationPhysics = new G4FastSimulationPhysics();
+    fastSimulationPhysics->ActivateFastSimulation("e-");
+    fastSimulationPhysics->ActivateFastSimulation("e+");
+    fastSimulationPhysics->ActivateFastSimulation("gamma");
+    physicsList->RegisterPhysics( fastSimulationPhysics );
+  }
   runManager->SetUserInitialization(physicsList);
 
   MSG_INFO( "Creating the action initalizer..." );
-  MSG_INFO( m_output );
-  ActionInitialization* actionInitialization = new ActionInitialization(m_generator, m_acc, m_output);
+  MSG_INFO( m_config.output );
+  if ( m_config.useStepAccounting && m_config.timeWindow.size()!=2 ){
+    MSG_FATAL( "The TimeWindow property must be [tmin, tmax] in ns." );
+  }
+  if ( m_config.useTrackTriage ){
+    MSG_INFO( "Track triage enabled: max time = " << m_config.triageMaxTime << " ns, max radius = " << m_config.triageMaxRadius
+              << " mm, max |z| = " << m_config.triageMaxZ << " mm, kill neutrinos = " << m_config.killNeutrinos );
+    for ( unsigned i=0; i < m_config.triageParticles.size() && i < m_config.triageMinEnergy.size(); ++i )
+      MSG_INFO( "Track triage: kill new tracks of " << m_config.triageParticles[i] << " below " << m_config.triageMinEnergy[i] << " MeV" );
+  }
+  if ( m_config.roiDeltaR > 0 ){
+    MSG_INFO( "RoI simulation mode: kill the tracks outside of Delta R = " << m_config.roiDeltaR << " around the seeds" );
+  }
+  ActionInitialization* actionInitialization = new ActionInitialization(m_generator, m_acc, m_config);
   runManager->SetUserInitialization(actionInitialization);
 
   MSG_INFO( "Creating the vis executive...");
@@ -110,14 +214,22 @@ void RunManager::run( int evt )
 
   std::stringstream runCommand; runCommand << "/run/beamOn " << evt ;
 
+  std::unique_ptr<Gaugi::MetricsExporter> metrics;
+  if ( !m_metricsFile.empty() ){
+    metrics.reset( new Gaugi::MetricsExporter( getLogName(), m_metricsFile, m_metricsFormat, m_metricsInterval, evt ) );
+    metrics->start();
+  }
+
   if (!m_runVis ) {
     UImanager->ApplyCommand("/run/initialize");
+    configureRegions();
     UImanager->ApplyCommand("/run/printProgress 1");
     UImanager->ApplyCommand("/run/verbose 2");
     UImanager->ApplyCommand(runCommand.str());
   } else  {
     MSG_INFO("Apply my vis macro");
     UImanager->ApplyCommand("/run/initialize");
+    configureRegions();
     UImanager->ApplyCommand("/run/printProgress 1");
     UImanager->ApplyCommand("/run/verbose 2");
     UImanager->ApplyCommand("/control/execute "+ basepath+"/core/G4Kernel/data/vis.mac");
@@ -127,11 +239,236 @@ void RunManager::run( int evt )
   
   }
 
+  if ( metrics ) metrics->stop();
+
   delete runManager;
   delete visManager;
+
+  removeCheckpoint();
+
+  // The threads report the allocation guard when the event loops are destroyed
+  if ( AllocAccounting::violations() > 0 ){
+    MSG_FATAL( AllocAccounting::violations() << " algorithms allocate on the step path above the AllocationGuard." );
+  }
 }
 
 
 
+void RunManager::prepareCheckpoint( G4long &seed )
+{
+  // Same names of the thread files (see StoreGate)
+  std::string prefix = m_config.output;
+  for ( size_t pos; (pos = prefix.find(".root")) != std::string::npos; ) prefix.erase( pos, 5 );
+  m_config.checkpointPrefix = prefix;
+  m_config.completedEvents.clear();
+  m_checkpointParts.clear();
+  std::string record = prefix + ".checkpoint";
+
+  // Previous record: seed, thread files and part files (each one moved from a thread file)
+  G4long previousSeed = 0;
+  std::vector<std::string> threads;
+  std::vector<std::pair<std::string, std::string>> parts;
+  {
+    std::ifstream in( record );
+    std::string key, name, from;
+    while ( in >> key ){
+      if ( key == "seed" ) in >> previousSeed;
+      else if ( key == "thread" && in >> name ) threads.push_back( name );
+      else if ( key == "part" && in >> name >> from ) parts.push_back( std::make_pair( name, from ) );
+    }
+  }
+
+  auto exists = []( const std::string &path ){ return std::ifstream( path ).good(); };
+
+  if ( !m_resume || !previousSeed ){
+    if ( m_resume ) MSG_WARNING( "There is no checkpoint in " << record << ". Starting from the first event." );
+    // Leftovers of a killed run with the same output
+    for ( const auto &part : parts ){
+      std::remove( (part.first + ".root").c_str() );
+      std::remove( (part.first + ".checkpoint").c_str() );
+    }
+    for ( const auto &thread : threads ) std::remove( (thread + ".checkpoint").c_str() );
+    std::remove( record.c_str() );
+    parts.clear();
+    if ( m_config.checkpointInterval <= 0 ) return;
+  }else{
+    seed = previousSeed;
+    // The thread files hold the events of their checkpoint. They become parts of this run, recorded
+    // before they are moved
+    auto taken = [&]( const std::string &name ){
+      if ( exists( name + ".root" ) ) return true;
+      for ( const auto &part : parts ) if ( part.first == name ) return true;
+      return false;
+    };
+    for ( const auto &thread : threads ){
+      if ( !exists( thread + ".checkpoint" ) || !exists( thread + ".root" ) ) continue;
+      // Not the names of the partial merges of the OutputMerger (_part<k>)
+      unsigned k = parts.size();
+      while ( taken( prefix + "_ckpt" + std::to_string(k) ) ) ++k;
+      parts.push_back( std::make_pair( prefix + "_ckpt" + std::to_string(k), thread ) );
+    }
+  }
 
+  // The record of this run
+  std::vector<std::string> names;
+#ifdef G4MULTITHREADED
+  for ( int thread = 0; thread < m_nThreads; ++thread ) names.push_back( prefix + "_" + std::to_string(thread) );
+#else
+  names.push_back( prefix );
+#endif
+  auto write = [&]( const std::vector<std::pair<std::string, std::string>> &parts ){
+    std::string tmp = record + ".tmp";
+    {
+      std::ofstream out( tmp );
+      out << "seed " << seed << "\n";
+      for ( const auto &name : names ) out << "thread " << name << "\n";
+      for ( const auto &part : parts ) out << "part " << part.first << " " << part.second << "\n";
+    }
+    std::rename( tmp.c_str(), record.c_str() );
+  };
+  write( parts );
+
+  // Move the thread files (or finish the moves of a resume killed here) and take the completed
+  // events of all parts
+  std::vector<std::pair<std::string, std::string>> valid;
+  for ( const auto &part : parts ){
+    if ( !exists( part.first + ".checkpoint" ) ){
+      std::rename( (part.second + ".root").c_str(), (part.first + ".root").c_str() );
+      std::rename( (part.second + ".checkpoint").c_str(), (part.first + ".checkpoint").c_str() );
+    }
+    std::vector<int> events;
+    if ( !readCheckpoint( part.first, events ) ){
+      MSG_WARNING( "The file " << part.first << ".root does not match its checkpoint. Its events will be simulated again." );
+      std::remove( (part.first + ".root").c_str() );
+      std::remove( (part.first + ".checkpoint").c_str() );
+      continue;
+    }
+    m_config.completedEvents.insert( m_config.completedEvents.end(), events.begin(), events.end() );
+    m_checkpointParts.push_back( part.first + ".root" );
+    valid.push_back( part );
+  }
+  // Without the dropped parts, that would take the thread files of the next runs
+  if ( valid.size() != parts.size() ) write( valid );
+  // The files of this run start without checkpoint
+  for ( const auto &thread : threads ) std::remove( (thread + ".checkpoint").c_str() );
+  for ( const auto &name : names ) std::remove( (name + ".checkpoint").c_str() );
+  if ( !m_checkpointParts.empty() ){
+    MSG_INFO( "Resuming with the seed " << seed << ". " << m_config.completedEvents.size() << " events were done in "
+              << m_checkpointParts.size() << " files." );
+  }
+}
+
+
+bool RunManager::readCheckpoint( const std::string &name, std::vector<int> &events )
+{
+  TFile *file = TFile::Open( (name + ".root").c_str(), "READ" );
+  if ( !file || file->IsZombie() ){
+    delete file;
+    return false;
+  }
+
+  // Each line: entries <n> (<tree> <entries>)... events <n> <event>... end. The last line can be
+  // incomplete if the job was killed while writing it
+  std::ifstream in( name + ".checkpoint" );
+  std::vector<int> recorded;
+  bool matched = false;
+  std::string line;
+  while ( std::getline( in, line ) ){
+    std::istringstream ss( line );
+    std::string key, path;
+    size_t ntrees = 0, nevents = 0;
+    long long entries = 0;
+    int evt;
+    if ( !( ss >> key >> ntrees ) || key != "entries" ) break;
+    bool match = true;
+    for ( size_t i = 0; i < ntrees && ss >> path >> entries; ++i ){
+      TTree *tree = (TTree*)file->Get( path.c_str() );
+      match = match && tree && tree->GetEntries() == entries;
+    }
+    if ( !( ss >> key >> nevents ) || key != "events" ) break;
+    std::vector<int> added;
+    for ( size_t i = 0; i < nevents && ss >> evt; ++i ) added.push_back( evt );
+    if ( !( ss >> key ) || key != "end" || added.size() != nevents ) break;
+    recorded.insert( recorded.end(), added.begin(), added.end() );
+    // The latest flush that reached the file
+    if ( match ){
+      events = recorded;
+      matched = true;
+    }
+  }
+  file->Close();
+  delete file;
+  return matched;
+}
+
+
+void RunManager::removeCheckpoint()
+{
+  const std::string &prefix = m_config.checkpointPrefix;
+  std::string record = prefix + ".checkpoint";
+  std::ifstream in( record );
+  if ( !in.good() ) return;
+  std::string key, name, from;
+  while ( in >> key ){
+    if ( key == "thread" && in >> name ) std::remove( (name + ".checkpoint").c_str() );
+    else if ( key == "part" && in >> name >> from ) std::remove( (name + ".checkpoint").c_str() );
+  }
+  in.close();
+  std::remove( record.c_str() );
+}
+
+
+void RunManager::configureRegions()
+{
+  // The regions only exist after the geometry construction, but the cuts must be there before the
+  // physics tables are built (first beamOn). Both lists must have the same size of the regions.
+  if ( m_cuts.size() != m_cutRegions.size() ){
+    MSG_FATAL( "The ProductionCuts must have one value for each region in ProductionCutRegions." );
+  }
+  auto value = []( const std::vector<float> &values, unsigned i ){ return i < values.size() ? values[i] : 0; };
+  auto *store = G4RegionStore::GetInstance();
+
+  for ( unsigned i=0; i < m_cutRegions.size(); ++i ){
+    G4Region *region = store->GetRegion( m_cutRegions[i], false );
+    if ( !region ){
+      MSG_WARNING( "There is no region with name " << m_cutRegions[i] << ". Skipping the production cut." );
+      continue;
+    }
+    auto *cuts = new G4ProductionCuts();
+    cuts->SetProductionCut( m_cuts[i]*mm );
+    region->SetProductionCuts( cuts );
+  }
+
+  for ( unsigned i=0; i < m_limitRegions.size(); ++i ){
+    G4Region *region = store->GetRegion( m_limitRegions[i], false );
+    if ( !region ){
+      MSG_WARNING( "There is no region with name " << m_limitRegions[i] << ". Skipping the user limits." );
+      continue;
+    }
+    double maxStep = value( m_maxStepLength, i ) > 0 ? value( m_maxStepLength, i )*mm : DBL_MAX;
+    // The global time of the tracks is in mm/c (the vertex times are prod_t + bc_id*25*c_light),
+    // so the limit in ns is converted as the readout time of the triage and the cells
+    double maxTime = value( m_maxTrackTime, i ) > 0 ? value( m_maxTrackTime, i )*ns*c_light/mm : DBL_MAX;
+    double minEkin = value( m_minKineticEnergy, i )*MeV;
+    region->SetUserLimits( new G4UserLimits( maxStep, DBL_MAX, maxTime, minEkin ) );
+    MSG_INFO( "User limits for " << m_limitRegions[i] << ": max step = " << value( m_maxStepLength, i ) 
+              << " mm, max time = " << value( m_maxTrackTime, i ) << " ns, min ekin = " << minEkin/MeV
+              << " MeV (zero is no limit)" );
+  }
+
+  // Report the final configuration of all regions
+  MSG_INFO( "Region configuration (cuts in mm for gamma/e-/e+/proton):" );
+  for ( auto *region : *store ){
+    std::stringstream ss;
+    ss << std::setw(25) << region->GetName() << " cuts = ";
+    G4ProductionCuts *cuts = region->GetProductionCuts();
+    if ( cuts ){
+      for ( int p=0; p < 4; ++p ) ss << (p ? "/" : "") << cuts->GetProductionCut(p)/mm;
+    }else{
+      ss << "default";
+    }
+    if ( region->GetUserLimits() ) ss << " (with user limits)";
+    MSG_INFO( ss.str() );
+  }
+}
 
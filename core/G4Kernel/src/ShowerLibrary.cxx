@@ -0,0 +1,116 @@
+
+#include "G4Kernel/ShowerLibrary.h"
+#include "Randomize.hh"
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <mutex>
+
+using namespace ShowerLib;
+
+
+int ShowerLib::find_bin( const std::vector<float> &edges, float energy )
+{
+  if ( edges.size() < 2 || energy < edges.front() || energy >= edges.back() ) return -1;
+  return std::upper_bound( edges.begin(), edges.end(), energy ) - edges.begin() - 1;
+}
+
+
+ShowerLibrary::ShowerLibrary():
+  IMsgService("ShowerLibrary"),
+  m_nshowers(0)
+{;}
+
+
+bool ShowerLibrary::read( const std::string &path )
+{
+  std::ifstream file( path, std::ios::binary );
+  char buffer[sizeof(magic)];
+  uint32_t fversion=0, nedges=0;
+  file.read( buffer, sizeof(magic) );
+  file.read( reinterpret_cast<char*>(&fversion), sizeof(fversion) );
+  file.read( reinterpret_cast<char*>(&nedges), sizeof(nedges) );
+  if ( !file || std::memcmp( buffer, magic, sizeof(magic) ) || fversion != version ){
+    MSG_ERROR( "The file " << path << " is not a shower library file (version " << version << "). Skipping..." );
+    return false;
+  }
+  std::vector<float> edges( nedges );
+  file.read( reinterpret_cast<char*>(edges.data()), nedges*sizeof(float) );
+  if ( !m_edges.empty() && edges != m_edges ){
+    MSG_ERROR( "The energy bins of " << path << " do not match with the other files. Skipping..." );
+    return false;
+  }
+  m_edges = edges;
+
+  size_t nshowers=0;
+  uint32_t length=0;
+  while ( file.read( reinterpret_cast<char*>(&length), sizeof(length) ) )
+  {
+    std::string region( length, ' ' );
+    shower_t shower;
+    uint32_t nhits=0;
+    file.read( &region[0], length );
+    file.read( reinterpret_cast<char*>(&shower.pdg), sizeof(shower.pdg) );
+    file.read( reinterpret_cast<char*>(&shower.energy), sizeof(shower.energy) );
+    file.read( reinterpret_cast<char*>(&nhits), sizeof(nhits) );
+    shower.hits.resize( nhits );
+    file.read( reinterpret_cast<char*>(shower.hits.data()), nhits*sizeof(hit_t) );
+    if ( !file ){
+      MSG_WARNING( "The file " << path << " is truncated. Keeping " << nshowers << " showers." );
+      break;
+    }
+    int bin = find_bin( m_edges, shower.energy );
+    if ( bin < 0 ) continue;
+    auto &bins = m_showers[region][shower.pdg];
+    if ( bins.empty() ) bins.resize( m_edges.size()-1 );
+    bins[bin].push_back( std::move(shower) );
+    nshowers++;
+  }
+  m_nshowers += nshowers;
+  MSG_INFO( "Read " << nshowers << " showers from " << path );
+  return true;
+}
+
+
+std::shared_ptr<const ShowerLibrary> ShowerLibrary::load( const std::vector<std::string> &paths )
+{
+  static std::mutex mutex;
+  static std::map<std::vector<std::string>, std::weak_ptr<const ShowerLibrary>> cache;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto library = cache[paths].lock();
+  if ( !library ){
+    auto *lib = new ShowerLibrary();
+    for ( const auto &path : paths ) lib->read( path );
+    library.reset( lib );
+    cache[paths] = library;
+  }
+  return library;
+}
+
+
+const std::vector<shower_t>* ShowerLibrary::showers( const std::string &region, int pdg, float energy ) const
+{
+  int bin = find_bin( m_edges, energy );
+  if ( bin < 0 ) return nullptr;
+  auto r = m_showers.find( region );
+  if ( r == m_showers.end() ) return nullptr;
+  auto p = r->second.find( pdg );
+  if ( p == r->second.end() || p->second[bin].empty() ) return nullptr;
+  return &p->second[bin];
+}
+
+
+bool ShowerLibrary::contains( const std::string &region, int pdg, float energy ) const
+{
+  return showers( region, pdg, energy ) != nullptr;
+}
+
+
+const shower_t* ShowerLibrary::find( const std::string &region, int pdg, float energy ) const
+{
+  const auto *bin = showers( region, pdg, energy );
+  if ( !bin ) return nullptr;
+  size_t index = std::min( bin->size()-1, (size_t)( G4UniformRand()*bin->size() ) );
+  return &(*bin)[index];
+}
+
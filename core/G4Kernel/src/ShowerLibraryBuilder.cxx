@@ -0,0 +1,156 @@
+
+#include "G4Kernel/ShowerLibraryBuilder.h"
+#include "G4VPhysicalVolume.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Region.hh"
+#include "G4Electron.hh"
+#include "G4Positron.hh"
+#include "G4Gamma.hh"
+#include "G4Threading.hh"
+#include <algorithm>
+#include <cmath>
+
+using namespace ShowerLib;
+
+
+namespace{
+  // The deposits are merged in voxels much smaller than any cell to keep the library small
+  const float voxel_size = 1.0;  // mm
+  const float voxel_time = 0.5;  // ns
+}
+
+
+ShowerLibraryBuilder::ShowerLibraryBuilder( std::string path, std::vector<std::string> regions, std::vector<float> edges,
+                                            int maxShowers ):
+  IMsgService("ShowerLibraryBuilder"),
+  m_regions(regions),
+  m_edges(edges),
+  m_maxShowers(maxShowers),
+  m_nshowers(0)
+{
+  // Same index convention used by the StoreGate
+  int index = G4Threading::G4GetThreadId();
+  if ( index >= 0 ){
+    auto pos = path.rfind('.');
+    std::string suffix = "_" + std::to_string(index);
+    path = pos == std::string::npos ? path + suffix : path.substr(0,pos) + suffix + path.substr(pos);
+  }
+  if ( m_edges.size() < 2 || !std::is_sorted( m_edges.begin(), m_edges.end() ) ){
+    MSG_FATAL( "The shower library energy bins must be at least two increasing edges." );
+  }
+
+  MSG_INFO( "Writing the frozen showers into " << path );
+  m_file.open( path, std::ios::binary | std::ios::trunc );
+  if ( !m_file.is_open() ){
+    MSG_FATAL( "It's not possible to open the shower library file " << path );
+  }
+  m_file.write( magic, sizeof(magic) );
+  write( version );
+  write( (uint32_t)m_edges.size() );
+  m_file.write( reinterpret_cast<const char*>(m_edges.data()), m_edges.size()*sizeof(float) );
+}
+
+
+ShowerLibraryBuilder::~ShowerLibraryBuilder()
+{
+  MSG_INFO( "Written " << m_nshowers << " showers" );
+  m_file.close();
+}
+
+
+int ShowerLibraryBuilder::start( const G4Step *step )
+{
+  const G4Track *track = step->GetTrack();
+  const auto *particle = track->GetParticleDefinition();
+  if ( particle != G4Electron::Definition() && particle != G4Positron::Definition() && particle != G4Gamma::Definition() )
+    return -1;
+
+  // Same condition used by the fast simulation trigger: entering the envelope or created inside
+  const G4StepPoint *point = step->GetPreStepPoint();
+  if ( point->GetStepStatus() != fGeomBoundary && track->GetCurrentStepNumber() != 1 ) return -1;
+  const G4VPhysicalVolume *pv = point->GetPhysicalVolume();
+  if ( !pv ) return -1;
+  const std::string &region = pv->GetLogicalVolume()->GetRegion()->GetName();
+  if ( std::find( m_regions.begin(), m_regions.end(), region ) == m_regions.end() ) return -1;
+
+  float energy = point->GetKineticEnergy();
+  int bin = find_bin( m_edges, energy );
+  if ( bin < 0 ) return -1;
+  int &count = m_counts[ std::make_tuple( region, particle->GetPDGEncoding(), bin ) ];
+  if ( m_maxShowers > 0 && count >= m_maxShowers ) return -1;
+  count++;
+
+  root_t root;
+  root.region = region;
+  root.pdg    = particle->GetPDGEncoding();
+  root.energy = energy;
+  root.time   = point->GetGlobalTime();
+  root.pos    = point->GetPosition();
+  root.dir    = point->GetMomentumDirection();
+  root.u      = root.dir.orthogonal().unit();
+  root.v      = root.dir.cross( root.u );
+  m_roots.push_back( std::move(root) );
+  return m_roots.size()-1;
+}
+
+
+void ShowerLibraryBuilder::Fill( const G4Step *step )
+{
+  const G4Track *track = step->GetTrack();
+  int index = -1;
+  auto it = m_tracks.find( track->GetTrackID() );
+  if ( it != m_tracks.end() ){
+    index = it->second;
+  }else{
+    // The secondaries are only tracked after their parent, so the parent shower is already known.
+    // Secondaries created before the parent entered the region are not part of the shower
+    auto parent = m_tracks.find( track->GetParentID() );
+    if ( parent != m_tracks.end() && parent->second >= 0 &&
+         step->GetPreStepPoint()->GetGlobalTime() >= m_roots[parent->second].time )
+      index = parent->second;
+  }
+  if ( index < 0 ) index = start( step );
+  m_tracks[ track->GetTrackID() ] = index;
+
+  if ( index < 0 || step->GetTotalEnergyDeposit() <= 0 ) return;
+  const auto &root = m_roots[index];
+  const G4StepPoint *point = step->GetPreStepPoint();
+  G4ThreeVector d = point->GetPosition() - root.pos;
+  m_roots[index].hits.push_back( hit_t{ (float)d.dot(root.dir), (float)d.dot(root.u), (float)d.dot(root.v),
+                                        (float)(point->GetGlobalTime() - root.time),
+                                        (float)step->GetTotalEnergyDeposit() } );
+}
+
+
+void ShowerLibraryBuilder::EndOfEvent()
+{
+  for ( auto &root : m_roots )
+  {
+    // Merge the deposits inside of the same voxel (energy weighted position and time)
+    std::map<std::tuple<int,int,int,int>, hit_t> voxels;
+    for ( const auto &hit : root.hits ){
+      auto key = std::make_tuple( (int)std::floor(hit.l/voxel_size), (int)std::floor(hit.u/voxel_size),
+                                  (int)std::floor(hit.v/voxel_size), (int)std::floor(hit.t/voxel_time) );
+      auto &voxel = voxels[key];
+      voxel.l += hit.l*hit.e; voxel.u += hit.u*hit.e; voxel.v += hit.v*hit.e; voxel.t += hit.t*hit.e;
+      voxel.e += hit.e;
+    }
+    std::vector<hit_t> hits;
+    hits.reserve( voxels.size() );
+    for ( const auto &it : voxels ){
+      const auto &voxel = it.second;
+      hits.push_back( hit_t{ voxel.l/voxel.e, voxel.u/voxel.e, voxel.v/voxel.e, voxel.t/voxel.e, voxel.e/root.energy } );
+    }
+
+    write( (uint32_t)root.region.size() );
+    m_file.write( root.region.data(), root.region.size() );
+    write( (int32_t)root.pdg );
+    write( root.energy );
+    write( (uint32_t)hits.size() );
+    m_file.write( reinterpret_cast<const char*>(hits.data()), hits.size()*sizeof(hit_t) );
+    m_nshowers++;
+  }
+  m_roots.clear();
+  m_tracks.clear();
+}
+
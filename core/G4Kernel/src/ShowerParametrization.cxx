@@ -0,0 +1,143 @@
+
+#include "G4Kernel/ShowerParametrization.h"
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4Material.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
+#include "Randomize.hh"
+#include "CLHEP/Random/RandGamma.h"
+#include <functional>
+#include <cmath>
+#include <map>
+
+
+ShowerParametrization::ShowerParametrization( std::string name, G4Region *envelope, float minEnergy, float maxEnergy ):
+  FastShowerModel( name, envelope ),
+  m_minEnergy( minEnergy ),
+  m_maxEnergy( maxEnergy ),
+  m_x0(0), m_rm(0), m_z(0), m_ec(0)
+{
+  computeMedium( envelope );
+}
+
+
+ShowerParametrization::~ShowerParametrization()
+{;}
+
+
+G4bool ShowerParametrization::ModelTrigger( const G4FastTrack &fastTrack )
+{
+  double energy = fastTrack.GetPrimaryTrack()->GetKineticEnergy();
+  // The fluctuation parametrization is only valid well above the critical energy
+  return m_x0 > 0 && energy >= m_minEnergy && energy <= m_maxEnergy && energy > 10*m_ec;
+}
+
+
+void ShowerParametrization::computeMedium( G4Region *envelope )
+{
+  // Volume of each material inside the envelope (without the daughters)
+  std::map<const G4Material*, double> volumes;
+  std::function<void(G4LogicalVolume*)> walk = [&]( G4LogicalVolume *lv ){
+    double volume = lv->GetSolid()->GetCubicVolume();
+    for ( int d=0; d < (int)lv->GetNoDaughters(); ++d ){
+      G4LogicalVolume *daughter = lv->GetDaughter(d)->GetLogicalVolume();
+      volume -= daughter->GetSolid()->GetCubicVolume();
+      walk( daughter );
+    }
+    if ( volume > 0 ) volumes[ lv->GetMaterial() ] += volume;
+  };
+
+  auto it = envelope->GetRootLogicalVolumeIterator();
+  for ( size_t i=0; i < envelope->GetNumberOfRootVolumes(); ++i, ++it )
+    walk( *it );
+
+  // The vacuum between the layers is ignored
+  double total=0, mass=0;
+  for ( const auto &v : volumes ){
+    if ( v.first->GetState() == kStateGas ) continue;
+    total += v.second;
+    mass  += v.second * v.first->GetDensity();
+  }
+  if ( total <= 0 ){
+    MSG_ERROR( "There is no dense material inside of the region " << envelope->GetName() << ". The model is disabled." );
+    return;
+  }
+
+  // Effective medium of the sampling calorimeter (same as the GFlash sampling parametrization)
+  double inv_x0=0, ec_over_x0=0;
+  for ( const auto &v : volumes ){
+    const G4Material *mat = v.first;
+    if ( mat->GetState() == kStateGas ) continue;
+    double fraction = v.second/total;
+    double weight   = v.second * mat->GetDensity() / mass;
+    double z  = mat->GetTotNbOfElectPerVolume() / mat->GetTotNbOfAtomsPerVolume();
+    double ec = 610*MeV/( z + 1.24 );
+    inv_x0     += fraction / mat->GetRadlen();
+    ec_over_x0 += weight * ec / mat->GetRadlen();
+    m_z        += weight * z;
+  }
+  m_x0 = 1./inv_x0;
+  m_ec = m_x0 * ec_over_x0;
+  m_rm = 21.2052*MeV * m_x0 / m_ec;
+
+  MSG_INFO( "Effective medium of " << envelope->GetName() << ": X0 = " << m_x0/mm << " mm, RM = " << m_rm/mm
+            << " mm, Z = " << m_z << ", Ec = " << m_ec/MeV << " MeV" );
+}
+
+
+void ShowerParametrization::DoIt( const G4FastTrack &fastTrack, G4FastStep &fastStep )
+{
+  const G4Track *track = fastTrack.GetPrimaryTrack();
+  double energy = track->GetKineticEnergy();
+  double lny  = std::log( energy/m_ec );
+  double lnE  = std::log( energy/GeV );
+
+  // Longitudinal profile (photons are treated as electrons, as in GFlash)
+  double meanLnT  = std::log( lny - 0.812 );
+  double sigmaLnT = 1./( -1.4 + 1.26*lny );
+  double meanLnA  = std::log( 0.81 + ( 0.458 + 2.26/m_z )*lny );
+  double sigmaLnA = 1./( -0.58 + 0.86*lny );
+  double rho      = 0.705 - 0.023*lny;
+  double z1 = G4RandGauss::shoot(), z2 = G4RandGauss::shoot();
+  double tmax  = std::exp( meanLnT + sigmaLnT*z1 );
+  double alpha = std::max( 1.01, std::exp( meanLnA + sigmaLnA*( rho*z1 + std::sqrt( 1-rho*rho )*z2 ) ) );
+  double beta  = ( alpha-1 )/tmax;
+
+  // Radial profile (in Moliere radius units) as function of tau = t/tmax
+  double rc1 = 0.0251 + 0.00319*lnE,  rc2 = 0.1162 - 0.000381*m_z;
+  double k1  = 0.659 - 0.00309*m_z,   k2  = 0.645, k3 = -2.59, k4 = 0.3585 + 0.0421*lnE;
+  double p1  = 0.2632 - 0.00094*m_z,  p2  = 0.401 + 0.00187*m_z, p3 = 1.313 - 0.0686*lnE;
+  const double rmax = 5.;
+
+  int nspots = std::max( 1, (int)( 93*std::log(m_z)*std::pow( energy/GeV, 0.876 ) ) );
+  double espot = energy/nspots;
+
+  const G4ThreeVector &origin = track->GetPosition();
+  const G4ThreeVector &dir    = track->GetMomentumDirection();
+  G4ThreeVector u = dir.orthogonal().unit();
+  G4ThreeVector v = dir.cross(u);
+  double time = track->GetGlobalTime();
+
+  for ( int i=0; i < nspots; ++i )
+  {
+    double t   = CLHEP::RandGamma::shoot( G4Random::getTheEngine(), alpha, beta );
+    double tau = t/tmax;
+    double rc  = rc1 + rc2*tau;
+    double rt  = k1*( std::exp( k3*(tau-k2) ) + std::exp( k4*(tau-k2) ) );
+    double arg = ( p2-tau )/p3;
+    double p   = std::min( 1., std::max( 0., p1*std::exp( arg - std::exp(arg) ) ) );
+    double R   = G4UniformRand() < p ? rc : rt;
+    // Inverse of the (truncated) cumulative of 2rR^2/(r^2+R^2)^2
+    double w   = G4UniformRand() * rmax*rmax/( rmax*rmax + R*R );
+    double r   = R*std::sqrt( w/(1-w) );
+    double phi = twopi*G4UniformRand();
+
+    G4ThreeVector pos = origin + dir*( t*m_x0 ) + ( u*std::cos(phi) + v*std::sin(phi) )*( r*m_rm );
+    deposit( track, pos, time + t*m_x0/c_light, espot );
+  }
+
+  kill( fastStep );
+}
+
+
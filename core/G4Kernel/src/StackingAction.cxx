@@ -0,0 +1,34 @@
+
+#include "G4Kernel/EventLoop.h"
+#include "G4Kernel/StackingAction.h"
+
+#include "G4Track.hh"
+#include "G4RunManager.hh"
+
+
+StackingAction::StackingAction( std::shared_ptr<TrackTriage> triage )
+  : IMsgService("StackingAction"),
+    G4UserStackingAction(),
+    m_triage(triage)
+{;}
+
+
+StackingAction::~StackingAction()
+{;}
+
+
+
+void StackingAction::PrepareNewEvent()
+{
+  // Called before the primaries are stacked, when the event info is already in the context
+  EventLoop* loop = static_cast<EventLoop*> (G4RunManager::GetRunManager()->GetNonConstCurrentRun());
+  if ( loop->skipped() ) return;
+  m_triage->BeginOfEvent( loop->getContext() );
+}
+
+
+G4ClassificationOfNewTrack StackingAction::ClassifyNewTrack(const G4Track* track)
+{
+  return m_triage->classify( track ) == TrackTriage::KEEP ? fUrgent : fKill;
+}
+
@@ -0,0 +1,109 @@
+
+#include "G4Kernel/StepAccounting.h"
+#include "G4Region.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4SystemOfUnits.hh"
+#include "TTree.h"
+#include <ctime>
+
+
+StepAccounting::StepAccounting( float tmin, float tmax ):
+  IMsgService("StepAccounting"),
+  m_tmin(tmin),
+  m_tmax(tmax),
+  m_lastTime(0)
+{
+  m_lastTime = cputime();
+}
+
+
+double StepAccounting::cputime() const
+{
+  timespec ts;
+  clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts );
+  return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+
+bool StepAccounting::inWindow( double t ) const
+{
+  t = t*mm/c_light; // mm to ns (same convention used by RawCell)
+  return ( t >= m_tmin && t < m_tmax );
+}
+
+
+void StepAccounting::PreTracking( const G4Track *track )
+{
+  const G4Region *region = track->GetVolume() ? track->GetVolume()->GetLogicalVolume()->GetRegion() : nullptr;
+  key_t key( region, track->GetParticleDefinition(), inWindow(track->GetGlobalTime()) );
+  m_counters[key].tracks++;
+  // Do not charge the time between tracks to the first step
+  m_lastTime = cputime();
+}
+
+
+void StepAccounting::Fill( const G4Step *step )
+{
+  const G4StepPoint *point = step->GetPreStepPoint();
+  const G4Region *region = point->GetPhysicalVolume() ? point->GetPhysicalVolume()->GetLogicalVolume()->GetRegion() : nullptr;
+  key_t key( region, step->GetTrack()->GetParticleDefinition(), inWindow(point->GetGlobalTime()) );
+
+  // The time spent since the last callback is charged to this step
+  double now = cputime();
+  auto &counter = m_counters[key];
+  counter.steps++;
+  counter.edep += step->GetTotalEnergyDeposit()/MeV;
+  counter.cputime += now - m_lastTime;
+  m_lastTime = now;
+}
+
+
+void StepAccounting::write( SG::StoreGate &store )
+{
+  std::string region, particle;
+  bool in_window;
+  unsigned long long steps, tracks;
+  double cputime, edep;
+
+  store.mkdir( "StepAccounting" );
+  TTree *tree = new TTree( "step_accounting", "" );
+  tree->Branch( "region"    , &region     );
+  tree->Branch( "particle"  , &particle   );
+  tree->Branch( "in_window" , &in_window  );
+  tree->Branch( "steps"     , &steps      );
+  tree->Branch( "tracks"    , &tracks     );
+  tree->Branch( "cputime"   , &cputime    );
+  tree->Branch( "edep"      , &edep       );
+  store.add( tree );
+
+  std::map<std::string, counter_t> regions;
+
+  for ( const auto &it : m_counters )
+  {
+    region    = std::get<0>(it.first) ? std::get<0>(it.first)->GetName() : "Unknown";
+    particle  = std::get<1>(it.first) ? std::get<1>(it.first)->GetParticleName() : "Unknown";
+    in_window = std::get<2>(it.first);
+    steps     = it.second.steps;
+    tracks    = it.second.tracks;
+    cputime   = it.second.cputime;
+    edep      = it.second.edep;
+    tree->Fill();
+
+    auto &r = regions[region];
+    r.steps   += steps;
+    r.tracks  += tracks;
+    r.cputime += cputime;
+    r.edep    += edep;
+  }
+
+  for ( const auto &it : regions )
+  {
+    MSG_INFO( std::setw(25) << it.first << " steps = " << it.second.steps << " tracks = " << it.second.tracks
+              << " cpu = " << it.second.cputime << " s edep = " << it.second.edep << " MeV" );
+  }
+}
+
+
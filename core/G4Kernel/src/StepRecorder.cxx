@@ -0,0 +1,92 @@
+
+#include "G4Kernel/StepRecorder.h"
+#include "G4Kernel/TrackInformation.h"
+#include "EventInfo/EventInfoContainer.h"
+#include "G4VPhysicalVolume.hh"
+#include "G4Threading.hh"
+
+using namespace StepRecord;
+
+
+StepRecorder::StepRecorder( std::string path, std::string eventKey ):
+  IMsgService("StepRecorder"),
+  m_eventKey(eventKey),
+  m_nevents(0)
+{
+  // Same index convention used by the StoreGate
+  int index = G4Threading::G4GetThreadId();
+  if ( index >= 0 ){
+    auto pos = path.rfind('.');
+    std::string suffix = "_" + std::to_string(index);
+    path = pos == std::string::npos ? path + suffix : path.substr(0,pos) + suffix + path.substr(pos);
+  }
+
+  MSG_INFO( "Recording all steps into " << path );
+  m_file.open( path, std::ios::binary | std::ios::trunc );
+  if ( !m_file.is_open() ){
+    MSG_FATAL( "It's not possible to open the step record file " << path );
+  }
+  m_file.write( magic, sizeof(magic) );
+  write( version );
+}
+
+
+StepRecorder::~StepRecorder()
+{
+  MSG_INFO( "Recorded " << m_nevents << " events" );
+  m_file.close();
+}
+
+
+void StepRecorder::Fill( const G4Step *step )
+{
+  const G4StepPoint *point = step->GetPreStepPoint();
+  const G4VPhysicalVolume *pv = point->GetPhysicalVolume();
+  uint32_t volume = 0;
+  if ( pv ){
+    auto it = m_volumes.find( pv->GetName() );
+    if ( it == m_volumes.end() ){
+      // zero is reserved for steps without volume
+      it = m_volumes.emplace( pv->GetName(), m_volumes.size()+1 ).first;
+      m_newVolumes.push_back( pv->GetName() );
+    }
+    volume = it->second;
+  }
+  if ( TrackInformation::fromMainEvent( step->GetTrack() ) ) volume |= main_event_bit;
+  const G4ThreeVector &pos = point->GetPosition();
+  m_steps.push_back( step_record_t{ pos.x(), pos.y(), pos.z(), point->GetGlobalTime(), 
+                                    (float)step->GetTotalEnergyDeposit(), volume } );
+}
+
+
+void StepRecorder::EndOfEvent( SG::EventContext &ctx )
+{
+  SG::ReadHandle<xAOD::EventInfoContainer> event( m_eventKey, ctx );
+  if( !event.isValid() ){
+    MSG_FATAL( "It's not possible to read the xAOD::EventInfoContainer from this Context using this key: " << m_eventKey );
+  }
+  const auto *evt = (**event.ptr()).front();
+  auto seeds = evt->allSeeds();
+
+  write( marker );
+  write( (int32_t)evt->eventNumber() );
+  write( (float)evt->avgmu() );
+  write( (int32_t)evt->interactions() );
+  write( (int32_t)evt->totalEnergy() );
+  write( (uint32_t)seeds.size() );
+  for ( const auto &seed : seeds ) write( seed );
+
+  write( (uint32_t)m_newVolumes.size() );
+  for ( const auto &name : m_newVolumes ){
+    write( m_volumes[name] );
+    write( (uint32_t)name.size() );
+    m_file.write( name.data(), name.size() );
+  }
+  m_newVolumes.clear();
+
+  write( (uint64_t)m_steps.size() );
+  m_file.write( reinterpret_cast<const char*>(m_steps.data()), m_steps.size()*sizeof(step_record_t) );
+  m_steps.clear();
+  m_nevents++;
+}
+
@@ -0,0 +1,148 @@
+
+#include "G4Kernel/StepReplay.h"
+#include "G4Kernel/StepRecorder.h"
+#include "G4Kernel/EventLoop.h"
+#include "G4Kernel/TrackInformation.h"
+#include "EventInfo/EventInfoContainer.h"
+#include "G4Step.hh"
+#include <fstream>
+#include <cstring>
+
+using namespace StepRecord;
+
+
+
+StepReplay::StepReplay( std::string name ): 
+  IMsgService( name ),
+  PropertyService()
+{
+  declareProperty( "InputFiles"     , m_inputFiles={}           );
+  declareProperty( "OutputFile"     , m_output="Example.root"   );
+  declareProperty( "EventKey"       , m_eventKey="EventInfo"    );
+}
+
+StepReplay::~StepReplay()
+{;}
+
+
+void StepReplay::push_back( Gaugi::Algorithm *alg )
+{
+  m_acc.push_back( alg );
+}
+
+
+void StepReplay::run( int evt )
+{
+  for ( auto toolHandle : m_acc ){ 
+    MSG_INFO( "Initializing the tool with name " << toolHandle->name() );
+    if ( toolHandle->initialize().isFailure() ){
+      MSG_ERROR("It's not possible to initialize the tool with name: " << toolHandle->name() );
+    }
+  } 
+
+  // Same event loop used by the simulation. Must be destroyed before the finalize
+  RunConfig config;
+  config.output = m_output;
+  auto *loop = new EventLoop( m_acc, config );
+
+  // Reused by all steps. Only the pre step point is filled
+  G4Step step;
+  G4StepPoint *point = step.GetPreStepPoint();
+  // Only carry the main event tag of the recorded steps (the track deletes its information)
+  G4Track mainTrack;
+  mainTrack.SetUserInformation( new TrackInformation() );
+  int nevents = 0;
+
+  for ( const auto &path : m_inputFiles )
+  {
+    std::ifstream file( path, std::ios::binary );
+    char buffer[sizeof(magic)];
+    uint32_t fversion=0;
+    file.read( buffer, sizeof(magic) );
+    file.read( reinterpret_cast<char*>(&fversion), sizeof(fversion) );
+    if ( !file || std::memcmp( buffer, magic, sizeof(magic) ) || ( fversion < 1 || fversion > version ) ){
+      MSG_ERROR( "The file " << path << " is not a step record file (version " << version << "). Skipping..." );
+      continue;
+    }
+    MSG_INFO( "Replaying steps from " << path );
+    if ( fversion < 3 ){
+      MSG_WARNING( "The file " << path << " has no number of interactions (version " << fversion << "). Its events have zero interactions." );
+    }
+
+    std::vector<step_record_t> steps;
+    auto read = [&file]( void *ptr, size_t size ){ file.read( reinterpret_cast<char*>(ptr), size ); return bool(file); };
+
+    uint32_t m;
+    while ( ( evt < 0 || nevents < evt ) && read( &m, sizeof(m) ) )
+    {
+      if ( m != marker ){
+        MSG_ERROR( "Corrupted event block in " << path << ". Stop reading this file." );
+        break;
+      }
+      int32_t eventNumber, interactions=0, totalEnergy;
+      float avgmu;
+      uint32_t nseeds, nvolumes;
+      uint64_t nsteps;
+      read( &eventNumber, sizeof(eventNumber) );
+      read( &avgmu, sizeof(avgmu) );
+      if ( fversion > 2 ) read( &interactions, sizeof(interactions) );
+      read( &totalEnergy, sizeof(totalEnergy) );
+      read( &nseeds, sizeof(nseeds) );
+
+      // Record the event info as done by the generator
+      {
+        SG::WriteHandle<xAOD::EventInfoContainer> event( m_eventKey, loop->getContext() );
+        event.record( std::unique_ptr<xAOD::EventInfoContainer>( new xAOD::EventInfoContainer() ) );
+        auto *info = new xAOD::EventInfo();
+        info->setEventNumber( eventNumber );
+        info->setAvgmu( avgmu );
+        info->setInteractions( interactions );
+        info->setTotalEnergy( totalEnergy );
+        for ( uint32_t i=0; i < nseeds; ++i ){
+          xAOD::seed_t seed;
+          read( &seed, sizeof(seed) );
+          info->push_back( seed );
+        }
+        event->push_back( info );
+      }
+
+      // The volume names are not used by the replay
+      read( &nvolumes, sizeof(nvolumes) );
+      for ( uint32_t i=0; i < nvolumes; ++i ){
+        uint32_t id, length;
+        read( &id, sizeof(id) );
+        read( &length, sizeof(length) );
+        file.seekg( length, std::ios::cur );
+      }
+
+      read( &nsteps, sizeof(nsteps) );
+      steps.resize( nsteps );
+      if ( !read( steps.data(), nsteps*sizeof(step_record_t) ) ){
+        MSG_ERROR( "Truncated event block in " << path << ". Stop reading this file." );
+        loop->getContext().clear();
+        break;
+      }
+
+      loop->BeginOfEvent();
+      for ( const auto &s : steps ){
+        point->SetPosition( G4ThreeVector( s.x, s.y, s.z ) );
+        point->SetGlobalTime( s.time );
+        step.SetTotalEnergyDeposit( s.edep );
+        step.SetTrack( fversion > 1 && ( s.volume & main_event_bit ) ? &mainTrack : nullptr );
+        loop->ExecuteEvent( &step );
+      }
+      loop->EndOfEvent();
+      nevents++;
+    }
+  }
+
+  MSG_INFO( "Replayed " << nevents << " events" );
+  delete loop;
+
+  for ( auto toolHandle : m_acc ){
+    if ( toolHandle->finalize().isFailure() ){
+      MSG_ERROR("It's not possible to finalize the tool with name: " << toolHandle->name() );
+    }
+  }
+}
+
@@ -6,9 +6,10 @@
 #include "G4RunManager.hh"
 
 
-SteppingAction::SteppingAction()
+SteppingAction::SteppingAction( std::shared_ptr<TrackTriage> triage )
   : IMsgService("SteppingAction"),
-    G4UserSteppingAction()
+    G4UserSteppingAction(),
+    m_triage(triage)
 {;}
 
 
@@ -21,6 +22,11 @@ void SteppingAction::UserSteppingAction(const G4Step* step)
 {
   EventLoop* loop = static_cast<EventLoop*> (G4RunManager::GetRunManager()->GetNonConstCurrentRun()); 
   loop->ExecuteEvent(step); 
+
+  // The deposit of this step is already in the loop, only the next steps are dropped
+  G4Track *track = step->GetTrack();
+  if ( m_triage && track->GetTrackStatus() == fAlive && m_triage->check( step ) != TrackTriage::KEEP )
+    track->SetTrackStatus( fStopAndKill );
 }
 
 
@@ -0,0 +1,35 @@
+
+#include "G4Kernel/TrackInformation.h"
+#include "G4ios.hh"
+
+
+PrimaryParticleInformation::PrimaryParticleInformation():
+  G4VUserPrimaryParticleInformation()
+{;}
+
+
+PrimaryParticleInformation::~PrimaryParticleInformation()
+{;}
+
+
+void PrimaryParticleInformation::Print() const
+{
+  G4cout << "Main event primary" << G4endl;
+}
+
+
+
+TrackInformation::TrackInformation():
+  G4VUserTrackInformation("MainEvent")
+{;}
+
+
+TrackInformation::~TrackInformation()
+{;}
+
+
+void TrackInformation::Print() const
+{
+  G4cout << "Main event track" << G4endl;
+}
+
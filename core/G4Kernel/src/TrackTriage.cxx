@@ -0,0 +1,131 @@
+
+#include "G4Kernel/TrackTriage.h"
+#include "G4Kernel/CaloPhiRange.h"
+#include "EventInfo/EventInfoContainer.h"
+#include "G4ParticleDefinition.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+
+namespace{
+  const char* names[TrackTriage::NREASONS] = { "neutrino", "time", "envelope", "energy", "roi" };
+
+  // mm to ns (same convention used by RawCell)
+  double readout_time( double t )
+  {
+    return t*mm/c_light;
+  }
+
+  bool is_neutrino( int pdg )
+  {
+    pdg = std::abs(pdg);
+    return pdg == 12 || pdg == 14 || pdg == 16;
+  }
+}
+
+
+TrackTriage::TrackTriage( const RunConfig &config ):
+  IMsgService("TrackTriage"),
+  m_maxTime( config.useTrackTriage ? config.triageMaxTime : 0 ),
+  m_maxRadius( config.useTrackTriage ? config.triageMaxRadius : 0 ),
+  m_maxZ( config.useTrackTriage ? config.triageMaxZ : 0 ),
+  m_killNeutrinos( config.useTrackTriage && config.killNeutrinos ),
+  m_roiDeltaR( config.roiDeltaR ),
+  m_roiMinRadius( config.roiMinRadius ),
+  m_eventKey( config.roiEventKey ),
+  m_total(0)
+{
+  if ( config.triageParticles.size() != config.triageMinEnergy.size() ){
+    MSG_FATAL( "The TriageMinEnergy must have one value for each particle in TriageParticles." );
+  }
+  if ( config.useTrackTriage ){
+    for ( unsigned i=0; i < config.triageParticles.size(); ++i )
+      m_minEnergy[ config.triageParticles[i] ] = config.triageMinEnergy[i];
+  }
+  for ( int r=0; r < NREASONS; ++r ){
+    m_stacked[r] = 0;
+    m_stepped[r] = 0;
+  }
+}
+
+
+TrackTriage::~TrackTriage()
+{
+  unsigned long long killed=0;
+  std::stringstream ss;
+  for ( int r=0; r < NREASONS; ++r ){
+    killed += m_stacked[r] + m_stepped[r];
+    ss << " " << names[r] << " = " << m_stacked[r] << "/" << m_stepped[r];
+  }
+  MSG_INFO( "Killed " << killed << " tracks (" << m_total << " new tracks). Stacking/stepping:" << ss.str() );
+}
+
+
+TrackTriage::Reason TrackTriage::count( Reason reason, bool stacking )
+{
+  if ( reason != KEEP ) ( stacking ? m_stacked : m_stepped )[reason]++;
+  return reason;
+}
+
+
+void TrackTriage::BeginOfEvent( SG::EventContext &ctx )
+{
+  m_seeds.clear();
+  if ( m_roiDeltaR <= 0 ) return;
+  SG::ReadHandle<xAOD::EventInfoContainer> event( m_eventKey, ctx );
+  if( !event.isValid() ){
+    MSG_FATAL( "It's not possible to read the xAOD::EventInfoContainer from this Context using this key: " << m_eventKey );
+  }
+  for ( const auto &seed : (**event.ptr()).front()->allSeeds() )
+    m_seeds.push_back( std::make_pair( seed.eta, seed.phi ) );
+  if ( m_seeds.empty() ){
+    MSG_WARNING( "There is no seed in this event. The RoI triage is disabled for it." );
+  }
+}
+
+
+bool TrackTriage::outside( const G4ThreeVector &v ) const
+{
+  if ( m_seeds.empty() ) return false;
+  float eta = v.eta(), phi = v.phi();
+  for ( const auto &seed : m_seeds ){
+    float deta = eta - seed.first;
+    float dphi = CaloPhiRange::diff( phi, seed.second );
+    if ( deta*deta + dphi*dphi < m_roiDeltaR*m_roiDeltaR ) return false;
+  }
+  return true;
+}
+
+
+TrackTriage::Reason TrackTriage::classify( const G4Track *track )
+{
+  m_total++;
+  int pdg = track->GetParticleDefinition()->GetPDGEncoding();
+  if ( m_killNeutrinos && is_neutrino(pdg) ) return count( NEUTRINO, true );
+  if ( m_maxTime > 0 && readout_time( track->GetGlobalTime() ) > m_maxTime ) return count( TIME, true );
+  const G4ThreeVector &pos = track->GetPosition();
+  if ( ( m_maxRadius > 0 && pos.perp() > m_maxRadius*mm ) || ( m_maxZ > 0 && std::abs(pos.z()) > m_maxZ*mm ) )
+    return count( ENVELOPE, true );
+  // Near the vertex the position says nothing about where the track goes
+  if ( m_roiDeltaR > 0 && outside( pos.perp() > m_roiMinRadius*mm ? pos : track->GetMomentumDirection() ) )
+    return count( ROI, true );
+  auto it = m_minEnergy.find( pdg );
+  if ( it != m_minEnergy.end() && track->GetKineticEnergy() < it->second*MeV ) return count( ENERGY, true );
+  return KEEP;
+}
+
+
+TrackTriage::Reason TrackTriage::check( const G4Step *step )
+{
+  const G4StepPoint *point = step->GetPostStepPoint();
+  if ( m_maxTime > 0 && readout_time( point->GetGlobalTime() ) > m_maxTime ) return count( TIME, false );
+  const G4ThreeVector &pos = point->GetPosition();
+  if ( ( m_maxRadius > 0 && pos.perp() > m_maxRadius*mm ) || ( m_maxZ > 0 && std::abs(pos.z()) > m_maxZ*mm ) )
+    return count( ENVELOPE, false );
+  if ( m_roiDeltaR > 0 && pos.perp() > m_roiMinRadius*mm && outside( pos ) ) return count( ROI, false );
+  return KEEP;
+}
+
@@ -0,0 +1,46 @@
+
+#include "G4Kernel/EventLoop.h"
+#include "G4Kernel/TrackingAction.h"
+#include "G4Kernel/TrackInformation.h"
+
+#include "G4Track.hh"
+#include "G4TrackingManager.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4RunManager.hh"
+
+
+TrackingAction::TrackingAction()
+  : IMsgService("TrackingAction"),
+    G4UserTrackingAction()
+{;}
+
+
+TrackingAction::~TrackingAction()
+{;}
+
+
+
+void TrackingAction::PreUserTrackingAction(const G4Track* track)
+{
+  if ( track->GetParentID() == 0 && !track->GetUserInformation() ){
+    const G4PrimaryParticle *primary = track->GetDynamicParticle()->GetPrimaryParticle();
+    if ( primary && primary->GetUserInformation() )
+      const_cast<G4Track*>(track)->SetUserInformation( new TrackInformation() );
+  }
+
+  EventLoop* loop = static_cast<EventLoop*> (G4RunManager::GetRunManager()->GetNonConstCurrentRun());
+  loop->PreTracking(track);
+}
+
+
+void TrackingAction::PostUserTrackingAction(const G4Track* track)
+{
+  if ( !TrackInformation::fromMainEvent( track ) ) return;
+  G4TrackVector *secondaries = fpTrackingManager->GimmeSecondaries();
+  if ( !secondaries ) return;
+  for ( auto *secondary : *secondaries ){
+    if ( !secondary->GetUserInformation() )
+      secondary->SetUserInformation( new TrackInformation() );
+  }
+}
+
@@ -30,6 +30,9 @@ namespace Gaugi{
 
       /*! set the store gate service */
       void setStoreGateSvc( SG::StoreGate * );
+
+      /*! Approximated memory footprint (in bytes) owned by the tool */
+      virtual size_t memory() const;
     
 
     protected:
@@ -49,6 +49,9 @@ namespace Gaugi{
 
       /*! set the store gate service */
       void setStoreGateSvc( SG::StoreGate * );
+
+      /*! Approximated memory footprint (in bytes) owned by the algorithm */
+      virtual size_t memory() const;
     
     protected:
       
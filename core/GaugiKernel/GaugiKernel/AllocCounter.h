@@ -0,0 +1,29 @@
+#ifndef AllocCounter_h
+#define AllocCounter_h
+
+/*
+ * @file AllocCounter.h
+ * @brief Per thread heap allocation counters. The global operator new/delete
+ *        are only replaced when the library is compiled with LZT_ALLOC_COUNTING
+ *        (cmake -DLZT_ALLOC_COUNTING=ON). Otherwise all counters stay at zero.
+ */
+
+
+namespace Gaugi{
+
+  struct alloc_t{
+    unsigned long long count=0;
+    unsigned long long bytes=0;
+  };
+
+  namespace AllocCounter{
+
+    /*! True if the library was compiled with the allocation counting */
+    bool enabled();
+
+    /*! Number of allocations and bytes requested by the current thread so far */
+    alloc_t snapshot();
+  }
+
+}
+#endif
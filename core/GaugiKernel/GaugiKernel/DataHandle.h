@@ -15,6 +15,8 @@ namespace SG{
     public:
       DataHandle()=default;
       virtual ~DataHandle(){};
+      /*! Approximated memory footprint (in bytes) of this container */
+      virtual size_t memory() const { return sizeof(*this); };
 
   };
 
@@ -37,6 +39,9 @@ namespace SG{
       template<class T> const T* get( std::string &sgkey );
 
       void clear();
+
+      /*! Approximated memory footprint (in bytes) for each recorded key */
+      std::map<std::string, size_t> memory() const;
         
     private:
 
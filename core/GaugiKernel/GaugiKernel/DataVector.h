@@ -10,6 +10,13 @@
 namespace SG
 {
 
+  /*! Use the object memory() method when available, otherwise only its size */
+  template<class T> 
+  inline auto object_memory( const T* obj, int ) -> decltype( obj->memory() ) { return obj->memory(); }
+  template<class T> 
+  inline size_t object_memory( const T*, long ) { return sizeof(T); }
+
+
   template<class T>
   class DataVector : public DataHandle{  
     public:
@@ -29,6 +36,9 @@ namespace SG
 
       const std::vector<const T*>& operator*() const;
 
+      /*! Approximated memory footprint (in bytes) of the container and its objects */
+      virtual size_t memory() const override;
+
 
     private:
 
@@ -66,6 +76,15 @@ namespace SG
   {
     return m_data;
   }
+
+  template<class T>
+  size_t DataVector<T>::memory() const
+  {
+    size_t bytes = sizeof(*this) + m_data.capacity()*sizeof(const T*);
+    for ( auto obj : m_data )
+      if(obj) bytes += object_memory( obj, 0 );
+    return bytes;
+  }
 }
 #endif
 
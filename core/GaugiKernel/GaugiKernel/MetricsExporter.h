@@ -0,0 +1,102 @@
+#ifndef MetricsExporter_h
+#define MetricsExporter_h
+
+/*
+ * @file MetricsExporter.h
+ * @brief Periodic progress and throughput snapshots for long jobs. A background
+ *        thread wakes up every N seconds and dumps a JSON line (appended) or a
+ *        Prometheus textfile (atomically replaced) with the events per thread,
+ *        events/s, steps/s, queue depths, RSS and ETA. The workers only touch
+ *        their own counters (relaxed atomics, one cache line per thread).
+ *        The loop_elapsed field counts from the first event, so it does not
+ *        include the initialization of the job.
+ */
+
+#include "GaugiKernel/MsgStream.h"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <string>
+#include <map>
+
+
+namespace Gaugi{
+
+  /*! Counters owned by a single worker */
+  struct alignas(64) metric_counter_t{
+    std::atomic<unsigned long long> events{0};
+    std::atomic<unsigned long long> steps{0};
+  };
+
+  /*! Increment by the owner thread only (no locked instruction) */
+  inline void increment( std::atomic<unsigned long long> &c, unsigned long long n=1 )
+  {
+    c.store( c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed );
+  }
+
+
+  class MetricsExporter : public MsgService
+  {
+    public:
+
+      /*! Constructor. format must be "json" or "prometheus" and interval is in seconds */
+      MetricsExporter( std::string job, std::string path, std::string format, float interval,
+                       unsigned long long totalEvents );
+
+      /*! Destructor. Stop the thread and write the last snapshot */
+      ~MetricsExporter();
+
+      /*! Start the exporter thread and become the current instance */
+      void start();
+
+      /*! Stop the exporter thread and write the last snapshot */
+      void stop();
+
+      /*! Get (or create) the counters for a given worker id */
+      metric_counter_t* counter( int id );
+
+      /*! Mark the start of the event loop. Only the first call (of any worker) is kept */
+      void startEventLoop();
+
+      /*! Add a gauge (e.g. queue depth) to be polled by the exporter thread */
+      void addGauge( std::string name, std::function<double()> gauge );
+
+      /*! The current running exporter (nullptr if disabled) */
+      static MetricsExporter* instance();
+
+
+    private:
+
+      void loop();
+      void write( double now );
+      size_t rss() const;
+
+      std::string m_job;
+      std::string m_path;
+      std::string m_format;
+      float m_interval;
+      unsigned long long m_totalEvents;
+
+      std::map<int, std::unique_ptr<metric_counter_t>> m_counters;
+      std::map<std::string, std::function<double()>> m_gauges;
+      std::mutex m_mutex;
+
+      std::thread m_thread;
+      std::mutex m_waitMutex;
+      std::condition_variable m_cv;
+      bool m_running;
+
+      double m_start;
+      std::atomic<double> m_loopStart;
+      double m_lastTime;
+      unsigned long long m_lastEvents;
+      unsigned long long m_lastSteps;
+
+      static std::atomic<MetricsExporter*> s_instance;
+  };
+
+}
+#endif
@@ -44,6 +44,13 @@ namespace SG
       
       /** Get 2D pointer **/
       TTree* tree( std::string );
+
+      /** Write all objects into the file (replacing the previous ones) so the file can be 
+       *  read back if the job is killed (checkpoint) **/
+      void flush();
+
+      /** Number of entries of each tree, by path in the file (without the leading slash) **/
+      std::map<std::string, long long> entries() const;
   
     private:
 
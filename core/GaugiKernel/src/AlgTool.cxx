@@ -32,3 +32,9 @@ const std::string& AlgTool::name() const
 }
 
 
+
+
+size_t AlgTool::memory() const
+{
+  return 0;
+}
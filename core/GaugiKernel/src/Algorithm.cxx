@@ -24,5 +24,10 @@ const std::string& Algorithm::name() const
   return getLogName();
 }
 
+size_t Algorithm::memory() const
+{
+  return 0;
+}
+
 
 
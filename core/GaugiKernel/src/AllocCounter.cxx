@@ -0,0 +1,68 @@
+
+#include "GaugiKernel/AllocCounter.h"
+#include <cstdlib>
+#include <new>
+
+using namespace Gaugi;
+
+
+#ifdef LZT_ALLOC_COUNTING
+
+namespace{
+  // Plain old data to avoid any dynamic initialization inside of operator new
+  thread_local unsigned long long t_count = 0;
+  thread_local unsigned long long t_bytes = 0;
+
+  inline void* counted_malloc( std::size_t size )
+  {
+    t_count++;
+    t_bytes+=size;
+    void *ptr = std::malloc( size ? size : 1 );
+    if(!ptr) throw std::bad_alloc();
+    return ptr;
+  }
+}
+
+void* operator new( std::size_t size ){ return counted_malloc(size); }
+void* operator new[]( std::size_t size ){ return counted_malloc(size); }
+void* operator new( std::size_t size, const std::nothrow_t& ) noexcept
+{
+  try{ return counted_malloc(size); }catch(...){ return nullptr; }
+}
+void* operator new[]( std::size_t size, const std::nothrow_t& ) noexcept
+{
+  try{ return counted_malloc(size); }catch(...){ return nullptr; }
+}
+void operator delete( void *ptr ) noexcept { std::free(ptr); }
+void operator delete[]( void *ptr ) noexcept { std::free(ptr); }
+void operator delete( void *ptr, std::size_t ) noexcept { std::free(ptr); }
+void operator delete[]( void *ptr, std::size_t ) noexcept { std::free(ptr); }
+
+
+bool AllocCounter::enabled()
+{
+  return true;
+}
+
+
+alloc_t AllocCounter::snapshot()
+{
+  alloc_t a; a.count=t_count; a.bytes=t_bytes;
+  return a;
+}
+
+#else
+
+bool AllocCounter::enabled()
+{
+  return false;
+}
+
+
+alloc_t AllocCounter::snapshot()
+{
+  return alloc_t();
+}
+
+#endif
+
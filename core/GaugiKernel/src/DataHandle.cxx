@@ -26,6 +26,15 @@ void EventContext::clear()
 }
 
 
+std::map<std::string, size_t> EventContext::memory() const
+{
+  std::map<std::string, size_t> footprint;
+  for ( const auto &it : m_storable_ptr )
+    footprint[it.first] = it.second ? it.second->memory() : 0;
+  return footprint;
+}
+
+
 
 
 
@@ -0,0 +1,202 @@
+
+#include "GaugiKernel/MetricsExporter.h"
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <unistd.h>
+
+using namespace Gaugi;
+
+
+std::atomic<MetricsExporter*> MetricsExporter::s_instance(nullptr);
+
+
+namespace{
+  double now_seconds()
+  {
+    return std::chrono::duration<double>( std::chrono::system_clock::now().time_since_epoch() ).count();
+  }
+}
+
+
+MetricsExporter::MetricsExporter( std::string job, std::string path, std::string format, float interval,
+                                  unsigned long long totalEvents ):
+  IMsgService("MetricsExporter"),
+  m_job(job),
+  m_path(path),
+  m_format(format),
+  m_interval(interval),
+  m_totalEvents(totalEvents),
+  m_running(false),
+  m_start(0),
+  m_loopStart(0),
+  m_lastTime(0),
+  m_lastEvents(0),
+  m_lastSteps(0)
+{
+  if ( m_format!="json" && m_format!="prometheus" ){
+    MSG_WARNING( "Unknown metrics format (" << m_format << "). Using json." );
+    m_format="json";
+  }
+  if ( m_interval <= 0 ) m_interval=10;
+}
+
+
+MetricsExporter::~MetricsExporter()
+{
+  stop();
+}
+
+
+MetricsExporter* MetricsExporter::instance()
+{
+  return s_instance.load();
+}
+
+
+void MetricsExporter::start()
+{
+  if ( m_running ) return;
+  MSG_INFO( "Writing metrics (" << m_format << ") into " << m_path << " every " << m_interval << " seconds" );
+  m_start = m_lastTime = now_seconds();
+  m_running = true;
+  s_instance.store(this);
+  m_thread = std::thread( &MetricsExporter::loop, this );
+}
+
+
+void MetricsExporter::stop()
+{
+  if ( !m_running ) return;
+  {
+    std::lock_guard<std::mutex> lock(m_waitMutex);
+    m_running = false;
+  }
+  m_cv.notify_all();
+  if ( m_thread.joinable() ) m_thread.join();
+  // last snapshot
+  write( now_seconds() );
+  MetricsExporter *self = this;
+  s_instance.compare_exchange_strong( self, nullptr );
+}
+
+
+metric_counter_t* MetricsExporter::counter( int id )
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto &c = m_counters[id];
+  if (!c) c.reset( new metric_counter_t() );
+  return c.get();
+}
+
+
+void MetricsExporter::startEventLoop()
+{
+  // Called at the begin of each event, so the clock is only read until the first one
+  if ( m_loopStart.load(std::memory_order_relaxed) > 0 ) return;
+  double zero = 0;
+  m_loopStart.compare_exchange_strong( zero, now_seconds() );
+}
+
+
+void MetricsExporter::addGauge( std::string name, std::function<double()> gauge )
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_gauges[name] = gauge;
+}
+
+
+void MetricsExporter::loop()
+{
+  std::unique_lock<std::mutex> lock(m_waitMutex);
+  while ( m_running ){
+    m_cv.wait_for( lock, std::chrono::duration<double>(m_interval), [this]{ return !m_running; } );
+    if ( !m_running ) break;
+    lock.unlock();
+    write( now_seconds() );
+    lock.lock();
+  }
+}
+
+
+size_t MetricsExporter::rss() const
+{
+  size_t pages=0, resident=0;
+  std::ifstream statm("/proc/self/statm");
+  if( !(statm >> pages >> resident) ) return 0;
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+
+void MetricsExporter::write( double now )
+{
+  std::map<int, unsigned long long> events_per_thread;
+  std::map<std::string, double> gauges;
+  unsigned long long events=0, steps=0;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for ( const auto &it : m_counters ){
+      unsigned long long n = it.second->events.load(std::memory_order_relaxed);
+      events_per_thread[it.first] = n;
+      events += n;
+      steps  += it.second->steps.load(std::memory_order_relaxed);
+    }
+    for ( const auto &it : m_gauges )
+      gauges[it.first] = it.second();
+  }
+
+  double dt = now - m_lastTime;
+  double events_per_second = dt > 0 ? (events - m_lastEvents)/dt : 0;
+  double steps_per_second  = dt > 0 ? (steps  - m_lastSteps )/dt : 0;
+  double elapsed = now - m_start;
+  double loop_start = m_loopStart.load();
+  double loop_elapsed = loop_start > 0 ? now - loop_start : 0;
+  // The ETA uses the average rate since the start to be more stable
+  double avg_rate = elapsed > 0 ? events/elapsed : 0;
+  double eta = ( avg_rate > 0 && m_totalEvents > events ) ? (m_totalEvents - events)/avg_rate : 0;
+  size_t rss_bytes = rss();
+  m_lastTime = now; m_lastEvents = events; m_lastSteps = steps;
+
+  std::stringstream ss;
+  if ( m_format == "json" ){
+    ss << "{\"time\": " << std::fixed << std::setprecision(3) << now << ", \"job\": \"" << m_job << "\""
+       << ", \"elapsed\": " << elapsed << ", \"loop_elapsed\": " << loop_elapsed << ", \"events\": " << events << ", \"total_events\": " << m_totalEvents
+       << ", \"events_per_thread\": {";
+    for ( auto it = events_per_thread.begin(); it != events_per_thread.end(); ++it )
+      ss << (it==events_per_thread.begin()?"":", ") << "\"" << it->first << "\": " << it->second;
+    ss << "}, \"events_per_second\": " << events_per_second << ", \"steps_per_second\": " << steps_per_second
+       << ", \"queues\": {";
+    for ( auto it = gauges.begin(); it != gauges.end(); ++it )
+      ss << (it==gauges.begin()?"":", ") << "\"" << it->first << "\": " << it->second;
+    ss << "}, \"rss_bytes\": " << rss_bytes << ", \"eta\": " << eta << "}\n";
+
+    std::ofstream out( m_path, std::ios::app );
+    out << ss.str();
+  }else{
+    std::string label = "job=\"" + m_job + "\"";
+    ss << "# TYPE lzt_events_total counter\n";
+    for ( const auto &it : events_per_thread )
+      ss << "lzt_events_total{" << label << ",thread=\"" << it.first << "\"} " << it.second << "\n";
+    ss << "# TYPE lzt_total_events gauge\n"       << "lzt_total_events{" << label << "} " << m_totalEvents << "\n";
+    ss << "# TYPE lzt_events_per_second gauge\n"  << "lzt_events_per_second{" << label << "} " << events_per_second << "\n";
+    ss << "# TYPE lzt_steps_per_second gauge\n"   << "lzt_steps_per_second{" << label << "} " << steps_per_second << "\n";
+    ss << "# TYPE lzt_queue_depth gauge\n";
+    for ( const auto &it : gauges )
+      ss << "lzt_queue_depth{" << label << ",queue=\"" << it.first << "\"} " << it.second << "\n";
+    ss << "# TYPE lzt_rss_bytes gauge\n"          << "lzt_rss_bytes{" << label << "} " << rss_bytes << "\n";
+    ss << "# TYPE lzt_eta_seconds gauge\n"        << "lzt_eta_seconds{" << label << "} " << eta << "\n";
+    ss << "# TYPE lzt_elapsed_seconds gauge\n"    << "lzt_elapsed_seconds{" << label << "} " << elapsed << "\n";
+    ss << "# TYPE lzt_loop_elapsed_seconds gauge\n" << "lzt_loop_elapsed_seconds{" << label << "} " << loop_elapsed << "\n";
+
+    // The textfile collector must never see a partial file
+    std::string tmp = m_path + ".tmp";
+    {
+      std::ofstream out( tmp, std::ios::trunc );
+      out << ss.str();
+    }
+    std::rename( tmp.c_str(), m_path.c_str() );
+  }
+}
+
+
@@ -28,7 +28,8 @@ StoreGate::StoreGate( std::string outputfile, int index):
 StoreGate::~StoreGate()
 {
   MSG_INFO( "Writing all root objects into the file" ); 
-  m_file->Write();
+  // Replace the objects of the last flush
+  m_file->Write( 0, TObject::kOverwrite );
   /*
   for( const auto &o : m_objs){
     //o.second->Write();
@@ -96,4 +97,24 @@ TTree* StoreGate::tree( std::string name )
 }
 
 
+std::map<std::string, long long> StoreGate::entries() const
+{
+  std::map<std::string, long long> entries;
+  for ( const auto &obj : m_objs ){
+    if ( !obj.second || !obj.second->InheritsFrom("TTree") ) continue;
+    std::string path = obj.first.substr( obj.first.find_first_not_of('/') );
+    entries[path] = ((TTree*)obj.second)->GetEntries();
+  }
+  return entries;
+}
+
+
+void StoreGate::flush()
+{
+  m_file->Write( 0, TObject::kOverwrite );
+  m_file->WriteStreamerInfo();
+  m_file->Flush();
+}
+
+
 
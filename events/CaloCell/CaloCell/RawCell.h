@@ -20,10 +20,14 @@ namespace xAOD{
 
       /** Destructor **/
       ~RawCell()=default;
-      /*! Fill the deposit energy into the cell */
-      void Fill( const G4Step * );
+      /*! Fill the deposit energy into the cell. The main event deposits are also kept as truth */
+      void Fill( const G4Step *, bool mainEvent=false );
+      /*! Add an energy deposit (pileup overlay) into the sample index. False if outside of the samples */
+      bool addEnergy( int sample, float edep );
       /** Zeroize the pulse/sample vectors **/
       void clear();
+      /** Approximated memory footprint (in bytes) including the owned vectors **/
+      size_t memory() const;
 
       /*! Cell eta center */
       PRIMITIVE_SETTER_AND_GETTER( float, m_eta, setEta, eta );
@@ -63,6 +67,10 @@ namespace xAOD{
       PRIMITIVE_SETTER_AND_GETTER( std::vector<float>, m_pulse, setPulse, pulse );
       /*! Time (in ns) for each bunch crossing */
       PRIMITIVE_SETTER_AND_GETTER( std::vector<float> , m_time , setTime , time   );
+      /*! Raw energy samples without copy (digitization) */
+      const std::vector<float>& rawEnergySamplesRef() const { return m_rawEnergySamples; };
+      /*! Pulse to be filled in place (digitization) */
+      std::vector<float>& pulseRef() { return m_pulse; };
     
     private:
  
@@ -58,7 +58,7 @@ void RawCell::clear()
 }
 
 
-void RawCell::Fill( const G4Step* step )
+void RawCell::Fill( const G4Step* step, bool mainEvent )
 {
   // Get total energy deposit
   float edep = (float)step->GetTotalEnergyDeposit();
@@ -75,15 +75,30 @@ void RawCell::Fill( const G4Step* step )
       break;
     }
   }
-  if ( t >= ( (m_bcid_truth-1)*m_bc_duration) && t < ((m_bcid_truth+1)*m_bc_duration))
+  // Old inputs with a second copy of the main event in the truth bunch
+  if ( t >= ( (m_bcid_truth-1)*m_bc_duration) && t < ((m_bcid_truth+1)*m_bc_duration)){
+    m_truthRawEnergy+=edep;
+    return;
+  }
+  m_rawEnergy+=edep;
+  // Same window used by the truth bunch, but around the main event bunch
+  if ( mainEvent && t >= -m_bc_duration && t < m_bc_duration )
     m_truthRawEnergy+=edep;
-  else
-    m_rawEnergy+=edep;
 }
 
 
+bool RawCell::addEnergy( int sample, float edep )
+{
+  if ( sample < 0 || sample >= (int)m_rawEnergySamples.size() ) return false;
+  m_rawEnergySamples[sample]+=edep;
+  m_rawEnergy+=edep;
+  return true;
+}
 
 
-
-
+size_t RawCell::memory() const
+{
+  return sizeof(*this) + m_hash.capacity() + 
+         ( m_rawEnergySamples.capacity() + m_time.capacity() + m_pulse.capacity() ) * sizeof(float);
+}
 
@@ -95,6 +95,8 @@ namespace xAOD{
       void clear();
       /*! Get all cells **/
       const std::vector<const xAOD::CaloCell*>& allCells() const;
+      /*! Approximated memory footprint (in bytes). Cells are not owned by the cluster */
+      size_t memory() const;
 
 
     private:
@@ -48,3 +48,9 @@ const std::vector<const xAOD::CaloCell*>& CaloCluster::allCells() const
 }
 
 
+size_t CaloCluster::memory() const
+{
+  return sizeof(*this) + m_container.capacity()*sizeof(const xAOD::CaloCell*);
+}
+
+
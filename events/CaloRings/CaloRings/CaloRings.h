@@ -25,6 +25,8 @@ namespace xAOD{
       void setCaloCluster( const xAOD::CaloCluster *clus ){ m_caloCluster=clus; };
       /*! Get the associated cluster to this CaloRings */
       const xAOD::CaloCluster* caloCluster() const { return m_caloCluster; };
+      /*! Approximated memory footprint (in bytes) */
+      size_t memory() const { return sizeof(*this) + m_rings.capacity()*sizeof(float); };
 
 
     private:
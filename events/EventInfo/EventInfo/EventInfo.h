@@ -28,6 +28,8 @@ namespace xAOD{
 
       /** Average mu from the pythia generator **/
       PRIMITIVE_SETTER_AND_GETTER( float, m_avgmu, setAvgmu, avgmu );
+      /** Number of minimum bias interactions in all bunch crossings (sum of bc_mu) **/
+      PRIMITIVE_SETTER_AND_GETTER( int, m_interactions, setInteractions, interactions );
       /** Event number form geant4 **/
       PRIMITIVE_SETTER_AND_GETTER( int, m_eventNumber, setEventNumber, eventNumber );
       /** The event total energy **/
@@ -42,12 +44,16 @@ namespace xAOD{
 
       size_t size() { return m_seed.size(); };
 
+      /** Approximated memory footprint (in bytes) **/
+      size_t memory() const { return sizeof(*this) + m_seed.capacity()*sizeof(seed_t); };
+
 
     private:
       
       float m_eventNumber;
       float m_totalEnergy;
       float m_avgmu;
+      int m_interactions;
       std::vector<seed_t> m_seed;
       
   };
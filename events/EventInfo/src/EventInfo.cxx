@@ -6,7 +6,8 @@ using namespace xAOD;
 EventInfo::EventInfo():
       m_eventNumber(0),
       m_totalEnergy(0),
-      m_avgmu(0)
+      m_avgmu(0),
+      m_interactions(0)
 {;}
 
 
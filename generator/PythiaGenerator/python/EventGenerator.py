@@ -10,6 +10,9 @@ class EventGenerator( Logger ):
   __allow_keys = [
                         "NumberOfEvents" ,
                         "MinbiasFile"    , 
+                        "InitCacheDir"   ,
+                        "CheckpointInterval",
+                        "Resume"         ,
                         "OutputFile"     , 
                         "EtaMax"         , 
                         "MinPt"          ,
@@ -22,8 +25,17 @@ class EventGenerator( Logger ):
                         "MinbiasDeltaEta", 
                         "MinbiasDeltaPhi",
                         "Seed"           ,
+                        "NumberOfThreads",
+                        "QueueSize"      ,
                         "OutputLevel"    ,
                         "UseWindow"      ,
+                        "FixedPileup"    ,
+                        "PoolSize"       ,
+                        "PoolMaxReuse"   ,
+                        "PoolFile"       ,
+                        "MetricsFile"    ,
+                        "MetricsFormat"  ,
+                        "MetricsInterval",
                       ]
 
 
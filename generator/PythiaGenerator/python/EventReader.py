@@ -10,6 +10,16 @@ class EventReader( Logger ):
   __allow_keys = [
                   "EventKey", 
                   "FileName",
+                  "InputFiles",
+                  "TreeName",
+                  "InputFormat",
+                  "SeedStatus",
+                  "SeedParticles",
+                  "SeedMinEt",
+                  "FirstEvent",
+                  "NumberOfEvents",
+                  "QueueSize",
+                  "CacheSize",
                   ]
 
 
@@ -25,11 +35,22 @@ class EventReader( Logger ):
     for key, value in kw.items():
       self.setProperty( key,value )
 
-    from ROOT import TFile, TTree
-    f = TFile( self.getProperty("FileName") )
-    t = f.Get("particles")
-    self.__nevents = t.GetEntries()
-    f.Close()
+    # Count the events of the chain inside of the range (same defaults of the core)
+    get = lambda key, default : getattr( self, '__' + key, default )
+    if get("InputFormat", "particles") != "particles":
+      # The HepMC files are not counted (no extra pass). The run stops at the end of the input
+      self.__nevents = get("NumberOfEvents", -1) if get("NumberOfEvents", -1) >= 0 else 2**31-1
+      return
+    from ROOT import TChain
+    t = TChain( get("TreeName", "particles") )
+    files = [get("FileName", "")] + list( get("InputFiles", []) )
+    for f in files:
+      if f: t.Add( f )
+    first = max( get("FirstEvent", 0), 0 )
+    last  = t.GetEntries()
+    if get("NumberOfEvents", -1) >= 0:
+      last = min( last, first + get("NumberOfEvents", -1) )
+    self.__nevents = max( last - first, 0 )
 
 
 
@@ -0,0 +1,56 @@
+__all__ = ["EventStream"]
+
+from Gaugi import Logger
+from Gaugi.messenger.macros import *
+from G4Kernel import treatPropertyValue
+
+
+class EventStream( Logger ):
+
+  __allow_keys = [
+                  "EventKey", 
+                  "QueueSize",
+                  ]
+
+
+  def __init__( self, name, generator, numberOfEvents, **kw ): 
+    
+    Logger.__init__(self)
+    import ROOT
+    ROOT.gSystem.Load('liblorenzett')
+    from ROOT import EventReader as G4Gun
+    # Create the algorithm
+    self.__core = G4Gun(name)
+    # The generator is initialized and run by the reader (no particles file if OutputFile is empty)
+    self.__generator = generator
+    self.__generator.core().setProperty( "NumberOfEvents", numberOfEvents )
+    self.__core.setGenerator( self.__generator.core() )
+    self.__nevents = numberOfEvents
+
+    for key, value in kw.items():
+      self.setProperty( key,value )
+
+
+
+  def core(self):
+    return self.__core
+
+
+  def setProperty( self, key, value ):
+    if key in self.__allow_keys:
+      setattr( self, '__' + key , value )
+      self.core().setProperty( key, treatPropertyValue(value) )
+    else:
+      MSG_FATAL( self, "Property with name %s is not allow for %s object", key, self.__class__.__name__)
+
+ 
+  def getProperty( self, key ):
+    if key in self.__allow_keys:
+      return getattr( self, '__' + key )
+    else:
+      MSG_FATAL( self, "Property with name %s is not allow for %s object", key, self.__class__.__name__)
+
+
+  def merge( self, acc ):
+    acc.setNumberOfEvents(self.__nevents )
+    acc.core().setGenerator( self.core() )
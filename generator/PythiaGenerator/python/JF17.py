@@ -16,6 +16,9 @@ class JF17( Logger ):
                   "OutputLevel",
                   "EtaWindow",
                   "PhiWindow",
+                  "UseVeto",
+                  "InitCacheDir",
+                  "VetoPtFraction",
                 ]
 
   def __init__( self, name, **kw ): 
@@ -13,6 +13,8 @@ class Zee( Logger ):
                 "MinPt",
                 "Seed",
                 "OutputLevel",
+                "UseVeto",
+                "InitCacheDir",
                 ]
 
   def __init__( self, name, **kw ): 
@@ -17,6 +17,10 @@ from . import EventReader
 __all__.extend(EventReader.__all__)
 from .EventReader import *
 
+from . import EventStream
+__all__.extend(EventStream.__all__)
+from .EventStream import *
+
 from . import EventGenerator
 __all__.extend(EventGenerator.__all__)
 from .EventGenerator import *
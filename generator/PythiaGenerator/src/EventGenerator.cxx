@@ -1,9 +1,21 @@
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <random>
+#include <thread>
+#include <unistd.h>
+#include "TFile.h"
+#include "TSystem.h"
 #include "TTree.h"
 #include "TH1F.h"
 #include "TH2F.h"
 #include "EventGenerator.h"
+#include "InitCache.h"
 #include "G4Kernel/CaloPhiRange.h"
 
 static const double c_light = 2.99792458e+8; // m/s
@@ -16,15 +28,25 @@ using namespace SG;
 EventGenerator::EventGenerator():
   IMsgService("EventGenerator"),
   PropertyService(),
-  m_store(nullptr)
+  m_tree(nullptr),
+  m_store(nullptr),
+  m_firstEvent(0),
+  m_runSeed(0)
 {
   declareProperty( "NumberOfEvents" , m_nEvent=1                );
+  /* The particles ntuple and histograms (not written if empty) */
   declareProperty( "OutputFile"     , m_outputFile="particles"  );
   declareProperty( "OutputLevel"    , m_outputLevel=1           );
  
   /* Configure the pileup generation */
   declareProperty( "MinbiasFile"    , m_minbiasFile=""          );
+  /* Reuse the pythia initialization tables from this directory (disabled if empty) */
+  declareProperty( "InitCacheDir"   , m_initCacheDir=""         );
   declareProperty( "Seed"           , m_seed=0/* clock system */);
+  /* Worker threads, each one with its own pythia instances. The events are written in order 
+   * and at most QueueSize events can wait for the writer */
+  declareProperty( "NumberOfThreads", m_numberOfThreads=1       );
+  declareProperty( "QueueSize"      , m_queueSize=100           );
   declareProperty( "PileupAvg"      , m_nPileupAvg=0            );
   declareProperty( "BunchIdStart"   , m_bc_id_start=-8          );
   declareProperty( "BunchIdEnd"     , m_bc_id_end=7             );
@@ -35,6 +57,26 @@ EventGenerator::EventGenerator():
   declareProperty( "MinbiasDeltaEta", m_mb_delta_eta=0.22                                                     );
   declareProperty( "MinbiasDeltaPhi", m_mb_delta_phi=0.22                                                     );
   declareProperty( "UseWindow"      , m_useWindow=true                                                        );
+  /* Exactly PileupAvg minbias events per bunch crossing (used to build the pileup library) */
+  declareProperty( "FixedPileup"    , m_fixedPileup=false                                                     );
+  
+  /* Minbias recycling pool. The pool events are sampled with replacement, random phi 
+   * rotation and eta reflection. Each event is regenerated after PoolMaxReuse uses (zero is no 
+   * limit, the only option with threads or checkpoints). The pool is read from PoolFile if it 
+   * exists, otherwise it is written there */
+  declareProperty( "PoolSize"       , m_poolSize=0 /*disabled*/ );
+  declareProperty( "PoolMaxReuse"   , m_poolMaxReuse=0          );
+  declareProperty( "PoolFile"       , m_poolFile=""             );
+
+  /* Flush the output each N events and record the next event. A resumed job reads the checkpoint
+   * of the output file and generates the remaining events with the same seeds */
+  declareProperty( "CheckpointInterval", m_checkpointInterval=0 /*disabled*/ );
+  declareProperty( "Resume"         , m_resume=false            );
+
+  /* Periodic progress snapshot (json lines or prometheus textfile). Disabled if empty */
+  declareProperty( "MetricsFile"    , m_metricsFile=""          );
+  declareProperty( "MetricsFormat"  , m_metricsFormat="json"    );
+  declareProperty( "MetricsInterval", m_metricsInterval=30      );
   
 
 
@@ -52,35 +94,60 @@ StatusCode EventGenerator::initialize()
   
   setMsgLevel( m_outputLevel );
 
-  m_store = new SG::StoreGate( m_outputFile);
-  
-  std::stringstream cmdseed; cmdseed << "Random:seed = " << m_seed;
-  // Minbias generator
-  m_mb_pythia.readFile( m_minbiasFile );
-  m_mb_pythia.readString("Random:setSeed = on");
-  m_mb_pythia.readString(cmdseed.str());
-  m_mb_pythia.init();
- 
+  // All event seeds are derived from the run seed
+  m_runSeed = m_seed ? m_seed : std::random_device()() % 900000000 + 1;
+
+  // The checkpoint replaces the run seed, so the remaining events are the same of the killed job
+  m_firstEvent = 0;
+  bool resumed = m_resume && !m_outputFile.empty() && readCheckpoint();
+  std::string previous = m_outputFile + ".previous.root";
+  if ( resumed ){
+    MSG_INFO( "Resuming from the event " << m_firstEvent << " with seed " << m_runSeed );
+    std::string output = m_outputFile;
+    if ( output.size() < 5 || output.substr( output.size()-5 ) != ".root" ) output += ".root";
+    // Kept if a previous resume was killed before the restore
+    if ( !std::ifstream( previous ).good() ) std::rename( output.c_str(), previous.c_str() );
+  }
+
+  // The physics tools of the main thread are used only without workers
+  if ( initializePythia( m_numberOfThreads <= 1 ).isFailure() ){
+    MSG_FATAL( "It's not possible to initialize the event tool." );
+  }
+
+  // The use counters are shared by the threads and not checkpointed, so the refills would depend on
+  // the thread scheduling and on the resume
+  if ( m_poolSize > 0 && m_poolMaxReuse > 0 && ( m_numberOfThreads > 1 || m_checkpointInterval > 0 || m_resume ) ){
+    MSG_FATAL( "The PoolMaxReuse can not be used with more than one thread or with checkpoints." );
+  }
+
+  if ( fillPool().isFailure() ){
+    MSG_FATAL( "It's not possible to fill the minbias recycling pool." );
+  }
+
+
+  // Only streamed to the consumer
+  if ( m_outputFile.empty() ) return StatusCode::SUCCESS;
 
   // Initialize output file
+  m_store = new SG::StoreGate( m_outputFile);
   m_tree = new TTree("particles","Pythia particles event tree");
-  m_tree->Branch("avg_mu"      , &m_avg_mu, "avg_mu/F");
-  m_tree->Branch("p_isMain"    , &m_p_isMain     );
-  m_tree->Branch("p_pdg_id"    , &m_p_pdg_id     ); 
-  m_tree->Branch("p_bc_id"     , &m_p_bc_id      ); 
-  m_tree->Branch("bc_mu"       , &m_bc_id_mu     ); 
-  m_tree->Branch("bc_id_nhits" , &m_bc_id_nhits  );
-  m_tree->Branch("p_px"        , &m_p_px         ); 
-  m_tree->Branch("p_py"        , &m_p_py         ); 
-  m_tree->Branch("p_pz"        , &m_p_pz         );
-  m_tree->Branch("p_prod_x"    , &m_p_prod_x     ); 
-  m_tree->Branch("p_prod_y"    , &m_p_prod_y     ); 
-  m_tree->Branch("p_prod_z"    , &m_p_prod_z     );  
-  m_tree->Branch("p_prod_t"    , &m_p_prod_t     );
-  m_tree->Branch("p_eta"       , &m_p_eta        ); 
-  m_tree->Branch("p_phi"       , &m_p_phi        );
-  m_tree->Branch("p_e"         , &m_p_e          );  
-  m_tree->Branch("p_et"        , &m_p_et         );
+  m_tree->Branch("avg_mu"      , &m_event.avg_mu, "avg_mu/F");
+  m_tree->Branch("p_isMain"    , &m_event.p_isMain     );
+  m_tree->Branch("p_pdg_id"    , &m_event.p_pdg_id     ); 
+  m_tree->Branch("p_bc_id"     , &m_event.p_bc_id      ); 
+  m_tree->Branch("bc_mu"       , &m_event.bc_id_mu     ); 
+  m_tree->Branch("bc_id_nhits" , &m_event.bc_id_nhits  );
+  m_tree->Branch("p_px"        , &m_event.p_px         ); 
+  m_tree->Branch("p_py"        , &m_event.p_py         ); 
+  m_tree->Branch("p_pz"        , &m_event.p_pz         );
+  m_tree->Branch("p_prod_x"    , &m_event.p_prod_x     ); 
+  m_tree->Branch("p_prod_y"    , &m_event.p_prod_y     ); 
+  m_tree->Branch("p_prod_z"    , &m_event.p_prod_z     );  
+  m_tree->Branch("p_prod_t"    , &m_event.p_prod_t     );
+  m_tree->Branch("p_eta"       , &m_event.p_eta        ); 
+  m_tree->Branch("p_phi"       , &m_event.p_phi        );
+  m_tree->Branch("p_e"         , &m_event.p_e          );  
+  m_tree->Branch("p_et"        , &m_event.p_et         );
   m_store->cd();
   m_store->add( m_tree );
 
@@ -90,47 +157,353 @@ StatusCode EventGenerator::initialize()
   m_store->add( new TH1F( "phi"  , "#phi Main particles; #phi; Count", 50, -3.2, 3.2 ) );
   m_store->add( new TH1F( "pt"  , "P_{T} Main particles; P_{T}[GeV]; Count", 100, 0, 100 ) );
 
+  if ( resumed && restore( previous ).isFailure() ){
+    MSG_FATAL( "It's not possible to restore the events of the checkpoint from " << previous );
+  }
+
+  return StatusCode::SUCCESS;
+}
+
+
+StatusCode EventGenerator::initializePythia( bool tools )
+{
+  std::stringstream cmdseed; cmdseed << "Random:seed = " << m_runSeed;
+  // Minbias generator
+  m_mb_pythia.readFile( m_minbiasFile );
+  m_mb_pythia.readString("Random:setSeed = on");
+  m_mb_pythia.readString(cmdseed.str());
+  InitCache( m_initCacheDir ).init( m_mb_pythia, m_minbiasFile );
+  m_nAbort = m_mb_pythia.mode("Main:timesAllowErrors");
+
+  if ( !tools ) return StatusCode::SUCCESS;
 
   for( auto &tool : m_tools ){
     if ( tool->initialize().isFailure() ){
-      MSG_FATAL( "It's not possible to initialize the event tool." );
+      return StatusCode::FAILURE;
     }
   }
-
   return StatusCode::SUCCESS;
 }
 
 
+EventGenerator* EventGenerator::worker() const
+{
+  auto *gen = new EventGenerator();
+  gen->m_outputLevel    = m_outputLevel;
+  gen->m_minbiasFile    = m_minbiasFile;
+  gen->m_initCacheDir   = m_initCacheDir;
+  gen->m_seed           = m_seed;
+  gen->m_runSeed        = m_runSeed;
+  gen->m_nPileupAvg     = m_nPileupAvg;
+  gen->m_bc_id_start    = m_bc_id_start;
+  gen->m_bc_id_end      = m_bc_id_end;
+  gen->m_etaMax         = m_etaMax;
+  gen->m_select         = m_select;
+  gen->m_sigma_t        = m_sigma_t;
+  gen->m_sigma_z        = m_sigma_z;
+  gen->m_mb_delta_eta   = m_mb_delta_eta;
+  gen->m_mb_delta_phi   = m_mb_delta_phi;
+  gen->m_useWindow      = m_useWindow;
+  gen->m_fixedPileup    = m_fixedPileup;
+  gen->m_poolMaxReuse   = m_poolMaxReuse;
+  // The pool is shared by all threads
+  gen->m_pool           = m_pool;
+  for ( auto tool : m_tools ){
+    gen->m_clones.emplace_back( tool->clone() );
+    gen->m_tools.push_back( gen->m_clones.back().get() );
+  }
+  gen->setMsgLevel( m_outputLevel );
+  return gen;
+}
+
+
+int EventGenerator::eventSeed( int iEvent, int stream ) const
+{
+  // splitmix64 of (run seed, event, stream). Pythia seeds must be in [1, 900000000]
+  uint64_t z = ( (uint64_t)m_runSeed << 32 ) ^ ( (uint64_t)(uint32_t)iEvent << 8 ) ^ (uint64_t)stream;
+  z += 0x9e3779b97f4a7c15ULL;
+  z = ( z ^ (z >> 30) ) * 0xbf58476d1ce4e5b9ULL;
+  z = ( z ^ (z >> 27) ) * 0x94d049bb133111ebULL;
+  z = z ^ (z >> 31);
+  return 1 + (int)( z % 900000000ULL );
+}
+
+
 StatusCode EventGenerator::run() 
 {
-  for (int iEvent = 0; iEvent < m_nEvent; ++iEvent) {
+  std::unique_ptr<Gaugi::MetricsExporter> metrics;
+  Gaugi::metric_counter_t *counter = nullptr;
+  if ( !m_metricsFile.empty() ){
+    metrics.reset( new Gaugi::MetricsExporter( getLogName(), m_metricsFile, m_metricsFormat, m_metricsInterval, m_nEvent ) );
+    counter = metrics->counter(0);
+    metrics->start();
+  }
+
+  if ( m_numberOfThreads > 1 ){
+    auto sc = runThreads( metrics.get() );
+    if ( metrics ) metrics->stop();
+    return sc;
+  }
+
+  if ( metrics ) metrics->startEventLoop();
+  for (int iEvent = m_firstEvent; iEvent < m_nEvent; ++iEvent) {
     
     MSG_INFO( "Running event " << iEvent );
-    clear();
+    try {
+      generateEvent( iEvent, m_event );
+      if ( counter ) Gaugi::increment( counter->events );
+      if ( !fill( iEvent ) ){
+        MSG_INFO( "Generation stopped by the consumer" );
+        break;
+      }
+    } catch ( AbortPrematurely ){
+      MSG_ERROR("Abort prematurely");
+      break;
+    }
+  }// Loop over events
+
+  if ( metrics ) metrics->stop();
+  return StatusCode::SUCCESS;
+}
+
+
+StatusCode EventGenerator::runThreads( Gaugi::MetricsExporter *metrics )
+{
+  MSG_INFO( "Running " << (int)m_nEvent << " events with " << m_numberOfThreads << " threads..." );
+
+  std::vector<std::unique_ptr<EventGenerator>> workers;
+  for ( int id = 0; id < m_numberOfThreads; ++id )
+    workers.emplace_back( worker() );
+
+  std::atomic<int> next(m_firstEvent);
+  std::atomic<bool> abort(false);
+  bool stopped = false;
+  std::mutex mutex;
+  std::condition_variable cv;
+  // Events waiting for the writer (ordered by index)
+  std::map<int, generated_event_t> queue;
+  int written = m_firstEvent;
+
+  // The exporter can poll the gauge after the end of this method
+  auto depth = std::make_shared<std::atomic<int>>(0);
+  // The next event to be written must always fit in the queue
+  const int queueSize = std::max( m_queueSize, 1 );
+  if ( metrics ){
+    metrics->addGauge( "queue", [depth](){ return (double)depth->load(); } );
+  }
+
+  auto work = [&]( EventGenerator *gen, int id ){
+    // The pythia initialization runs in parallel
+    if ( gen->initializePythia( true ).isFailure() ){
+      MSG_ERROR( "It's not possible to initialize the event tools of the thread " << id );
+      abort = true; cv.notify_all();
+      return;
+    }
+    Gaugi::metric_counter_t *counter = metrics ? metrics->counter(id) : nullptr;
+    if ( metrics ) metrics->startEventLoop();
+    generated_event_t event;
+    int iEvent;
+    while ( !abort && (iEvent = next++) < m_nEvent ){
+      MSG_INFO( "Running event " << iEvent << " in thread " << id );
+      try {
+        gen->generateEvent( iEvent, event );
+      } catch ( AbortPrematurely ){
+        MSG_ERROR("Abort prematurely");
+        abort = true; cv.notify_all();
+        break;
+      }
+      if ( counter ) Gaugi::increment( counter->events );
+      std::unique_lock<std::mutex> lock(mutex);
+      // Do not get too far ahead of the writer. The next event to be written never waits here
+      cv.wait( lock, [&](){ return abort || iEvent < written + queueSize; } );
+      if ( abort ) break;
+      queue[iEvent] = std::move( event );
+      *depth = queue.size();
+      cv.notify_all();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for ( int id = 0; id < m_numberOfThreads; ++id )
+    threads.emplace_back( work, workers[id].get(), id );
+
+  // Single writer: the events are written in the index order
+  while ( written < m_nEvent ){
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait( lock, [&](){ return abort || queue.count(written); } );
+    auto it = queue.find( written );
+    if ( it == queue.end() ) break;
+    m_event = std::move( it->second );
+    queue.erase( it );
+    *depth = queue.size();
+    written++;
+    cv.notify_all();
+    lock.unlock();
+    if ( !fill( written-1 ) ){
+      MSG_INFO( "Generation stopped by the consumer" );
+      stopped = true;
+      abort = true; cv.notify_all();
+      break;
+    }
+  }
+
+  for ( auto &thread : threads ) thread.join();
+
+  for ( auto &gen : workers ){
+    for ( auto tool : gen->m_tools ){
+      if ( tool->finalize().isFailure() ){
+        MSG_ERROR( "It's not possible to finalize the event tool." );
+      }
+    }
+  }
+
+  MSG_INFO( "Wrote " << written << " events." );
+  return abort && !stopped ? StatusCode::FAILURE : StatusCode::SUCCESS;
+}
+
+
+StatusCode EventGenerator::generateEvent( int iEvent, generated_event_t &event )
+{
+  // Restart all random engines with the event seeds
+  m_mb_pythia.rndm.init( eventSeed( iEvent, 0 ) );
+  for ( size_t i = 0; i < m_tools.size(); ++i )
+    m_tools[i]->setEventSeed( eventSeed( iEvent, i+1 ) );
+
+  while ( true ){
+    event.clear();
     try {
       std::vector<xAOD::seed_t> seed_vec;
+      bool failure = false;
 
       // Loop over all physcis tools
       for (auto& tool : m_tools ){
-        if ( generate( tool, seed_vec ).isFailure() ){
-          --iEvent; continue;
+        if ( generate( tool, seed_vec, event ).isFailure() ){
+          failure = true; break;
         }
       }
+      if ( failure ) continue;
 
-      addPileup( seed_vec );      
-      // Fill main ttree
-      m_tree->Fill();
+      addPileup( seed_vec, event );      
+      return StatusCode::SUCCESS;
 
     } catch ( NotInterestingEvent ){
       MSG_WARNING("Ignoring non interesting event, regenerating...");
-      --iEvent;
-      continue;
-    } catch ( AbortPrematurely ){
-      MSG_ERROR("Abort prematurely");
-      break;
     }
-  }// Loop over events
+  }
+}
+
+
+bool EventGenerator::fill( int iEvent )
+{
+  write();
+  if ( m_checkpointInterval > 0 && (iEvent+1) % m_checkpointInterval == 0 && iEvent+1 < m_nEvent )
+    checkpoint( iEvent+1 );
+  // The consumer can take the vectors of the event
+  return m_consumer ? m_consumer( iEvent, m_event ) : true;
+}
+
+
+void EventGenerator::write()
+{
+  if ( m_store ){
+    for ( size_t i = 0; i < m_event.p_isMain.size(); ++i ){
+      // The seeds are the main particles with pdg zero
+      if ( m_event.p_isMain[i] && m_event.p_pdg_id[i] == 0 ){
+        m_store->hist1("eta")->Fill( m_event.p_eta[i] );
+        m_store->hist1("phi")->Fill( m_event.p_phi[i] );
+        m_store->hist1("pt")->Fill( m_event.p_et[i] );
+      }
+    }
+    m_store->hist1("avgmu")->Fill( m_event.avg_mu );
+    // Fill main ttree
+    m_tree->Fill();
+  }
+}
+
+
+void EventGenerator::checkpoint( int nextEvent )
+{
+  if ( !m_store ) return;
+  m_store->flush();
+  // The checkpoint is replaced only after the output is on disk
+  std::string path = m_outputFile + ".checkpoint";
+  std::string tmp  = path + ".tmp";
+  {
+    std::ofstream out( tmp );
+    out << "seed " << m_runSeed << "\n" << "next " << nextEvent << "\n";
+  }
+  std::rename( tmp.c_str(), path.c_str() );
+  MSG_INFO( "Checkpoint at the event " << nextEvent );
+}
+
+
+bool EventGenerator::readCheckpoint()
+{
+  std::ifstream in( m_outputFile + ".checkpoint" );
+  std::string key;
+  unsigned seed=0; int next=-1;
+  while ( in >> key ){
+    if ( key == "seed" ) in >> seed;
+    else if ( key == "next" ) in >> next;
+  }
+  if ( !seed || next < 0 ) return false;
+  m_runSeed    = seed;
+  m_firstEvent = std::min( next, (int)m_nEvent );
+  return true;
+}
+
 
+StatusCode EventGenerator::restore( const std::string &previous )
+{
+  TFile file( previous.c_str(), "read" );
+  TTree *tree = file.IsZombie() ? nullptr : (TTree*)file.Get("particles");
+  if ( !tree || tree->GetEntries() < m_firstEvent ) return StatusCode::FAILURE;
+
+  std::vector<int>   *p_isMain    = &m_event.p_isMain;
+  std::vector<int>   *bc_id_nhits = &m_event.bc_id_nhits;
+  std::vector<int>   *p_pdg_id    = &m_event.p_pdg_id;
+  std::vector<int>   *p_bc_id     = &m_event.p_bc_id;
+  std::vector<float> *bc_id_mu    = &m_event.bc_id_mu;
+  std::vector<float> *p_px        = &m_event.p_px;
+  std::vector<float> *p_py        = &m_event.p_py;
+  std::vector<float> *p_pz        = &m_event.p_pz;
+  std::vector<float> *p_prod_x    = &m_event.p_prod_x;
+  std::vector<float> *p_prod_y    = &m_event.p_prod_y;
+  std::vector<float> *p_prod_z    = &m_event.p_prod_z;
+  std::vector<float> *p_prod_t    = &m_event.p_prod_t;
+  std::vector<float> *p_eta       = &m_event.p_eta;
+  std::vector<float> *p_phi       = &m_event.p_phi;
+  std::vector<float> *p_e         = &m_event.p_e;
+  std::vector<float> *p_et        = &m_event.p_et;
+  tree->SetBranchAddress( "avg_mu"      , &m_event.avg_mu );
+  tree->SetBranchAddress( "p_isMain"    , &p_isMain       );
+  tree->SetBranchAddress( "p_pdg_id"    , &p_pdg_id       );
+  tree->SetBranchAddress( "p_bc_id"     , &p_bc_id        );
+  tree->SetBranchAddress( "bc_mu"       , &bc_id_mu       );
+  tree->SetBranchAddress( "bc_id_nhits" , &bc_id_nhits    );
+  tree->SetBranchAddress( "p_px"        , &p_px           );
+  tree->SetBranchAddress( "p_py"        , &p_py           );
+  tree->SetBranchAddress( "p_pz"        , &p_pz           );
+  tree->SetBranchAddress( "p_prod_x"    , &p_prod_x       );
+  tree->SetBranchAddress( "p_prod_y"    , &p_prod_y       );
+  tree->SetBranchAddress( "p_prod_z"    , &p_prod_z       );
+  tree->SetBranchAddress( "p_prod_t"    , &p_prod_t       );
+  tree->SetBranchAddress( "p_eta"       , &p_eta          );
+  tree->SetBranchAddress( "p_phi"       , &p_phi          );
+  tree->SetBranchAddress( "p_e"         , &p_e            );
+  tree->SetBranchAddress( "p_et"        , &p_et           );
+
+  // Only the events of the checkpoint (the histograms are filled again)
+  for ( int iEvent = 0; iEvent < m_firstEvent; ++iEvent ){
+    tree->GetEntry( iEvent );
+    write();
+  }
+  tree->ResetBranchAddresses();
+  file.Close();
+  m_store->cd();
+  m_event.clear();
+  std::remove( previous.c_str() );
+  MSG_INFO( "Restored " << m_firstEvent << " events from the checkpoint." );
   return StatusCode::SUCCESS;
 }
 
@@ -140,34 +513,47 @@ StatusCode EventGenerator::finalize()
 {
   MSG_INFO( "Finalize the Event generator." );
   m_mb_pythia.stat();
-  for( auto &tool : m_tools ){
-    if ( tool->finalize().isFailure() ){
-      MSG_ERROR( "It's not possible to finalize the event tool." );
+  if ( m_pool ){
+    MSG_INFO( "Minbias pool with " << m_pool->events.size() << " events: " << m_pool->draws << " draws (" 
+              << (double)m_pool->draws/m_pool->events.size() << " per event) and " << m_pool->refills << " refills." );
+  }
+  // The tools of the threads are finalized by the runThreads
+  if ( m_numberOfThreads <= 1 ){
+    for( auto &tool : m_tools ){
+      if ( tool->finalize().isFailure() ){
+        MSG_ERROR( "It's not possible to finalize the event tool." );
+      }
     }
   }
-  delete m_store;
+  if ( m_store ) delete m_store;
+  m_store = nullptr;
+  // The run is complete
+  if ( m_checkpointInterval > 0 ) std::remove( (m_outputFile + ".checkpoint").c_str() );
   return StatusCode::SUCCESS;
 }
 
 
 
-void EventGenerator::clear()
+void generated_event_t::clear()
 {
   // Clear vectors
-  m_p_isMain->clear();
-  m_p_pdg_id->clear(); 
-  m_p_bc_id->clear();
-  m_p_px->clear(); 
-  m_p_py->clear(); 
-  m_p_pz->clear();
-  m_p_eta->clear(); 
-  m_p_phi->clear();
-  m_p_prod_x->clear(); 
-  m_p_prod_y->clear(); 
-  m_p_prod_z->clear();  
-  m_p_prod_t->clear();
-  m_p_e->clear(); 
-  m_p_et->clear();
+  avg_mu = 0;
+  p_isMain.clear();
+  p_pdg_id.clear(); 
+  p_bc_id.clear();
+  bc_id_mu.clear();
+  bc_id_nhits.clear();
+  p_px.clear(); 
+  p_py.clear(); 
+  p_pz.clear();
+  p_eta.clear(); 
+  p_phi.clear();
+  p_prod_x.clear(); 
+  p_prod_y.clear(); 
+  p_prod_z.clear();  
+  p_prod_t.clear();
+  p_e.clear(); 
+  p_et.clear();
 }
 
 
@@ -193,12 +579,12 @@ int EventGenerator::poisson(double nAvg, Rndm& rndm) {
 }
 
 
-StatusCode EventGenerator::addPileup( std::vector<xAOD::seed_t> seed_vec )
+StatusCode EventGenerator::addPileup( std::vector<xAOD::seed_t> seed_vec, generated_event_t &event )
 {
 
   ParticleFilter det_acc_filter( m_select, m_etaMax + .05, 0.7, 0.05 );
   const int nWin = m_bc_id_end - m_bc_id_start + 1;
-  int mb_iAbort=0;
+  std::vector<Particle> mb_particles;
 
   double nPileUpMean(0);
   int nhits_win(0);
@@ -209,36 +595,27 @@ StatusCode EventGenerator::addPileup( std::vector<xAOD::seed_t> seed_vec )
      */
 
     // Select the number of pileup events to generate.
-    int nPileup = poisson(m_nPileupAvg, m_mb_pythia.rndm);
+    int nPileup = m_fixedPileup ? (int)m_nPileupAvg : poisson(m_nPileupAvg, m_mb_pythia.rndm);
     nPileUpMean += nPileup;
 
     int nhits_bc(0);
     // Generate a number of pileup events.
     for (int iPileup = 0; iPileup < nPileup; ++iPileup) {
 
-      if (!m_mb_pythia.next()) {
-        if (++mb_iAbort < m_nAbort) continue;
+      // Find final charged particles with |eta| < etaMax (recycled from the pool if enabled)
+      bool status = !m_pool ? generateMinbias( det_acc_filter, mb_particles ) : 
+                                     drawFromPool( det_acc_filter, mb_particles );
+      if ( !status ){
         MSG_WARNING("Event generation aborted prematurely, owing to error in minbias generation!");
         break;
       }
 
-      double mb_weight = m_mb_pythia.info.mergingWeight();
-      double mb_evtweight = m_mb_pythia.info.weight();
-      mb_weight *= mb_evtweight;
-
-      // Do not print zero-weight events.
-      if ( mb_weight == 0. ) {
-        --iPileup; continue;
-      }
-
-      // Find final charged particles with |eta| < etaMax
-      det_acc_filter.filter( m_mb_pythia.event );
-
       // Further det_acc_filter particles to get only those within main event window
       std::vector< Particle* > minbias_vec; 
-      minbias_vec.reserve( static_cast<int>( det_acc_filter.size() / 4) ); 
+      minbias_vec.reserve( static_cast<int>( mb_particles.size() / 4) ); 
       
-      for ( const auto p : det_acc_filter.getParticlesRef() ){
+      for ( auto &particle : mb_particles ){
+        auto p = &particle;
         
         if (m_useWindow){ 
           for ( const auto &seed : seed_vec ) {
@@ -269,20 +646,20 @@ StatusCode EventGenerator::addPileup( std::vector<xAOD::seed_t> seed_vec )
         // Shorthands
         const auto pdg_id = mb_p->id();
         // Obtain minbias data
-        m_p_isMain->push_back( 0 );
-        m_p_bc_id->push_back( bc_id );
-        m_p_pdg_id->push_back( pdg_id );
-        m_p_px->push_back( mb_p->px() ); 
-        m_p_py->push_back( mb_p->py() ); 
-        m_p_pz->push_back( mb_p->pz() );
-        m_p_eta->push_back( mb_p->eta() ); 
-        m_p_phi->push_back( mb_p->phi() );
-        m_p_prod_x->push_back( mb_p->xProd() ); 
-        m_p_prod_y->push_back( mb_p->yProd() ); 
-        m_p_prod_z->push_back( mb_p->zProd() + mb_event_z ); 
-        m_p_prod_t->push_back( mb_p->tProd() + mb_event_t  );
-        m_p_e->push_back( mb_p->e() ); 
-        m_p_et->push_back( mb_p->eT() );
+        event.p_isMain.push_back( 0 );
+        event.p_bc_id.push_back( bc_id );
+        event.p_pdg_id.push_back( pdg_id );
+        event.p_px.push_back( mb_p->px() ); 
+        event.p_py.push_back( mb_p->py() ); 
+        event.p_pz.push_back( mb_p->pz() );
+        event.p_eta.push_back( mb_p->eta() ); 
+        event.p_phi.push_back( mb_p->phi() );
+        event.p_prod_x.push_back( mb_p->xProd() ); 
+        event.p_prod_y.push_back( mb_p->yProd() ); 
+        event.p_prod_z.push_back( mb_p->zProd() + mb_event_z ); 
+        event.p_prod_t.push_back( mb_p->tProd() + mb_event_t  );
+        event.p_e.push_back( mb_p->e() ); 
+        event.p_et.push_back( mb_p->eT() );
         ++idx;
       }
       nhits_bc += minbias_vec.size();
@@ -291,22 +668,193 @@ StatusCode EventGenerator::addPileup( std::vector<xAOD::seed_t> seed_vec )
     nhits_win += nhits_bc;
 
     // --- Fill bc_id branches
-    m_bc_id_mu->push_back( nPileup ); 
-    m_bc_id_nhits->push_back( nhits_bc );
+    event.bc_id_mu.push_back( nPileup ); 
+    event.bc_id_nhits.push_back( nhits_bc );
 
   } // Finished all BCs
 
   //mb_electron_photon_e_frac_win /= mb_e_win;
   //const auto emb_perc_win = mb_e_win / jet_e;
   // Fill window specific information
-  nPileUpMean /= nWin; m_avg_mu = nPileUpMean;
-  m_store->hist1("avgmu")->Fill(m_avg_mu);
+  nPileUpMean /= nWin; event.avg_mu = nPileUpMean;
+
+  return StatusCode::SUCCESS;
+}
+
+
+bool EventGenerator::generateMinbias( ParticleFilter &det_acc_filter, std::vector<Particle> &particles )
+{
+  particles.clear();
+  int mb_iAbort=0;
+  while ( true ){
+    if (!m_mb_pythia.next()) {
+      if (++mb_iAbort < m_nAbort) continue;
+      return false;
+    }
+
+    double mb_weight = m_mb_pythia.info.mergingWeight();
+    double mb_evtweight = m_mb_pythia.info.weight();
+    mb_weight *= mb_evtweight;
+
+    // Do not print zero-weight events.
+    if ( mb_weight == 0. ) continue;
+
+    det_acc_filter.filter( m_mb_pythia.event );
+    for ( const auto p : det_acc_filter.getParticlesRef() )
+      particles.push_back( *p );
+    return true;
+  }
+}
+
+
+StatusCode EventGenerator::fillPool()
+{
+  if ( m_poolSize <= 0 ) return StatusCode::SUCCESS;
+
+  m_pool.reset( new minbias_pool_t() );
+  auto &events = m_pool->events;
+
+  // Read the pool from the file
+  if ( !m_poolFile.empty() && !gSystem->AccessPathName( m_poolFile.c_str() ) ){
+    MSG_INFO( "Reading the minbias pool from " << m_poolFile );
+    TFile *file = TFile::Open( m_poolFile.c_str(), "READ" );
+    TTree *tree = file ? (TTree*)file->Get("pool") : nullptr;
+    if ( !tree ){
+      MSG_ERROR( "There is no pool tree in " << m_poolFile );
+      delete file;
+      return StatusCode::FAILURE;
+    }
+    std::vector<int> *pdg_id = nullptr;
+    std::vector<float> *px = nullptr, *py = nullptr, *pz = nullptr, *e = nullptr, *m = nullptr;
+    std::vector<float> *prod_x = nullptr, *prod_y = nullptr, *prod_z = nullptr, *prod_t = nullptr;
+    tree->SetBranchAddress( "p_pdg_id", &pdg_id );
+    tree->SetBranchAddress( "p_px"    , &px     );
+    tree->SetBranchAddress( "p_py"    , &py     );
+    tree->SetBranchAddress( "p_pz"    , &pz     );
+    tree->SetBranchAddress( "p_e"     , &e      );
+    tree->SetBranchAddress( "p_m"     , &m      );
+    tree->SetBranchAddress( "p_prod_x", &prod_x );
+    tree->SetBranchAddress( "p_prod_y", &prod_y );
+    tree->SetBranchAddress( "p_prod_z", &prod_z );
+    tree->SetBranchAddress( "p_prod_t", &prod_t );
+    
+    for ( Long64_t entry = 0; entry < tree->GetEntries() && (int)events.size() < m_poolSize; ++entry ){
+      tree->GetEntry( entry );
+      pool_event_t event{ {}, 0 };
+      for ( size_t i = 0; i < pdg_id->size(); ++i ){
+        Particle p( pdg_id->at(i), 1, 0, 0, 0, 0, 0, 0, px->at(i), py->at(i), pz->at(i), e->at(i), m->at(i) );
+        p.vProd( prod_x->at(i), prod_y->at(i), prod_z->at(i), prod_t->at(i) );
+        event.particles.push_back( p );
+      }
+      events.push_back( std::move(event) );
+    }
+    file->Close();
+    delete file;
+    if ( (int)events.size() < m_poolSize ){
+      MSG_WARNING( "The pool file has only " << events.size() << " events." );
+    }
+    return StatusCode::SUCCESS;
+  }
 
+  MSG_INFO( "Generating " << m_poolSize << " minbias events into the recycling pool..." );
+  ParticleFilter det_acc_filter( m_select, m_etaMax + .05, 0.7, 0.05 );
+  events.resize( m_poolSize );
+  for ( auto &event : events ){
+    if ( !generateMinbias( det_acc_filter, event.particles ) ){
+      MSG_ERROR( "Minbias generation aborted while filling the pool." );
+      return StatusCode::FAILURE;
+    }
+    event.used = 0;
+  }
+
+  // Save the pool to be reused by the next jobs. Written into a temporary file and renamed
+  // at the end, so concurrent jobs never read (or write) a partial file
+  if ( !m_poolFile.empty() ){
+    MSG_INFO( "Writing the minbias pool into " << m_poolFile );
+    std::string tmp = m_poolFile + ".tmp" + std::to_string( getpid() );
+    TFile file( tmp.c_str(), "RECREATE" );
+    if ( file.IsZombie() ){
+      MSG_WARNING( "It's not possible to write the pool into " << tmp << ". The pool will not be saved." );
+      return StatusCode::SUCCESS;
+    }
+    std::vector<int> pdg_id;
+    std::vector<float> px, py, pz, e, m, prod_x, prod_y, prod_z, prod_t;
+    TTree tree( "pool", "Minbias recycling pool" );
+    tree.Branch( "p_pdg_id", &pdg_id );
+    tree.Branch( "p_px"    , &px     );
+    tree.Branch( "p_py"    , &py     );
+    tree.Branch( "p_pz"    , &pz     );
+    tree.Branch( "p_e"     , &e      );
+    tree.Branch( "p_m"     , &m      );
+    tree.Branch( "p_prod_x", &prod_x );
+    tree.Branch( "p_prod_y", &prod_y );
+    tree.Branch( "p_prod_z", &prod_z );
+    tree.Branch( "p_prod_t", &prod_t );
+    for ( const auto &event : events ){
+      pdg_id.clear(); px.clear(); py.clear(); pz.clear(); e.clear(); m.clear();
+      prod_x.clear(); prod_y.clear(); prod_z.clear(); prod_t.clear();
+      for ( const auto &p : event.particles ){
+        pdg_id.push_back( p.id() );
+        px.push_back( p.px() ); py.push_back( p.py() ); pz.push_back( p.pz() );
+        e.push_back( p.e() ); m.push_back( p.m() );
+        prod_x.push_back( p.xProd() ); prod_y.push_back( p.yProd() ); 
+        prod_z.push_back( p.zProd() ); prod_t.push_back( p.tProd() );
+      }
+      tree.Fill();
+    }
+    tree.Write();
+    file.Close();
+    if ( std::rename( tmp.c_str(), m_poolFile.c_str() ) != 0 ){
+      MSG_WARNING( "It's not possible to rename " << tmp << " to " << m_poolFile << ". The pool will not be saved." );
+      std::remove( tmp.c_str() );
+    }
+  }
   return StatusCode::SUCCESS;
 }
 
 
-StatusCode EventGenerator::generate( Physics *tool,  std::vector<xAOD::seed_t> &seed_vec )
+bool EventGenerator::drawFromPool( ParticleFilter &det_acc_filter, std::vector<Particle> &particles )
+{
+  auto &events = m_pool->events;
+  size_t idx = std::min( events.size()-1, (size_t)( m_mb_pythia.rndm.flat() * events.size() ) );
+  // Break the correlation between the draws of the same event
+  const double dphi = 2*M_PI*m_mb_pythia.rndm.flat();
+  const bool reflect = m_mb_pythia.rndm.flat() < 0.5;
+  bool refill = false;
+  {
+    // The pool is shared by all generator threads
+    std::lock_guard<std::mutex> lock( m_pool->mutex );
+    auto &event = events[idx];
+    // Too many uses, replace it by a new one (only without threads, see initialize)
+    refill = m_poolMaxReuse > 0 && event.used >= m_poolMaxReuse;
+    if ( !refill ){
+      event.used++;
+      m_pool->draws++;
+      particles = event.particles;
+    }
+  }
+  if ( refill ){
+    // Generated outside of the lock
+    if ( !generateMinbias( det_acc_filter, particles ) ) return false;
+    std::lock_guard<std::mutex> lock( m_pool->mutex );
+    events[idx].particles = particles;
+    events[idx].used = 1;
+    m_pool->refills++;
+    m_pool->draws++;
+  }
+  for ( auto &p : particles ){
+    // Rotate the momentum and the production vertex around z
+    p.rot( 0., dphi );
+    if ( reflect ){
+      p.pz( -p.pz() );
+      p.zProd( -p.zProd() );
+    }
+  }
+  return true;
+}
+
+
+StatusCode EventGenerator::generate( Physics *tool,  std::vector<xAOD::seed_t> &seed_vec, generated_event_t &event )
 {
 
   std::vector<std::vector<Particle*>> particles_vec;
@@ -337,18 +885,18 @@ StatusCode EventGenerator::generate( Physics *tool,  std::vector<xAOD::seed_t> &
     // Add this to be seed
     seed_vec.push_back(seed);
 
-    m_p_isMain->push_back( 1 );
-    m_p_bc_id->push_back( 0 ); 
-    m_p_pdg_id->push_back( 0 );
-    m_p_px->push_back( seed.px ); 
-    m_p_py->push_back( seed.py ); 
-    m_p_pz->push_back( seed.pz );
-    m_p_eta->push_back( seed.eta ); 
-    m_p_phi->push_back( seed.phi );
-    m_p_prod_x->push_back( 0 ); 
-    m_p_prod_y->push_back( 0 ); 
-    m_p_prod_z->push_back( 0 + main_event_z  ); 
-    m_p_prod_t->push_back( 0 + main_event_t );
+    event.p_isMain.push_back( 1 );
+    event.p_bc_id.push_back( 0 ); 
+    event.p_pdg_id.push_back( 0 );
+    event.p_px.push_back( seed.px ); 
+    event.p_py.push_back( seed.py ); 
+    event.p_pz.push_back( seed.pz );
+    event.p_eta.push_back( seed.eta ); 
+    event.p_phi.push_back( seed.phi );
+    event.p_prod_x.push_back( 0 ); 
+    event.p_prod_y.push_back( 0 ); 
+    event.p_prod_z.push_back( 0 + main_event_z  ); 
+    event.p_prod_t.push_back( 0 + main_event_t );
    
     // In case of cluster, sum the energy of all particles
     const auto particles = particles_vec[main_idx];
@@ -357,13 +905,9 @@ StatusCode EventGenerator::generate( Physics *tool,  std::vector<xAOD::seed_t> &
       etot+=pj->e(); ettot+=pj->eT();
     }
 
-    m_p_e->push_back( etot ); 
-    m_p_et->push_back( ettot );
+    event.p_e.push_back( etot ); 
+    event.p_et.push_back( ettot );
     
-    m_store->hist1("eta")->Fill( seed.eta );
-    m_store->hist1("phi")->Fill( seed.phi );
-    m_store->hist1("pt")->Fill( ettot  );
-
 
     /*
      * Add all main particles into the ntuple
@@ -372,20 +916,20 @@ StatusCode EventGenerator::generate( Physics *tool,  std::vector<xAOD::seed_t> &
       // Shorthands
       const auto pdg_id = part->id();
       // Obtain substruct data
-      m_p_isMain->push_back( 1 );
-      m_p_bc_id->push_back( 0 ); 
-      m_p_pdg_id->push_back( pdg_id );
-      m_p_px->push_back( part->px() ); 
-      m_p_py->push_back( part->py() ); 
-      m_p_pz->push_back( part->pz() );
-      m_p_eta->push_back( part->eta() ); 
-      m_p_phi->push_back( part->phi() );
-      m_p_prod_x->push_back( part->xProd() ); 
-      m_p_prod_y->push_back( part->yProd() ); 
-      m_p_prod_z->push_back( part->zProd() + main_event_z  ); 
-      m_p_prod_t->push_back( part->tProd() + main_event_t );
-      m_p_e->push_back( part->e() ); 
-      m_p_et->push_back( part->eT() );
+      event.p_isMain.push_back( 1 );
+      event.p_bc_id.push_back( 0 ); 
+      event.p_pdg_id.push_back( pdg_id );
+      event.p_px.push_back( part->px() ); 
+      event.p_py.push_back( part->py() ); 
+      event.p_pz.push_back( part->pz() );
+      event.p_eta.push_back( part->eta() ); 
+      event.p_phi.push_back( part->phi() );
+      event.p_prod_x.push_back( part->xProd() ); 
+      event.p_prod_y.push_back( part->yProd() ); 
+      event.p_prod_z.push_back( part->zProd() + main_event_z  ); 
+      event.p_prod_t.push_back( part->tProd() + main_event_t );
+      event.p_e.push_back( part->e() ); 
+      event.p_et.push_back( part->eT() );
     }
   }
 
@@ -10,8 +10,12 @@
 #include "GaugiKernel/StatusCode.h"
 #include "EventInfo/EventInfo.h"
 #include "ParticleFilter.h"
+#include "GaugiKernel/MetricsExporter.h"
 #include "TTree.h"
 #include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
 
 class NotInterestingEvent: public std::exception
 {
@@ -36,10 +40,56 @@ class Physics: public MsgService,
 {
   public:
     Physics(): PropertyService() {};
-    ~Physics()=default;
+    virtual ~Physics()=default;
     virtual StatusCode initialize()=0;
     virtual StatusCode run( std::vector<xAOD::seed_t>&, std::vector<std::vector<Pythia8::Particle*>> &)=0;
     virtual StatusCode finalize()=0;
+    /*! New (not initialized) tool with the same configuration, one for each generator thread */
+    virtual Physics* clone() const=0;
+    /*! Restart the random engine (per event seeding) */
+    virtual void setEventSeed( int seed )=0;
+};
+
+
+
+/*! Pre-filtered minbias event of the recycling pool */
+struct pool_event_t {
+  std::vector<Pythia8::Particle> particles;
+  // Number of times this event was used
+  int used;
+};
+
+
+/*! Recycling pool shared by all generator threads */
+struct minbias_pool_t {
+  std::vector<pool_event_t> events;
+  std::mutex mutex;
+  unsigned long long draws=0;
+  unsigned long long refills=0;
+};
+
+
+/*! One generated event (the particles ntuple entry) */
+struct generated_event_t {
+  float avg_mu;
+  std::vector<int>   p_isMain    ;
+  std::vector<int>   bc_id_nhits ;
+  std::vector<int>   p_pdg_id    ; 
+  std::vector<int>   p_bc_id     ; 
+  std::vector<float> bc_id_mu    ; 
+  std::vector<float> p_px        ; 
+  std::vector<float> p_py        ; 
+  std::vector<float> p_pz        ;
+  std::vector<float> p_prod_x    ; 
+  std::vector<float> p_prod_y    ; 
+  std::vector<float> p_prod_z    ;  
+  std::vector<float> p_prod_t    ;
+  std::vector<float> p_eta       ; 
+  std::vector<float> p_phi       ;
+  std::vector<float> p_e         ;  
+  std::vector<float> p_et        ;
+
+  void clear();
 };
 
 
@@ -57,29 +107,90 @@ class EventGenerator: public MsgService,
 
     void push_back( Physics *tool ){ m_tools.push_back(tool); };
 
+    /*! Hand each event (in the index order) to the consumer. The generation stops if it returns false */
+    void setConsumer( std::function<bool(int, generated_event_t&)> consumer ){ m_consumer=consumer; };
+
   private:
  
+    /*! Initialize the minbias pythia (and the physics tools if needed) */
+    StatusCode initializePythia( bool tools );
+
+    /*! Generate the event with this index. The random engines are restarted with the event seed
+     *  so the result does not depend on the number of threads */
+    StatusCode generateEvent( int iEvent, generated_event_t &event );
+
+    /*! Run the events with NumberOfThreads workers and a single writer */
+    StatusCode runThreads( Gaugi::MetricsExporter *metrics );
+
+    /*! New generator (not initialized) with the same configuration, used by each thread */
+    EventGenerator* worker() const;
+
+    /*! Seed of the event for each random engine (stream) */
+    int eventSeed( int iEvent, int stream ) const;
+
     /*! Create the main event into the output ntuple */
-    StatusCode generate( Physics *, std::vector<xAOD::seed_t> &);
+    StatusCode generate( Physics *, std::vector<xAOD::seed_t> &, generated_event_t & );
 
     /*! generate pileup around the seed and add it into the ntuple */
-    StatusCode addPileup( std::vector<xAOD::seed_t> );
+    StatusCode addPileup( std::vector<xAOD::seed_t>, generated_event_t & );
+
+    /*! Generate one minbias event and keep the particles inside of the detector acceptance */
+    bool generateMinbias( ParticleFilter &, std::vector<Pythia8::Particle> & );
+
+    /*! Fill the recycling pool (from the pool file if it exists) */
+    StatusCode fillPool();
+
+    /*! Draw one event from the pool with random phi rotation and eta reflection */
+    bool drawFromPool( ParticleFilter &, std::vector<Pythia8::Particle> & );
+
+    /*! Fill the current event into the ntuple and histograms and hand it to the consumer 
+     *  (writer only). False if the consumer stops the generation */
+    bool fill( int iEvent );
+
+    /*! Fill the current event into the ntuple and histograms */
+    void write();
+
+    /*! Flush the output and record the next event and the run seed (writer only) */
+    void checkpoint( int nextEvent );
+
+    /*! Read the run seed and the next event of the last checkpoint. False if there is none */
+    bool readCheckpoint();
+
+    /*! Copy the events of the last checkpoint from the previous output file */
+    StatusCode restore( const std::string &previous );
 
-    /*! Clear the ntuple */
-    void clear();
     /*! Poisson random number generation*/ 
     int poisson(double nAvg, Pythia8::Rndm& rndm);
 
 
     std::vector<Physics*> m_tools;
+    std::function<bool(int, generated_event_t&)> m_consumer;
+    // Tools owned by the thread workers
+    std::vector<std::unique_ptr<Physics>> m_clones;
 
     TTree *m_tree;
     Pythia8::Pythia m_mb_pythia;
     SG::StoreGate *m_store;
 
     bool m_useWindow;
+    bool m_fixedPileup;
+
+    /*! Minbias recycling pool */
+    std::shared_ptr<minbias_pool_t> m_pool;
+    int m_poolSize;
+    int m_poolMaxReuse;
+    std::string m_poolFile;
 
     int m_seed;
+    /*! Checkpoint each N events (zero is disabled) and resume from the last one */
+    int m_checkpointInterval;
+    bool m_resume;
+    // First event of this job (not zero when resumed)
+    int m_firstEvent;
+    // The seed used by all events (m_seed or taken from the clock system)
+    unsigned m_runSeed;
+    int m_numberOfThreads;
+    int m_queueSize;
     int m_select;
     int m_bc_id_start;
     int m_bc_id_end;
@@ -95,35 +206,14 @@ class EventGenerator: public MsgService,
     float m_nAbort;
     std::string m_outputFile;
     std::string m_minbiasFile;
+    std::string m_initCacheDir;
+    std::string m_metricsFile;
+    std::string m_metricsFormat;
+    float m_metricsInterval;
   
     /*! Ntuple output */
-    float m_avg_mu;
-    std::vector<int>   *m_p_isMain    ;
-    std::vector<int>   *m_bc_id_nhits ;
-    std::vector<int>   *m_p_pdg_id    ; 
-    std::vector<int>   *m_p_bc_id     ; 
-    std::vector<float> *m_bc_id_mu    ; 
-    std::vector<float> *m_p_px        ; 
-    std::vector<float> *m_p_py        ; 
-    std::vector<float> *m_p_pz        ;
-    std::vector<float> *m_p_prod_x    ; 
-    std::vector<float> *m_p_prod_y    ; 
-    std::vector<float> *m_p_prod_z    ;  
-    std::vector<float> *m_p_prod_t    ;
-    std::vector<float> *m_p_eta       ; 
-    std::vector<float> *m_p_phi       ;
-    std::vector<float> *m_p_e         ;  
-    std::vector<float> *m_p_et        ;
+    generated_event_t m_event;
 };
 
 #endif
 
-
-
-
-
-
-
-
-
-
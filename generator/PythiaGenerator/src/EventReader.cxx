@@ -1,8 +1,10 @@
 
 #include "EventReader.h"
+#include "GeneratorSource.h"
+#include "HepMCSource.h"
 #include "EventInfo/EventInfo.h"
 #include "G4Kernel/EventLoop.h"
-#include "G4Kernel/constants.h"
+#include "G4Kernel/TrackInformation.h"
 #include "GaugiKernel/PrettyTable.h"
 #include "G4LorentzVector.hh"
 #include "G4RunManager.hh"
@@ -12,8 +14,6 @@
 #include "G4PhysicalConstants.hh"
 #include "G4SystemOfUnits.hh"
 #include <math.h>
-#include "TFile.h"
-#include "TTree.h"
 #include "TROOT.h"
 
 using namespace Gaugi;
@@ -22,172 +22,120 @@ using namespace Gaugi;
 EventReader::EventReader(std::string name):
     IMsgService(name),
     PrimaryGenerator(),
-    m_evt(0)
+    m_evt(0),
+    m_generator(nullptr)
 {
   ROOT::EnableThreadSafety();
-  declareProperty( "FileName", m_filename=""          );
-  declareProperty( "EventKey", m_eventKey="EventInfo" );
-
+  declareProperty( "FileName"       , m_filename=""          );
+  /* More files (or wildcards) added to the same chain */
+  declareProperty( "InputFiles"     , m_inputFiles={}        );
+  declareProperty( "TreeName"       , m_treeName="particles" );
+  /* particles (tree of the event generator), hepmc3 (ASCII) or hepmc3root */
+  declareProperty( "InputFormat"    , m_inputFormat="particles" );
+  /* Seeds of the HepMC input: particles with these status and pdg ids (empty is any) and Et in GeV */
+  declareProperty( "SeedStatus"     , m_seedStatus={}        );
+  declareProperty( "SeedParticles"  , m_seedParticles={}     );
+  declareProperty( "SeedMinEt"      , m_seedMinEt=0          );
+  declareProperty( "EventKey"       , m_eventKey="EventInfo" );
+  /* Range of entries of the chain (-1 is up to the last one) */
+  declareProperty( "FirstEvent"     , m_firstEvent=0         );
+  declareProperty( "NumberOfEvents" , m_numberOfEvents=-1    );
+  /* Maximum number of events decompressed ahead and the TTreeCache size in bytes */
+  declareProperty( "QueueSize"      , m_queueSize=100        );
+  declareProperty( "CacheSize"      , m_cacheSize=30000000   );
 }
 
+
 PrimaryGenerator* EventReader::copy()
 {
   auto *gun = new EventReader(getLogName());
-  gun->setProperty( "FileName", m_filename );
-  gun->setProperty( "EventKey", m_eventKey );
+  gun->setProperty( "FileName"       , m_filename       );
+  gun->setProperty( "InputFiles"     , m_inputFiles     );
+  gun->setProperty( "TreeName"       , m_treeName       );
+  gun->setProperty( "InputFormat"    , m_inputFormat    );
+  gun->setProperty( "SeedStatus"     , m_seedStatus     );
+  gun->setProperty( "SeedParticles"  , m_seedParticles  );
+  gun->setProperty( "SeedMinEt"      , m_seedMinEt      );
+  gun->setProperty( "EventKey"       , m_eventKey       );
+  gun->setProperty( "FirstEvent"     , m_firstEvent     );
+  gun->setProperty( "NumberOfEvents" , m_numberOfEvents );
+  gun->setProperty( "QueueSize"      , m_queueSize      );
+  gun->setProperty( "CacheSize"      , m_cacheSize      );
+  gun->m_source = source();
   return gun;
 }
 
 
-
-EventReader::~EventReader()
+std::shared_ptr<EventSource> EventReader::source()
 {
-  if( m_f ) delete m_f;
+  // The copies are created by the geant threads at the same time
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto source = m_shared.lock();
+  if ( !source ){
+    std::vector<std::string> files;
+    if ( !m_filename.empty() ) files.push_back( m_filename );
+    files.insert( files.end(), m_inputFiles.begin(), m_inputFiles.end() );
+    if ( m_generator ){
+      source = std::make_shared<GeneratorSource>( m_generator, m_queueSize );
+    }else if ( m_inputFormat == "hepmc3" || m_inputFormat == "hepmc3root" ){
+      source = std::make_shared<HepMCSource>( files, m_inputFormat, m_firstEvent, m_numberOfEvents, m_queueSize,
+                                              m_seedStatus, m_seedParticles, m_seedMinEt );
+    }else{
+      source = std::make_shared<TreeSource>( files, m_treeName, m_firstEvent, m_numberOfEvents, 
+                                             m_queueSize, m_cacheSize );
+    }
+    // Released (and the producer thread stopped) together with the last copy
+    m_shared = source;
+  }
+  return source;
 }
 
 
+EventReader::~EventReader()
+{;}
+
+
 StatusCode EventReader::initialize()
 {
-  MSG_INFO( "Open the root file: " << m_filename );
-  m_f = new TFile( m_filename.c_str() , "read" );
-
-  m_ttree = (TTree*)m_f->Get("particles");
+  // Used without copy
+  if ( !m_source ) m_source = source();
   m_evt=0;
-  link( m_ttree );
-  allocate();
   return StatusCode::SUCCESS;
 }
 
 
 StatusCode EventReader::finalize()
 {
-  release();
-  m_f->Close();
+  m_event.reset();
+  m_source.reset();
   return StatusCode::SUCCESS;
 }
 
 
 
-template <class T> 
-void EventReader::InitBranch(TTree* fChain, std::string branch_name, T* param, bool message)
-{
-  std::string bname = branch_name;
-  if (fChain->GetAlias(bname.c_str()))
-     bname = std::string(fChain->GetAlias(bname.c_str()));
-
-  if (!fChain->FindBranch(bname.c_str()) && message) {
-    MSG_WARNING( "unknown branch " << bname );
-    return;  
-  }
-  fChain->SetBranchStatus(bname.c_str(), 1.);
-  fChain->SetBranchAddress(bname.c_str(), param);
-}
-
-
-void EventReader::link(TTree *t)
-{  
-  InitBranch( t, "avg_mu"		  ,&m_avgmu		    );
-  InitBranch( t, "p_isMain"	  ,&m_p_isMain		);
-  InitBranch( t, "p_pdg_id"	  ,&m_p_pdg_id	  );
-  InitBranch( t, "p_bc_id"	  ,&m_p_bc_id	    );
-  InitBranch( t, "bc_mu"			,&m_bc_mu				);
-  InitBranch( t, "bc_id_nhits",&m_bc_id_nhits	);
-  InitBranch( t, "p_px"				,&m_p_px				);
-  InitBranch( t, "p_py"       ,&m_p_py        );
-  InitBranch( t, "p_pz"		    ,&m_p_pz		    );
-  InitBranch( t, "p_prod_x"		,&m_p_prod_x		);
-  InitBranch( t, "p_prod_y"		,&m_p_prod_y		);
-  InitBranch( t, "p_prod_z"		,&m_p_prod_z		);
-  InitBranch( t, "p_prod_t"		,&m_p_prod_t		);
-  InitBranch( t, "p_eta"			,&m_p_eta		    );
-  InitBranch( t, "p_phi"			,&m_p_phi		    );
-  InitBranch( t, "p_e"			  ,&m_p_e		      );
-  InitBranch( t, "p_et"			  ,&m_p_et		    );
-}
-
-
-void EventReader::clear()
-{ 
-  m_avgmu       = 0.0;
-  m_p_isMain		->clear();
-  m_p_pdg_id	  ->clear();
-  m_p_bc_id	    ->clear();
-  m_bc_mu				->clear(); 
-  m_bc_id_nhits	->clear();
-  m_p_px				->clear();
-  m_p_py        ->clear();
-  m_p_pz		    ->clear();
-  m_p_prod_x		->clear();
-  m_p_prod_y		->clear();
-  m_p_prod_z		->clear();
-  m_p_prod_t		->clear();
-  m_p_eta		    ->clear();
-  m_p_phi		    ->clear();
-  m_p_e		      ->clear();
-  m_p_et		    ->clear();
-}
-
-
-void EventReader::allocate()
-{
-  m_p_isMain		= new std::vector<int>();
-  m_p_pdg_id	  = new std::vector<int>();
-  m_p_bc_id	    = new std::vector<int>();
-  m_bc_mu				= new std::vector<float>();
-  m_bc_id_nhits	= new std::vector<int>();
-  m_p_px				= new std::vector<float>();
-  m_p_py        = new std::vector<float>();
-  m_p_pz		    = new std::vector<float>();
-  m_p_prod_x		= new std::vector<float>();
-  m_p_prod_y		= new std::vector<float>();
-  m_p_prod_z		= new std::vector<float>();
-  m_p_prod_t		= new std::vector<float>();
-  m_p_eta		    = new std::vector<float>();
-  m_p_phi		    = new std::vector<float>();
-  m_p_e		      = new std::vector<float>();
-  m_p_et		    = new std::vector<float>();
-}
-
-
-void EventReader::release()
-{
-  delete m_p_isMain		;
-  delete m_p_pdg_id	  ;
-  delete m_p_bc_id	  ;
-  delete m_bc_mu			;
-  delete m_bc_id_nhits;	
-  delete m_p_px				;
-  delete m_p_py       ;
-  delete m_p_pz		    ;
-  delete m_p_prod_x		;
-  delete m_p_prod_y		;
-  delete m_p_prod_z		;
-  delete m_p_prod_t		;
-  delete m_p_eta		  ;
-  delete m_p_phi		  ;
-  delete m_p_e		    ;
-  delete m_p_et		    ;
-}
-
-
 // Call by geant
 void EventReader::GeneratePrimaryVertex( G4Event* anEvent )
 {
-  clear();
   m_evt = anEvent->GetEventID();
   
   EventLoop *loop = static_cast<EventLoop*> (G4RunManager::GetRunManager()->GetNonConstCurrentRun());
 
-  if ( m_evt <  m_ttree->GetEntries() ){
+  // Already read by the I/O thread
+  m_event = m_source->get( m_evt );
+
+  if ( m_event ){
 
     MSG_INFO( "Get event (EventReader) with number " << m_evt )
-    m_ttree->GetEntry(m_evt);
     SG::WriteHandle<xAOD::EventInfoContainer>  event(m_eventKey, loop->getContext());
     event.record( std::unique_ptr<xAOD::EventInfoContainer>( new xAOD::EventInfoContainer() ) );
 
     xAOD::EventInfo *evt = new xAOD::EventInfo();
     evt->setEventNumber( m_evt );
-    evt->setAvgmu( m_avgmu );
+    evt->setAvgmu( m_event->avgmu );
+    int interactions = 0;
+    for ( float mu : m_event->bc_mu ) interactions += (int)mu;
+    evt->setInteractions( interactions );
     Load( anEvent, evt );
 
     MSG_INFO( "Event id         : " << evt->eventNumber() );
@@ -202,6 +150,13 @@ void EventReader::GeneratePrimaryVertex( G4Event* anEvent )
 }
 
 
+void EventReader::skipEvent( G4Event* anEvent )
+{
+  // Otherwise the source keeps it in the queue until the end of the run
+  m_source->get( anEvent->GetEventID() );
+}
+
+
 bool EventReader::CheckVertexInsideWorld(const G4ThreeVector& pos) const
 {
   G4Navigator* navigator= G4TransportationManager::GetTransportationManager()->GetNavigatorForTracking();
@@ -216,20 +171,21 @@ bool EventReader::CheckVertexInsideWorld(const G4ThreeVector& pos) const
 void EventReader::Load( G4Event* g4event, xAOD::EventInfo *event )
 {
   float totalEnergy = 0.0;
+  m_vertices.clear();
   
   // Add all particles into the Geant event
-  for ( unsigned int i=0; i < m_p_e->size(); ++i )
+  for ( unsigned int i=0; i < m_event->p_e.size(); ++i )
   {
-    int bc_id = m_p_bc_id->at(i);
-    if(m_p_pdg_id->at(i)==0){
+    int bc_id = m_event->p_bc_id.at(i);
+    if(m_event->p_pdg_id.at(i)==0){
       
-      event->push_back( xAOD::seed_t{m_p_et->at(i), m_p_eta->at(i), m_p_phi->at(i), m_p_px->at(i), m_p_py->at(i), m_p_pz->at(i), 0} );
+      event->push_back( xAOD::seed_t{m_event->p_et.at(i), m_event->p_eta.at(i), m_event->p_phi.at(i), m_event->p_px.at(i), m_event->p_py.at(i), m_event->p_pz.at(i), 0} );
     }
-    if( m_p_isMain->at(i) ){
-      if(m_p_pdg_id->at(i)!=0){
-        totalEnergy+= m_p_et->at(i);
-        Add( g4event, i, bc_id );
-        Add( g4event, i, special_bcid_for_truth_reconstruction );
+    if( m_event->p_isMain.at(i) ){
+      if(m_event->p_pdg_id.at(i)!=0){
+        totalEnergy+= m_event->p_et.at(i);
+        // Simulated once. The truth deposits come from the main event tag
+        Add( g4event, i, bc_id, true );
       }
     }else{
       Add( g4event, i, bc_id );
@@ -238,16 +194,25 @@ void EventReader::Load( G4Event* g4event, xAOD::EventInfo *event )
 }
 
 
-bool EventReader::Add( G4Event* g4event , int i, int bc_id )
+bool EventReader::Add( G4Event* g4event , int i, int bc_id, bool mainEvent )
 {
-  G4LorentzVector xvtx( m_p_prod_x->at(i), m_p_prod_y->at(i), m_p_prod_z->at(i), m_p_prod_t->at(i) + (bc_id*25*c_light)  );
-  if (! CheckVertexInsideWorld(xvtx.vect()*mm)) return false;
-  G4PrimaryVertex* g4vtx= new G4PrimaryVertex(  xvtx.x()*mm, xvtx.y()*mm, xvtx.z()*mm, xvtx.t()  );
-  G4int pdgcode= m_p_pdg_id->at(i);
-  G4LorentzVector p( m_p_px->at(i), m_p_py->at(i), m_p_pz->at(i),  m_p_e->at(i) );
+  // The particles of the same production vertex (HepMC input) share the geant vertex
+  int vtx = i < (int)m_event->p_vtx.size() ? m_event->p_vtx.at(i) : -1;
+  G4PrimaryVertex* g4vtx = vtx >= 0 && m_vertices.count(vtx) ? m_vertices[vtx] : nullptr;
+
+  if ( !g4vtx ){
+    G4LorentzVector xvtx( m_event->p_prod_x.at(i), m_event->p_prod_y.at(i), m_event->p_prod_z.at(i), m_event->p_prod_t.at(i) + (bc_id*25*c_light)  );
+    if (! CheckVertexInsideWorld(xvtx.vect()*mm)) return false;
+    g4vtx= new G4PrimaryVertex(  xvtx.x()*mm, xvtx.y()*mm, xvtx.z()*mm, xvtx.t()  );
+    g4event->AddPrimaryVertex(g4vtx);
+    if ( vtx >= 0 ) m_vertices[vtx] = g4vtx;
+  }
+
+  G4int pdgcode= m_event->p_pdg_id.at(i);
+  G4LorentzVector p( m_event->p_px.at(i), m_event->p_py.at(i), m_event->p_pz.at(i),  m_event->p_e.at(i) );
   G4PrimaryParticle* g4prim = new G4PrimaryParticle(pdgcode, p.x()*GeV, p.y()*GeV, p.z()*GeV);
+  if ( mainEvent ) g4prim->SetUserInformation( new PrimaryParticleInformation() );
   g4vtx->SetPrimary(g4prim);
-  g4event->AddPrimaryVertex(g4vtx);
   return true;
 }
 
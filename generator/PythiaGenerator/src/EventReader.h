@@ -2,14 +2,24 @@
 #define EventReader_h
 
 
-#include "TFile.h"
-#include "TTree.h"
+#include "EventSource.h"
 #include "EventInfo/EventInfo.h"
 #include "EventInfo/EventInfoContainer.h"
 #include "G4Kernel/PrimaryGenerator.h"
+#include "G4PrimaryVertex.hh"
+#include <map>
+#include <memory>
 
 
+class EventGenerator;
 
+
+/*
+ * Geant primary generator reading the particles trees of the event generator. All copies
+ * (one per geant thread) share the same EventSource, so the files are opened once and the
+ * events are read and decompressed ahead by a single I/O thread. With an event generator, the
+ * events are generated on the fly instead of read from the files.
+ */
 class EventReader : public PrimaryGenerator
 {
   public:
@@ -22,22 +32,22 @@ class EventReader : public PrimaryGenerator
 
     virtual void GeneratePrimaryVertex(G4Event* anEvent) override;
 
+    /*! Take the event from the source without simulating it (checkpoint) */
+    virtual void skipEvent(G4Event* anEvent) override;
+
 
     virtual StatusCode initialize() override;
     virtual StatusCode finalize() override;
 
     virtual PrimaryGenerator* copy() override;
 
-  private:
-    
+    /*! Stream the events of this generator (initialized and run by the reader) */
+    void setGenerator( EventGenerator *generator ){ m_generator=generator; };
 
+  private:
     
-    template <class T> void InitBranch(TTree* fChain, std::string branch_name, T* param, bool message=true);
-    
-    void link(TTree *t);
-    void clear();
-    void allocate();
-    void release();
+    /*! The source shared by all copies, created by the first one */
+    std::shared_ptr<EventSource> source();
 
     // We  have to take care for the position of primaries because
     // primary vertices outside the world voulme give rise to G4Execption.
@@ -47,32 +57,30 @@ class EventReader : public PrimaryGenerator
     
     void Load( G4Event *, xAOD::EventInfo *);
 
-    bool Add( G4Event* g4event , int i, int bc_id );
+    bool Add( G4Event* g4event , int i, int bc_id, bool mainEvent=false );
 
     unsigned int           m_evt;
     std::string            m_filename;
+    std::vector<std::string> m_inputFiles;
+    std::string            m_treeName;
+    std::string            m_inputFormat;
+    std::vector<int>       m_seedStatus;
+    std::vector<int>       m_seedParticles;
+    float                  m_seedMinEt;
     std::string            m_eventKey;
-
-    TFile *m_f;
-    TTree *m_ttree;
-
-    float m_avgmu;
-    std::vector<int>    *m_bc_id_nhits  ;	
-    std::vector<int>    *m_p_isMain		  ;
-    std::vector<int>    *m_p_pdg_id	    ;
-    std::vector<int>    *m_p_bc_id	    ;
-    std::vector<float>  *m_bc_mu				;
-    std::vector<float>  *m_p_px				  ;
-    std::vector<float>  *m_p_py         ;
-    std::vector<float>  *m_p_pz		      ;
-    std::vector<float>  *m_p_prod_x		  ;
-    std::vector<float>  *m_p_prod_y		  ;
-    std::vector<float>  *m_p_prod_z		  ;
-    std::vector<float>  *m_p_prod_t		  ;
-    std::vector<float>  *m_p_eta		    ;
-    std::vector<float>  *m_p_phi		    ;
-    std::vector<float>  *m_p_e		      ;
-    std::vector<float>  *m_p_et		      ;
+    int                    m_firstEvent;
+    int                    m_numberOfEvents;
+    int                    m_queueSize;
+    int                    m_cacheSize;
+
+    EventGenerator *m_generator; //!
+    // Owned by the copies. The original one only keeps a reference for the next copies
+    std::shared_ptr<EventSource> m_source; //!
+    std::weak_ptr<EventSource> m_shared; //!
+    // The current event
+    std::unique_ptr<primary_event_t> m_event; //!
+    // Geant vertices of the current event for each production vertex index
+    std::map<int, G4PrimaryVertex*> m_vertices; //!
 };
 
 #endif
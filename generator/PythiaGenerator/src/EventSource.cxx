@@ -0,0 +1,190 @@
+
+#include "EventSource.h"
+#include "TROOT.h"
+#include <algorithm>
+
+
+
+EventSource::EventSource( std::string name, long long nevents, unsigned queueSize ):
+  IMsgService(name),
+  m_nevents( std::max( nevents, 0LL ) ),
+  m_queueSize( std::max( queueSize, 1U ) ),
+  m_next(0),
+  m_wanted(-1),
+  m_stop(false),
+  m_done(false)
+{;}
+
+
+EventSource::~EventSource()
+{
+  stop();
+}
+
+
+void EventSource::start()
+{
+  m_thread = std::thread( [this](){
+    produce();
+    {
+      std::lock_guard<std::mutex> lock( m_mutex );
+      m_done = true;
+    }
+    // The events that were not produced will never come
+    m_loaded.notify_all();
+    MSG_DEBUG( "Producer thread finished after " << m_next << " events" );
+  });
+}
+
+
+void EventSource::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_stop = true;
+  }
+  m_consumed.notify_all();
+  m_loaded.notify_all();
+  if ( m_thread.joinable() ) m_thread.join();
+}
+
+
+bool EventSource::push( long long evt, std::unique_ptr<primary_event_t> event )
+{
+  {
+    std::unique_lock<std::mutex> lock( m_mutex );
+    m_consumed.wait( lock, [this]{
+      return m_stop || m_queue.size() < m_queueSize || m_wanted >= m_next;
+    });
+    if ( m_stop ) return false;
+    m_queue[evt] = std::move( event );
+    m_next = evt + 1;
+  }
+  m_loaded.notify_all();
+  return true;
+}
+
+
+std::unique_ptr<primary_event_t> EventSource::get( long long evt )
+{
+  if ( evt < 0 || evt >= m_nevents ) return nullptr;
+
+  std::unique_lock<std::mutex> lock( m_mutex );
+  if ( evt > m_wanted ){
+    m_wanted = evt;
+    m_consumed.notify_all();
+  }
+  m_loaded.wait( lock, [this, evt]{ return m_stop || m_done || m_queue.count(evt) || evt < m_next; } );
+  // Already taken by another thread or never produced
+  if ( !m_queue.count(evt) ) return nullptr;
+
+  auto event = std::move( m_queue[evt] );
+  m_queue.erase( evt );
+  lock.unlock();
+  m_consumed.notify_all();
+  return event;
+}
+
+
+
+TreeSource::TreeSource( std::vector<std::string> files, std::string treeName, long long first, long long nevents,
+                        unsigned queueSize, long long cacheSize ):
+  EventSource( "TreeSource", 0, queueSize ),
+  m_chain( treeName.c_str() ),
+  m_first( std::max( first, 0LL ) )
+{
+  ROOT::EnableThreadSafety();
+  for ( auto &file : files ){
+    MSG_INFO( "Add the root file: " << file );
+    m_chain.Add( file.c_str() );
+  }
+
+  long long entries = m_chain.GetEntries();
+  long long last = nevents < 0 ? entries : std::min( entries, m_first + nevents );
+  m_nevents = std::max( last - m_first, 0LL );
+  MSG_INFO( "Reading " << m_nevents << " events from the entry " << m_first << " (" << entries << " entries)" );
+
+  link();
+  // All branches are read in order, so the cache can prefetch the baskets of the whole range
+  m_chain.SetCacheSize( cacheSize );
+  m_chain.AddBranchToCache( "*", true );
+  m_chain.SetCacheEntryRange( m_first, m_first + m_nevents );
+  m_chain.StopCacheLearningPhase();
+
+  start();
+}
+
+
+TreeSource::~TreeSource()
+{
+  // The I/O thread uses the chain
+  stop();
+}
+
+
+template <class T>
+void TreeSource::InitBranch( std::string branch_name, T* param )
+{
+  std::string bname = branch_name;
+  if (m_chain.GetAlias(bname.c_str()))
+     bname = std::string(m_chain.GetAlias(bname.c_str()));
+
+  if (!m_chain.FindBranch(bname.c_str())) {
+    MSG_WARNING( "unknown branch " << bname );
+    return;
+  }
+  m_chain.SetBranchStatus(bname.c_str(), 1.);
+  m_chain.SetBranchAddress(bname.c_str(), param);
+}
+
+
+void TreeSource::link()
+{
+  m_bc_id_nhits = &m_buffer.bc_id_nhits;
+  m_p_isMain    = &m_buffer.p_isMain;
+  m_p_pdg_id    = &m_buffer.p_pdg_id;
+  m_p_bc_id     = &m_buffer.p_bc_id;
+  m_bc_mu       = &m_buffer.bc_mu;
+  m_p_px        = &m_buffer.p_px;
+  m_p_py        = &m_buffer.p_py;
+  m_p_pz        = &m_buffer.p_pz;
+  m_p_prod_x    = &m_buffer.p_prod_x;
+  m_p_prod_y    = &m_buffer.p_prod_y;
+  m_p_prod_z    = &m_buffer.p_prod_z;
+  m_p_prod_t    = &m_buffer.p_prod_t;
+  m_p_eta       = &m_buffer.p_eta;
+  m_p_phi       = &m_buffer.p_phi;
+  m_p_e         = &m_buffer.p_e;
+  m_p_et        = &m_buffer.p_et;
+
+  InitBranch( "avg_mu"      ,&m_buffer.avgmu  );
+  InitBranch( "p_isMain"    ,&m_p_isMain      );
+  InitBranch( "p_pdg_id"    ,&m_p_pdg_id      );
+  InitBranch( "p_bc_id"     ,&m_p_bc_id       );
+  InitBranch( "bc_mu"       ,&m_bc_mu         );
+  InitBranch( "bc_id_nhits" ,&m_bc_id_nhits   );
+  InitBranch( "p_px"        ,&m_p_px          );
+  InitBranch( "p_py"        ,&m_p_py          );
+  InitBranch( "p_pz"        ,&m_p_pz          );
+  InitBranch( "p_prod_x"    ,&m_p_prod_x      );
+  InitBranch( "p_prod_y"    ,&m_p_prod_y      );
+  InitBranch( "p_prod_z"    ,&m_p_prod_z      );
+  InitBranch( "p_prod_t"    ,&m_p_prod_t      );
+  InitBranch( "p_eta"       ,&m_p_eta         );
+  InitBranch( "p_phi"       ,&m_p_phi         );
+  InitBranch( "p_e"         ,&m_p_e           );
+  InitBranch( "p_et"        ,&m_p_et          );
+}
+
+
+void TreeSource::produce()
+{
+  for ( long long evt = 0; evt < m_nevents; ++evt )
+  {
+    if ( m_chain.GetEntry( m_first + evt ) <= 0 )
+      MSG_WARNING( "It's not possible to read the entry " << m_first + evt );
+    std::unique_ptr<primary_event_t> event( new primary_event_t() );
+    std::swap( *event, m_buffer );
+    if ( !push( evt, std::move(event) ) ) break;
+  }
+}
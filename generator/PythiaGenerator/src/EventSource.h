@@ -0,0 +1,143 @@
+#ifndef EventSource_h
+#define EventSource_h
+
+#include "GaugiKernel/MsgStream.h"
+#include "TChain.h"
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/*! The content of one entry of the particles tree */
+struct primary_event_t
+{
+  float avgmu=0;
+  std::vector<int>    bc_id_nhits;
+  std::vector<int>    p_isMain;
+  std::vector<int>    p_pdg_id;
+  std::vector<int>    p_bc_id;
+  std::vector<float>  bc_mu;
+  std::vector<float>  p_px;
+  std::vector<float>  p_py;
+  std::vector<float>  p_pz;
+  std::vector<float>  p_prod_x;
+  std::vector<float>  p_prod_y;
+  std::vector<float>  p_prod_z;
+  std::vector<float>  p_prod_t;
+  std::vector<float>  p_eta;
+  std::vector<float>  p_phi;
+  std::vector<float>  p_e;
+  std::vector<float>  p_et;
+  // Production vertex index of each particle (HepMC input only, empty for the particles tree)
+  std::vector<int>    p_vtx;
+};
+
+
+/*
+ * Events shared by all EventReader copies (one per geant thread). A single producer thread
+ * loads the events ahead of the geant threads into a bounded queue. The geant event i takes
+ * the event i of the source, so the output does not depend on the number of threads.
+ */
+class EventSource : public MsgService
+{
+  public:
+
+    /** Constructor **/
+    EventSource( std::string name, long long nevents, unsigned queueSize );
+    /** Destructor **/
+    virtual ~EventSource();
+
+    /*! Number of events */
+    long long size() const { return m_nevents; };
+
+    /*! Wait until the event is loaded and take it. Null if outside of the range or not produced */
+    std::unique_ptr<primary_event_t> get( long long evt );
+
+
+  protected:
+
+    /*! Start the producer thread */
+    void start();
+
+    /*! Stop and join the producer thread. Must be called by the derived destructors */
+    void stop();
+
+    /*! Add the next event into the queue. Wait while the queue is full, unless a geant thread 
+     *  waits for an event ahead of it. False if the source is stopped */
+    bool push( long long evt, std::unique_ptr<primary_event_t> event );
+
+    /*! Producer thread loop */
+    virtual void produce()=0;
+
+    long long m_nevents;
+
+
+  private:
+
+    unsigned m_queueSize;
+    // Loaded events waiting for a geant thread
+    std::map<long long, std::unique_ptr<primary_event_t>> m_queue;
+    // Next event to be pushed and the latest event asked by a geant thread
+    long long m_next;
+    long long m_wanted;
+    bool m_stop;
+    bool m_done;
+    std::mutex m_mutex;
+    std::condition_variable m_loaded;
+    std::condition_variable m_consumed;
+    std::thread m_thread;
+};
+
+
+
+/*
+ * Source of the particles trees. The I/O thread reads the entries of the chain in order,
+ * through the TTreeCache, so the decompression runs outside of the geant threads.
+ */
+class TreeSource : public EventSource
+{
+  public:
+
+    /** Constructor. Open the chain and start the I/O thread (nevents < 0 reads all entries) **/
+    TreeSource( std::vector<std::string> files, std::string treeName, long long first, long long nevents,
+                unsigned queueSize, long long cacheSize );
+    /** Destructor **/
+    ~TreeSource();
+
+
+  private:
+
+    template <class T> void InitBranch( std::string branch_name, T* param );
+
+    void link();
+
+    virtual void produce() override;
+
+    TChain m_chain;
+    long long m_first;
+
+    // Branch buffers, swapped into the queued events after each read
+    primary_event_t m_buffer;
+    std::vector<int>    *m_bc_id_nhits;
+    std::vector<int>    *m_p_isMain;
+    std::vector<int>    *m_p_pdg_id;
+    std::vector<int>    *m_p_bc_id;
+    std::vector<float>  *m_bc_mu;
+    std::vector<float>  *m_p_px;
+    std::vector<float>  *m_p_py;
+    std::vector<float>  *m_p_pz;
+    std::vector<float>  *m_p_prod_x;
+    std::vector<float>  *m_p_prod_y;
+    std::vector<float>  *m_p_prod_z;
+    std::vector<float>  *m_p_prod_t;
+    std::vector<float>  *m_p_eta;
+    std::vector<float>  *m_p_phi;
+    std::vector<float>  *m_p_e;
+    std::vector<float>  *m_p_et;
+};
+
+#endif
@@ -0,0 +1,54 @@
+
+#include "GeneratorSource.h"
+
+
+
+GeneratorSource::GeneratorSource( EventGenerator *generator, unsigned queueSize ):
+  EventSource( "GeneratorSource", 0, queueSize ),
+  m_generator(generator)
+{
+  float nevents=0;
+  m_generator->getProperty( "NumberOfEvents", nevents );
+  m_nevents = (long long)nevents;
+  MSG_INFO( "Streaming " << m_nevents << " generated events" );
+  start();
+}
+
+
+GeneratorSource::~GeneratorSource()
+{
+  // The generator stops at the next event, when the push fails
+  stop();
+}
+
+
+void GeneratorSource::produce()
+{
+  m_generator->setConsumer( [this]( int iEvent, generated_event_t &gen ){
+    std::unique_ptr<primary_event_t> event( new primary_event_t() );
+    event->avgmu       = gen.avg_mu;
+    event->bc_id_nhits = std::move( gen.bc_id_nhits );
+    event->p_isMain    = std::move( gen.p_isMain    );
+    event->p_pdg_id    = std::move( gen.p_pdg_id    );
+    event->p_bc_id     = std::move( gen.p_bc_id     );
+    event->bc_mu       = std::move( gen.bc_id_mu    );
+    event->p_px        = std::move( gen.p_px        );
+    event->p_py        = std::move( gen.p_py        );
+    event->p_pz        = std::move( gen.p_pz        );
+    event->p_prod_x    = std::move( gen.p_prod_x    );
+    event->p_prod_y    = std::move( gen.p_prod_y    );
+    event->p_prod_z    = std::move( gen.p_prod_z    );
+    event->p_prod_t    = std::move( gen.p_prod_t    );
+    event->p_eta       = std::move( gen.p_eta       );
+    event->p_phi       = std::move( gen.p_phi       );
+    event->p_e         = std::move( gen.p_e         );
+    event->p_et        = std::move( gen.p_et        );
+    return push( iEvent, std::move(event) );
+  });
+
+  if ( m_generator->initialize().isFailure() || m_generator->run().isFailure() ){
+    MSG_ERROR( "The event generation failed. The remaining events will not be simulated." );
+  }
+  m_generator->finalize();
+  m_generator->setConsumer( nullptr );
+}
@@ -0,0 +1,31 @@
+#ifndef GeneratorSource_h
+#define GeneratorSource_h
+
+#include "EventSource.h"
+#include "EventGenerator.h"
+
+
+/*
+ * Events generated on the fly for the geant threads. The producer thread runs the event 
+ * generator (with its own worker threads) and pushes each event into the queue instead of 
+ * reading it back from the particles file. The particles are still written if the generator 
+ * has an output file.
+ */
+class GeneratorSource : public EventSource
+{
+  public:
+
+    /** Constructor. Start the producer thread (the generator is initialized there) **/
+    GeneratorSource( EventGenerator *generator, unsigned queueSize );
+    /** Destructor. Stop the generator **/
+    ~GeneratorSource();
+
+
+  private:
+
+    virtual void produce() override;
+
+    EventGenerator *m_generator;
+};
+
+#endif
@@ -0,0 +1,132 @@
+
+#include "HepMCSource.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <map>
+
+#ifdef LZT_HEPMC3
+#include "HepMC3/GenEvent.h"
+#include "HepMC3/GenParticle.h"
+#include "HepMC3/GenVertex.h"
+#include "HepMC3/ReaderAscii.h"
+#ifdef LZT_HEPMC3_ROOTIO
+#include "HepMC3/ReaderRootTree.h"
+#endif
+#endif
+
+
+
+HepMCSource::HepMCSource( std::vector<std::string> files, std::string format, long long first, long long nevents,
+                          unsigned queueSize, std::vector<int> seedStatus, std::vector<int> seedParticles, 
+                          float seedMinEt ):
+  EventSource( "HepMCSource", nevents < 0 ? LLONG_MAX : nevents, queueSize ),
+  m_files(files),
+  m_format(format),
+  m_first( std::max( first, 0LL ) ),
+  m_seedStatus(seedStatus),
+  m_seedParticles(seedParticles),
+  m_seedMinEt(seedMinEt)
+{
+#ifndef LZT_HEPMC3
+  MSG_ERROR( "The HepMC3 input is not available in this build (LZT_HEPMC3)." );
+#endif
+  start();
+}
+
+
+HepMCSource::~HepMCSource()
+{
+  stop();
+}
+
+
+void HepMCSource::produce()
+{
+#ifdef LZT_HEPMC3
+  using namespace HepMC3;
+
+  long long evt = 0;
+  long long skip = m_first;
+
+  for ( auto &file : m_files )
+  {
+    MSG_INFO( "Open the HepMC3 file: " << file );
+    std::shared_ptr<Reader> reader;
+    if ( m_format == "hepmc3root" ){
+#ifdef LZT_HEPMC3_ROOTIO
+      reader = std::make_shared<ReaderRootTree>( file );
+#else
+      MSG_ERROR( "The HepMC3 ROOT input is not available in this build." );
+      return;
+#endif
+    }else{
+      reader = std::make_shared<ReaderAscii>( file );
+    }
+    // A missing or unreadable file must not look like an empty one
+    if ( reader->failed() ){
+      MSG_ERROR( "It's not possible to read the HepMC3 file " << file << ". Stopping the input..." );
+      reader->close();
+      return;
+    }
+
+    while ( evt < m_nevents )
+    {
+      GenEvent genevt( Units::GEV, Units::MM );
+      if ( !reader->read_event( genevt ) || reader->failed() ) break;
+      if ( skip > 0 ){ --skip; continue; }
+      // Same units of the particles tree
+      genevt.set_units( Units::GEV, Units::MM );
+
+      std::unique_ptr<primary_event_t> event( new primary_event_t() );
+      // HepMC vertex id -> vertex index of the event
+      std::map<int, int> vertices;
+
+      auto et = []( const FourVector &mom ){ return mom.pt() > 0 ? mom.e() * mom.pt() / mom.p3mod() : 0; };
+      auto add = [&event, &et]( const ConstGenParticlePtr &p, int pdg, const FourVector &pos, int vtx ){
+        const FourVector &mom = p->momentum();
+        event->p_isMain.push_back( 1 );
+        event->p_pdg_id.push_back( pdg );
+        event->p_bc_id.push_back( 0 );
+        event->p_px.push_back( mom.px() );
+        event->p_py.push_back( mom.py() );
+        event->p_pz.push_back( mom.pz() );
+        event->p_prod_x.push_back( pos.x() );
+        event->p_prod_y.push_back( pos.y() );
+        event->p_prod_z.push_back( pos.z() );
+        event->p_prod_t.push_back( pos.t() );
+        event->p_eta.push_back( mom.pt() > 0 ? mom.eta() : 0 );
+        event->p_phi.push_back( mom.phi() );
+        event->p_e.push_back( mom.e() );
+        event->p_et.push_back( et( mom ) );
+        event->p_vtx.push_back( vtx );
+      };
+
+      for ( auto &p : genevt.particles() )
+      {
+        // Seeds (not simulated)
+        bool status = m_seedStatus.empty() || 
+                      std::count( m_seedStatus.begin(), m_seedStatus.end(), p->status() );
+        bool pdg    = m_seedParticles.empty() || 
+                      std::count( m_seedParticles.begin(), m_seedParticles.end(), std::abs(p->pid()) );
+        bool select = !m_seedStatus.empty() || !m_seedParticles.empty();
+        if ( select && status && pdg && et( p->momentum() ) >= m_seedMinEt && p->momentum().pt() > 0 ){
+          add( p, 0, FourVector(), -1 );
+        }
+
+        // Final state particles, grouped by production vertex
+        if ( p->status() != 1 ) continue;
+        auto v = p->production_vertex();
+        int id = v ? v->id() : 0;
+        int index = vertices.emplace( id, (int)vertices.size() ).first->second;
+        add( p, p->pid(), v ? v->position() : genevt.event_pos(), index );
+      }
+
+      if ( !push( evt++, std::move(event) ) ) return;
+    }
+    reader->close();
+    if ( evt >= m_nevents ) break;
+  }
+  MSG_INFO( "Read " << evt << " HepMC3 events." );
+#endif
+}
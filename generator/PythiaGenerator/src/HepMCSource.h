@@ -0,0 +1,38 @@
+#ifndef HepMCSource_h
+#define HepMCSource_h
+
+#include "EventSource.h"
+
+
+/*
+ * Source of the HepMC3 files (ASCII or ROOT) of external generators, read event by event 
+ * without converting them into the particles tree first. The final state particles are the 
+ * main event and keep the index of their production vertex, so the EventReader creates one 
+ * geant vertex per HepMC vertex. The seeds are the particles selected by status, pdg id 
+ * (absolute value) and minimum transverse energy. Requires the LZT_HEPMC3 build.
+ */
+class HepMCSource : public EventSource
+{
+  public:
+
+    /** Constructor. Start the reader thread (nevents < 0 reads all events) **/
+    HepMCSource( std::vector<std::string> files, std::string format, long long first, long long nevents,
+                 unsigned queueSize, std::vector<int> seedStatus, std::vector<int> seedParticles, 
+                 float seedMinEt );
+    /** Destructor **/
+    ~HepMCSource();
+
+
+  private:
+
+    virtual void produce() override;
+
+    std::vector<std::string> m_files;
+    std::string m_format;
+    long long m_first;
+    std::vector<int> m_seedStatus;
+    std::vector<int> m_seedParticles;
+    float m_seedMinEt;
+};
+
+#endif
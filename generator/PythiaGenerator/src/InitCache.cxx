@@ -0,0 +1,82 @@
+
+#include "InitCache.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Pythia8;
+
+
+
+InitCache::InitCache( std::string dir ):
+  IMsgService("InitCache"),
+  m_dir(dir)
+{;}
+
+
+std::string InitCache::key( const std::string &cmndFile ) const
+{
+  // FNV-1a (the same for all builds)
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  auto add = [&hash]( const std::string &s ){
+    for ( unsigned char c : s ){ hash ^= c; hash *= 0x100000001b3ULL; }
+  };
+
+  std::stringstream version; version << PYTHIA_VERSION;
+  add( version.str() );
+
+  std::ifstream file( cmndFile );
+  std::string line;
+  while ( std::getline( file, line ) ){
+    // Drop comments and spaces
+    line = line.substr( 0, line.find('!') );
+    line.erase( std::remove_if( line.begin(), line.end(), ::isspace ), line.end() );
+    // The seed does not change the tables
+    if ( line.empty() || line.rfind( "Random:", 0 ) == 0 ) continue;
+    add( line );
+  }
+
+  std::stringstream ss; ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return ss.str();
+}
+
+
+bool InitCache::init( Pythia &pythia, const std::string &cmndFile )
+{
+  if ( m_dir.empty() || !pythia.flag("PartonLevel:MPI") ) return pythia.init();
+
+  mkdir( m_dir.c_str(), 0755 );
+  std::string path = m_dir + "/mpi_" + key( cmndFile ) + ".dat";
+  std::ifstream cached( path );
+
+  if ( cached.good() ){
+    MSG_INFO( "Reusing the initialization tables from " << path );
+    pythia.readString( "MultipartonInteractions:reuseInit = 2" );
+    pythia.settings.word( "MultipartonInteractions:initFile", path );
+    if ( pythia.init() ) return true;
+    MSG_WARNING( "It's not possible to reuse " << path << ". Running the full initialization..." );
+    pythia.readString( "MultipartonInteractions:reuseInit = 0" );
+    return pythia.init();
+  }
+
+  // Write into a temporary file and publish it after the initialization
+  std::stringstream tmp;
+  tmp << path << ".tmp" << getpid() << "_" << std::hash<std::thread::id>()( std::this_thread::get_id() );
+  pythia.readString( "MultipartonInteractions:reuseInit = 1" );
+  pythia.settings.word( "MultipartonInteractions:initFile", tmp.str() );
+  bool status = pythia.init();
+  if ( status && std::rename( tmp.str().c_str(), path.c_str() ) == 0 ){
+    MSG_INFO( "Initialization tables saved into " << path );
+  }else{
+    std::remove( tmp.str().c_str() );
+  }
+  return status;
+}
+
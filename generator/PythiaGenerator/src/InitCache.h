@@ -0,0 +1,35 @@
+#ifndef InitCache_h
+#define InitCache_h
+
+#include "Pythia8/Pythia.h"
+#include "GaugiKernel/MsgStream.h"
+#include <string>
+
+
+/*
+ * Cache of the pythia initialization tables (multiparton interactions) shared by all jobs.
+ * The tables are stored into the cache directory with the hash of the .cmnd configuration
+ * (and of the pythia version) in the name. Missing tables are written into a temporary file
+ * and renamed after the initialization, so concurrent jobs never read a partial file.
+ */
+class InitCache : public MsgService
+{
+  public:
+    
+    /*! Constructor. Disabled if the directory is empty */
+    InitCache( std::string dir );
+    
+    /*! Configure, initialize and publish the tables. Fall back to the full initialization
+     *  if the cached tables can not be read */
+    bool init( Pythia8::Pythia &pythia, const std::string &cmndFile );
+
+
+  private:
+
+    /*! Hash of the configuration file without comments and random seeds */
+    std::string key( const std::string &cmndFile ) const;
+
+    std::string m_dir;
+};
+
+#endif
@@ -26,6 +26,11 @@ JF17::JF17():
   declareProperty( "OutputLevel"    , m_outputLevel=1             );
   declareProperty( "EtaWindow"      , m_etaWindow=0.4             );
   declareProperty( "PhiWindow"      , m_phiWindow=0.4             );
+  /* Veto the events without any parton cone above VetoPtFraction*MinPt before the hadronization */
+  declareProperty( "UseVeto"        , m_useVeto=true              );
+  /* Reuse the pythia initialization tables from this directory (disabled if empty) */
+  declareProperty( "InitCacheDir"   , m_initCacheDir=""           );
+  declareProperty( "VetoPtFraction" , m_vetoPtFraction=0.5        );
 }
 
 
@@ -39,8 +44,12 @@ StatusCode JF17::initialize()
   m_pythia.readString("Random:setSeed = on");
   m_pythia.readString(cmdseed.str());
   m_nAbort = m_pythia.mode("Main:timesAllowErrors");
+  if ( m_useVeto ){
+    m_veto = std::make_shared<JetVeto>( m_etaMax, m_vetoPtFraction*m_minPt/1.e3 );
+    setUserHooks( m_pythia, m_veto );
+  }
   // Initialization for main (LHC) event
-  m_pythia.init();
+  InitCache( m_initCacheDir ).init( m_pythia, m_mainFile );
 
   return StatusCode::SUCCESS;
 }
@@ -49,6 +58,7 @@ StatusCode JF17::initialize()
 
 StatusCode JF17::run( std::vector<xAOD::seed_t> &seed_vec, std::vector<std::vector<Particle*>>& particles )
 {
+  ScopedTimer timer( m_stats.seconds );
 
   // Generate main event. Quit if too many failures.
   if (!m_pythia.next()) {
@@ -58,6 +68,7 @@ StatusCode JF17::run( std::vector<xAOD::seed_t> &seed_vec, std::vector<std::vect
     }
   }
 
+  m_stats.generated++;
   double weight = m_pythia.info.mergingWeight();
   double evtweight = m_pythia.info.weight();
   weight *= evtweight;
@@ -159,7 +170,7 @@ StatusCode JF17::run( std::vector<xAOD::seed_t> &seed_vec, std::vector<std::vect
     cx++;
   }
 
-
+  m_stats.accepted++;
   return StatusCode::SUCCESS;
 }
 
@@ -169,12 +180,32 @@ StatusCode JF17::finalize()
 {
   MSG_INFO( "Finalize the JF17 Event." );
   m_pythia.stat();
+  MSG_INFO( "JF17 filter: " << m_stats.report( m_veto ? m_veto->vetoed() : 0 ) );
   return StatusCode::SUCCESS;
 }
 
 
 
+Physics* JF17::clone() const
+{
+  auto *tool = new JF17();
+  tool->m_mainFile    = m_mainFile;
+  tool->m_etaMax      = m_etaMax;
+  tool->m_minPt       = m_minPt;
+  tool->m_select      = m_select;
+  tool->m_seed        = m_seed;
+  tool->m_outputLevel = m_outputLevel;
+  tool->m_etaWindow   = m_etaWindow;
+  tool->m_phiWindow   = m_phiWindow;
+  tool->m_useVeto     = m_useVeto;
+  tool->m_initCacheDir = m_initCacheDir;
+  tool->m_vetoPtFraction = m_vetoPtFraction;
+  return tool;
+}
 
 
-
+void JF17::setEventSeed( int seed )
+{
+  m_pythia.rndm.init( seed );
+}
 
@@ -3,6 +3,8 @@
 
 #include "Pythia8/Pythia.h"
 #include "EventGenerator.h"
+#include "VetoHooks.h"
+#include "InitCache.h"
 
 class JF17 : public Physics
 {
@@ -14,6 +16,8 @@ class JF17 : public Physics
     virtual StatusCode initialize() override;
     virtual StatusCode run( std::vector<xAOD::seed_t>&, std::vector<std::vector<Pythia8::Particle*>> &) override;
     virtual StatusCode finalize() override;
+    virtual Physics* clone() const override;
+    virtual void setEventSeed( int seed ) override;
 
   private:
 
@@ -26,9 +30,14 @@ class JF17 : public Physics
     float m_etaMax;
     float m_etaWindow;
     float m_phiWindow;
+    bool m_useVeto;
+    float m_vetoPtFraction;
  
     std::string m_mainFile;
+    std::string m_initCacheDir;
     
     Pythia8::Pythia m_pythia;
+    std::shared_ptr<JetVeto> m_veto;
+    filter_stats_t m_stats;
 };
 #endif
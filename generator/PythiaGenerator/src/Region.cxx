@@ -41,3 +41,13 @@ StatusCode Region::finalize()
 }
 
 
+
+Physics* Region::clone() const
+{
+  auto *tool = new Region();
+  tool->m_eta         = m_eta;
+  tool->m_phi         = m_phi;
+  tool->m_outputLevel = m_outputLevel;
+  return tool;
+}
+
@@ -14,6 +14,9 @@ class Region : public Physics
     virtual StatusCode initialize() override;
     virtual StatusCode run( std::vector<xAOD::seed_t>&, std::vector<std::vector<Pythia8::Particle*>> &) override;
     virtual StatusCode finalize() override;
+    virtual Physics* clone() const override;
+    /*! No random numbers here */
+    virtual void setEventSeed( int ) override {};
 
   private:
 
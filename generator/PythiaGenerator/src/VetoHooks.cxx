@@ -0,0 +1,76 @@
+
+#include "VetoHooks.h"
+#include <cmath>
+#include <sstream>
+
+using namespace Pythia8;
+
+
+// Tolerance for the eta shift from the radiation and the hadronization
+static const float eta_margin = 0.1;
+// Jet cone used by the parton level filter
+static const float cone_size = 0.4;
+// Lowest pT (GeV) of the cone axis
+static const float cone_min_pt = 1.0;
+
+
+ZeeVeto::ZeeVeto( float etaMax, float minPt ):
+  UserHooks(),
+  m_etaMax(etaMax),
+  m_minPt(minPt),
+  m_vetoed(0)
+{;}
+
+
+bool ZeeVeto::doVetoResonanceDecays( Event &process )
+{
+  for ( int i = 0; i < process.size(); ++i ){
+    const auto &p = process[i];
+    if ( p.idAbs() != 11 || !p.isFinal() || process[p.mother1()].id() != 23 ) continue;
+    // The photon radiation only reduces the electron pT
+    if ( std::abs(p.eta()) < m_etaMax + eta_margin && p.pT() > m_minPt ) return false;
+  }
+  m_vetoed++;
+  return true;
+}
+
+
+
+JetVeto::JetVeto( float etaMax, float minPt ):
+  UserHooks(),
+  m_etaMax(etaMax),
+  m_minPt(minPt),
+  m_vetoed(0)
+{;}
+
+
+bool JetVeto::doVetoPartonLevel( const Event &event )
+{
+  for ( int i = 0; i < event.size(); ++i ){
+    const auto &axis = event[i];
+    if ( !axis.isFinal() || axis.pT() < cone_min_pt || std::abs(axis.eta()) > m_etaMax + cone_size ) continue;
+    double pt = 0;
+    for ( int j = 0; j < event.size(); ++j ){
+      const auto &p = event[j];
+      if ( !p.isFinal() || !p.isVisible() ) continue;
+      if ( REtaPhi( axis.p(), p.p() ) < cone_size ) pt += p.pT();
+    }
+    if ( pt > m_minPt ) return false;
+  }
+  m_vetoed++;
+  return true;
+}
+
+
+
+std::string filter_stats_t::report( unsigned long long vetoed ) const
+{
+  std::stringstream ss;
+  auto total = generated + vetoed;
+  ss << accepted << " accepted of " << total << " events (" << vetoed << " vetoed by the hooks, " 
+     << generated - accepted << " rejected by the full event filter). Efficiency: " 
+     << ( total ? 100.*accepted/total : 0 ) << "%, " 
+     << ( accepted ? seconds/accepted : 0 ) << " s per accepted event.";
+  return ss.str();
+}
+
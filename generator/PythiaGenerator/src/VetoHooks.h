@@ -0,0 +1,91 @@
+#ifndef VetoHooks_h
+#define VetoHooks_h
+
+#include "Pythia8/Pythia.h"
+#include <chrono>
+#include <memory>
+#include <string>
+
+
+/*
+ * Early vetoes of the main event generation. Pythia restarts the event as soon as the
+ * hook vetoes it, so the hadronization (and the full event filter) only runs for the events
+ * that can pass the selection. The cuts are looser than the ones applied to the final event.
+ */
+
+
+/*! Veto the Z decays without any electron in the acceptance (process record after the decays) */
+class ZeeVeto : public Pythia8::UserHooks
+{
+  public:
+    /*! minPt in GeV */
+    ZeeVeto( float etaMax, float minPt );
+
+    virtual bool canVetoResonanceDecays() override { return true; };
+    virtual bool doVetoResonanceDecays( Pythia8::Event &process ) override;
+
+    unsigned long long vetoed() const { return m_vetoed; };
+
+  private:
+    float m_etaMax;
+    float m_minPt;
+    unsigned long long m_vetoed;
+};
+
+
+/*! Veto the events without any parton cone (Delta R < 0.4) above the pT fraction of the jet cut */
+class JetVeto : public Pythia8::UserHooks
+{
+  public:
+    /*! minPt in GeV */
+    JetVeto( float etaMax, float minPt );
+
+    virtual bool canVetoPartonLevel() override { return true; };
+    virtual bool doVetoPartonLevel( const Pythia8::Event &event ) override;
+
+    unsigned long long vetoed() const { return m_vetoed; };
+
+  private:
+    float m_etaMax;
+    float m_minPt;
+    unsigned long long m_vetoed;
+};
+
+
+/*! Efficiency and time per accepted event of the main event filter */
+struct filter_stats_t {
+  // Events returned by pythia
+  unsigned long long generated=0;
+  unsigned long long accepted=0;
+  double seconds=0;
+
+  /*! One line report (vetoed are the events killed by the hooks) */
+  std::string report( unsigned long long vetoed ) const;
+};
+
+
+/*! Add the time spent in the scope (in seconds) into the counter */
+class ScopedTimer
+{
+  public:
+    ScopedTimer( double &seconds ): m_seconds(seconds), m_start( std::chrono::steady_clock::now() ) {};
+    ~ScopedTimer(){ m_seconds += std::chrono::duration<double>( std::chrono::steady_clock::now() - m_start ).count(); };
+  private:
+    double &m_seconds;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+
+/*! Give the hooks to pythia (raw pointers before pythia 8.3) */
+template<class T>
+void setUserHooks( Pythia8::Pythia &pythia, std::shared_ptr<T> hooks )
+{
+#if PYTHIA_VERSION_INTEGER >= 8300
+  pythia.setUserHooksPtr( hooks );
+#else
+  pythia.setUserHooksPtr( hooks.get() );
+#endif
+}
+
+
+#endif
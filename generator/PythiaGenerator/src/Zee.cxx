@@ -14,6 +14,10 @@ Zee::Zee():
   declareProperty( "MinPt"          , m_minPt=0.0                 );
   declareProperty( "Seed"           , m_seed=0 /* clock system */ );
   declareProperty( "OutputLevel"    , m_outputLevel=1             );
+  /* Veto the Z decays without electrons in the acceptance before the hadronization */
+  declareProperty( "UseVeto"        , m_useVeto=true              );
+  /* Reuse the pythia initialization tables from this directory (disabled if empty) */
+  declareProperty( "InitCacheDir"   , m_initCacheDir=""           );
 }
 
 
@@ -26,8 +30,12 @@ StatusCode Zee::initialize()
   m_pythia.readString("Random:setSeed = on");
   m_pythia.readString(cmdseed.str());
   m_nAbort = m_pythia.mode("Main:timesAllowErrors");
+  if ( m_useVeto ){
+    m_veto = std::make_shared<ZeeVeto>( m_etaMax, m_minPt/1.e3 );
+    setUserHooks( m_pythia, m_veto );
+  }
   // Initialization for main (LHC) event
-  m_pythia.init();
+  InitCache( m_initCacheDir ).init( m_pythia, m_mainFile );
 
   return StatusCode::SUCCESS;
 }
@@ -36,7 +44,7 @@ StatusCode Zee::initialize()
 
 StatusCode Zee::run( std::vector<xAOD::seed_t> &seed_vec,  std::vector<std::vector<Particle*>> &particles )
 {
-
+  ScopedTimer timer( m_stats.seconds );
 
   // Generate main event. Quit if too many failures.
   if (!m_pythia.next()) {
@@ -46,11 +54,13 @@ StatusCode Zee::run( std::vector<xAOD::seed_t> &seed_vec,  std::vector<std::vect
     }
   }
 
+  m_stats.generated++;
   double weight = m_pythia.info.mergingWeight();
   double evtweight = m_pythia.info.weight();
   weight *= evtweight;
 
-  auto event = m_pythia.event;
+  // The particles are kept by pointer, so do not copy the event
+  auto &event = m_pythia.event;
   // Do not print zero-weight events.
   if ( weight == 0. ) {
     return StatusCode::FAILURE;
@@ -101,7 +111,7 @@ StatusCode Zee::run( std::vector<xAOD::seed_t> &seed_vec,  std::vector<std::vect
                                       e->id() } );
   }
 
-  
+  m_stats.accepted++;
   return StatusCode::SUCCESS;
 }
 
@@ -111,7 +121,28 @@ StatusCode Zee::finalize()
 {
   MSG_INFO( "Finalize the Zee Event." );
   m_pythia.stat();
+  MSG_INFO( "Zee filter: " << m_stats.report( m_veto ? m_veto->vetoed() : 0 ) );
   return StatusCode::SUCCESS;
 }
 
 
+
+Physics* Zee::clone() const
+{
+  auto *tool = new Zee();
+  tool->m_mainFile    = m_mainFile;
+  tool->m_etaMax      = m_etaMax;
+  tool->m_minPt       = m_minPt;
+  tool->m_seed        = m_seed;
+  tool->m_outputLevel = m_outputLevel;
+  tool->m_useVeto     = m_useVeto;
+  tool->m_initCacheDir = m_initCacheDir;
+  return tool;
+}
+
+
+void Zee::setEventSeed( int seed )
+{
+  m_pythia.rndm.init( seed );
+}
+
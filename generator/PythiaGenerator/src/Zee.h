@@ -3,6 +3,8 @@
 
 #include "Pythia8/Pythia.h"
 #include "EventGenerator.h"
+#include "VetoHooks.h"
+#include "InitCache.h"
 
 
 class Zee : public Physics
@@ -14,6 +16,8 @@ class Zee : public Physics
     virtual StatusCode initialize() override;
     virtual StatusCode run( std::vector<xAOD::seed_t>&, std::vector<std::vector<Pythia8::Particle*>> &) override;
     virtual StatusCode finalize() override;
+    virtual Physics* clone() const override;
+    virtual void setEventSeed( int seed ) override;
 
   private:
 
@@ -24,9 +28,13 @@ class Zee : public Physics
     int m_outputLevel;
     float m_minPt;
     float m_etaMax;
+    bool m_useVeto;
  
     std::string m_mainFile;
+    std::string m_initCacheDir;
    
     Pythia8::Pythia m_pythia;
+    std::shared_ptr<ZeeVeto> m_veto;
+    filter_stats_t m_stats;
 };
 #endif
@@ -8,7 +8,8 @@ from G4Kernel import treatPropertyValue
 
 class DetectorConstruction(Logger):
 
-  __allow_keys = []
+  __allow_keys = ["UseFastSimulation", "FastSimulationRegions", "FastSimulationMinEnergy", "FastSimulationMaxEnergy",
+                  "UseShowerLibrary", "ShowerLibraryFiles"]
   
   def __init__( self, name, **kw ):
 
@@ -20,6 +20,9 @@
 #include "G4UniformMagField.hh"
 #include "G4TransportationManager.hh"
 #include "G4FieldManager.hh"
+#include "G4RegionStore.hh"
+#include "G4Kernel/ShowerParametrization.h"
+#include "G4Kernel/FrozenShowerModel.h"
 #include <string>
 #include <sstream>
 
@@ -33,8 +36,17 @@ DetectorGenericConstruction::DetectorGenericConstruction(std::string name)
  : 
   IMsgService(name), 
    G4VUserDetectorConstruction(),
+   PropertyService(),
    m_checkOverlaps(true)
 {
+  declareProperty( "UseFastSimulation"       , m_useFastSimulation=false            );
+  declareProperty( "FastSimulationRegions"   , m_fastSimulationRegions={"EM1","EM2","EM3"} );
+  // Energy window (in MeV) of the e+/e-/gamma replaced by the parametrized showers
+  declareProperty( "FastSimulationMinEnergy" , m_fastSimulationMinEnergy=1000       );
+  declareProperty( "FastSimulationMaxEnergy" , m_fastSimulationMaxEnergy=1e7        );
+  // Frozen showers (built with the ShowerLibraryFile of the RunManager) for the same regions
+  declareProperty( "UseShowerLibrary"        , m_useShowerLibrary=false             );
+  declareProperty( "ShowerLibraryFiles"      , m_showerLibraryFiles={}              );
   MSG_INFO( "GenericDetectorContruction was created" );
 }
 
@@ -447,6 +459,25 @@ void DetectorGenericConstruction::ConstructSDandField()
   m_magFieldMessenger = new G4GlobalMagFieldMessenger(fieldValue);
   m_magFieldMessenger->SetVerboseLevel(1);
   ////// Create magnetic field
+
+  // The fast simulation models are thread local, so they must be created here. The models
+  // are tried in the creation order, so the frozen showers come before the parametrization
+  if ( m_useFastSimulation || m_useShowerLibrary ){
+    std::shared_ptr<const ShowerLibrary> library;
+    if ( m_useShowerLibrary ) library = ShowerLibrary::load( m_showerLibraryFiles );
+    for ( auto &name : m_fastSimulationRegions ){
+      G4Region *region = G4RegionStore::GetInstance()->GetRegion( name );
+      if ( !region ){
+        MSG_WARNING( "There is no region with name " << name << ". Skipping the fast simulation for it." );
+        continue;
+      }
+      if ( library )
+        G4AutoDelete::Register( new FrozenShowerModel( name+"_FrozenShowerModel", region, library ) );
+      if ( m_useFastSimulation )
+        G4AutoDelete::Register( new ShowerParametrization( name+"_ShowerParametrization", region,
+                                                           m_fastSimulationMinEnergy, m_fastSimulationMaxEnergy ) );
+    }
+  }
 }
 
 void DetectorGenericConstruction::CreateBarrel(  G4LogicalVolume *worldLV,
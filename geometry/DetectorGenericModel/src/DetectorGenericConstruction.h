@@ -2,6 +2,7 @@
 #define DetectorGenericConstruction_h
 
 #include "GaugiKernel/MsgStream.h"
+#include "GaugiKernel/Property.h"
 #include "G4VUserDetectorConstruction.hh"
 #include "G4Material.hh"
 #include "G4ThreeVector.hh"
@@ -13,7 +14,7 @@ class G4VPhysicalVolume;
 class G4GlobalMagFieldMessenger;
 
 
-class DetectorGenericConstruction : public G4VUserDetectorConstruction, public MsgService
+class DetectorGenericConstruction : public G4VUserDetectorConstruction, public MsgService, public Gaugi::PropertyService
 {
   public:
     DetectorGenericConstruction(std::string);
@@ -49,6 +50,16 @@ class DetectorGenericConstruction : public G4VUserDetectorConstruction, public M
 
     static G4ThreadLocal G4GlobalMagFieldMessenger*  m_magFieldMessenger; // magnetic field messenger
     bool m_checkOverlaps; // option to activate checking of volumes overlaps
+
+    // GFlash-like parametrization of the EM showers (see ShowerParametrization)
+    bool m_useFastSimulation;
+    std::vector<std::string> m_fastSimulationRegions;
+    float m_fastSimulationMinEnergy;
+    float m_fastSimulationMaxEnergy;
+
+    // Frozen showers replayed before the parametrization (see FrozenShowerModel)
+    bool m_useShowerLibrary;
+    std::vector<std::string> m_showerLibraryFiles;
 };
 
 
@@ -78,10 +78,12 @@ class CaloCellBuilder( Logger ):
   __basepath = os.environ['LZT_PATH']+'/geometry/DetectorGenericModel/data/'
 
 
-  def __init__( self, name, HistogramPath = "Expert", OutputLevel=1):
+  def __init__( self, name, HistogramPath = "Expert", OutputLevel=1, RoIDeltaR=0):
 
     Logger.__init__(self)
     self.__recoAlgs = []
+    # Only create the cells around the seeds (RoI mode) if greater than zero
+    self.__roiDeltaR = float(RoIDeltaR)
     self.__histpath = HistogramPath
     self.__outputLevel = OutputLevel
     self.configure()
@@ -97,6 +99,9 @@ class CaloCellBuilder( Logger ):
       pulse = PulseGenerator( "PulseGenerator", 
                               NSamples    = config['NSamples'], 
                               ShaperFile  = self.__basepath+config['ShaperFile'],
+                              BunchIdStart  = config['BunchIdStart'],
+                              BunchIdEnd    = config['BunchIdEnd'],
+                              BunchDuration = 25.,
                               OutputLevel = self.__outputLevel)
       of = OptimalFilter("OptimalFilter",
                           Weights  = config['OFWeights'],
@@ -111,6 +116,7 @@ class CaloCellBuilder( Logger ):
                           BunchDuration           = 25,
                           NumberOfSamplesPerBunch = 1,
                           HistogramPath           = self.__histpath,
+                          RoIDeltaR               = self.__roiDeltaR,
                           OutputLevel             = self.__outputLevel)
       alg.Tools = [pulse, of]
       self.__recoAlgs.append( alg )
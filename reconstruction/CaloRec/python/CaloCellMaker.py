@@ -18,6 +18,7 @@ class CaloCellMaker( Logger ):
                   "BunchDuration",
                   "NumberOfSamplesPerBunch",
                   "HistogramPath",
+                  "RoIDeltaR",
                   ]
 
   def __init__( self, name, **kw ): 
@@ -8,7 +8,7 @@ from G4Kernel import treatPropertyValue
 
 class PulseGenerator( Logger ):
 
-  __allow_keys = ["OutputLevel", "NSamples", "ShaperFile"]
+  __allow_keys = ["OutputLevel", "NSamples", "ShaperFile", "BunchIdStart", "BunchIdEnd", "BunchDuration"]
 
   def __init__( self, name, **kw ):
 
@@ -29,4 +29,11 @@ from . import RawNtupleMaker
 __all__.extend(RawNtupleMaker.__all__)
 from .RawNtupleMaker import *
 
+from . import PileupLibraryMaker
+__all__.extend(PileupLibraryMaker.__all__)
+from .PileupLibraryMaker import *
+
+from . import PileupOverlay
+__all__.extend(PileupOverlay.__all__)
+from .PileupOverlay import *
 
@@ -1,4 +1,6 @@
 #include <iostream>
+#include <algorithm>
+#include <cstdio>
 #include "CaloCellCollection.h"
 
 using namespace xAOD;
@@ -13,6 +15,7 @@ CaloCellCollection::CaloCellCollection( float etamin, float etamax, float etabin
   float dphi = (phimax-phimin)/phibins;
   for (unsigned eta_idx=0 ; eta_idx<etabins+1; ++eta_idx) m_eta_bins.push_back( etamin + deta * eta_idx );
   for (unsigned phi_idx=0 ; phi_idx<phibins+1; ++phi_idx) m_phi_bins.push_back( phimin + dphi * phi_idx );
+  m_cells.resize( (m_eta_bins.size()-1) * (m_phi_bins.size()-1), nullptr );
 }
 
 
@@ -33,6 +36,15 @@ CaloSample CaloCellCollection::sampling() const
 void CaloCellCollection::push_back( xAOD::RawCell *cell )
 {
   m_collection.insert( std::make_pair( cell->hash(), cell ) );
+  // The hash follows the layer<sampling>_eta<eta_bin>_phi<phi_bin> format
+  unsigned eta_bin, phi_bin;
+  if ( std::sscanf( cell->hash().c_str(), "layer%*d_eta%u_phi%u", &eta_bin, &phi_bin ) == 2 && 
+       eta_bin < m_eta_bins.size()-1 && phi_bin < m_phi_bins.size()-1 )
+  {
+    auto &p = m_cells[ eta_bin*(m_phi_bins.size()-1) + phi_bin ];
+    // keep the same cell stored into the map for duplicated hashes
+    if(!p) p = m_collection.at( cell->hash() );
+  }
 }
 
 
@@ -45,28 +57,34 @@ bool CaloCellCollection::retrieve( TVector3 &pos, xAOD::RawCell *&cell ) const
   float eta = pos.PseudoRapidity();
   float phi = pos.Phi();
   float radius = pos.Perp();
-  std::string hash;
 
   // In plan xy
   if( !(radius >= m_radius_min && radius < m_radius_max) )
     return false;
 
-  // Try to find the correct eta/phi bin for this position
-  for ( unsigned eta_bin = 0 ; eta_bin < m_eta_bins.size()-1; ++eta_bin ){
-    if ( eta > m_eta_bins[eta_bin] && eta <= m_eta_bins[eta_bin+1]){
-      for ( unsigned phi_bin = 0 ; phi_bin < m_phi_bins.size()-1; ++phi_bin ){
-        if ( phi > m_phi_bins[phi_bin] && phi <= m_phi_bins[phi_bin+1]){
-          std::stringstream ss;
-          ss << "layer" << (int)m_sampling << "_eta" << eta_bin << "_phi" << phi_bin;
-          //cell = m_collection[ss.str()].get();
-          cell = m_collection.at(ss.str());
-          return true;
-        }
-      }
-    }
-  }
+  // Find the eta/phi bin (lower edge excluded, upper edge included) for this position.
+  // This is called for each geant step so avoid any allocation here.
+  auto eta_it = std::lower_bound( m_eta_bins.begin(), m_eta_bins.end(), eta );
+  if ( eta_it == m_eta_bins.begin() || eta_it == m_eta_bins.end() )
+    return false;
+  auto phi_it = std::lower_bound( m_phi_bins.begin(), m_phi_bins.end(), phi );
+  if ( phi_it == m_phi_bins.begin() || phi_it == m_phi_bins.end() )
+    return false;
+  
+  unsigned eta_bin = (eta_it - m_eta_bins.begin()) - 1;
+  unsigned phi_bin = (phi_it - m_phi_bins.begin()) - 1;
+  cell = m_cells[ eta_bin*(m_phi_bins.size()-1) + phi_bin ];
 
-  return false;
+  // Null outside of the RoI. All created cells are indexed by push_back
+  return cell != nullptr;
+}
+
+
+xAOD::RawCell* CaloCellCollection::at( unsigned eta_bin, unsigned phi_bin ) const
+{
+  if ( eta_bin >= m_eta_bins.size()-1 || phi_bin >= m_phi_bins.size()-1 )
+    return nullptr;
+  return m_cells[ eta_bin*(m_phi_bins.size()-1) + phi_bin ];
 }
 
 
@@ -82,3 +100,16 @@ const CaloCellCollection::collection_map_t& CaloCellCollection::operator*() cons
 }
 
 
+size_t CaloCellCollection::memory() const
+{
+  size_t bytes = sizeof(*this) + (m_eta_bins.capacity() + m_phi_bins.capacity())*sizeof(float) + 
+                 m_cells.capacity()*sizeof(xAOD::RawCell*);
+  for ( const auto &p : m_collection ){
+    // map node (value plus the rb-tree pointers/color) and the key string
+    bytes += sizeof(collection_map_t::value_type) + 4*sizeof(void*) + p.first.capacity();
+    if(p.second) bytes += p.second->memory();
+  }
+  return bytes;
+}
+
+
@@ -32,15 +32,21 @@ namespace xAOD{
       size_t size() const;
       /*! Retreive the correct cell given the step position */
       bool retrieve( TVector3 &, xAOD::RawCell*& ) const;
+      /*! The cell in this (eta, phi) bin (nullptr if outside or not created) */
+      xAOD::RawCell* at( unsigned eta_bin, unsigned phi_bin ) const;
       /*! Get the cell map */ 
       const collection_map_t& operator*() const;
       /*! Sampling */
       CaloSampling::CaloSample sampling() const;
+      /*! Approximated memory footprint (in bytes) of the collection and its cells */
+      virtual size_t memory() const override;
     
     private:
 
       /*! Cell map into strings to faster access */
       collection_map_t  m_collection;
+      /*! Cells indexed by (eta_bin, phi_bin) used by the step lookup */
+      std::vector<xAOD::RawCell*> m_cells;
       /*! eta bins inside of this collection */
       std::vector<float> m_eta_bins;
       /*! phi bins inside of this collection */
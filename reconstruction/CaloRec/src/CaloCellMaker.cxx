@@ -3,6 +3,8 @@
 #include "CaloCell/RawCell.h"
 #include "EventInfo/EventInfoContainer.h"
 #include "G4Kernel/constants.h"
+#include "G4Kernel/CaloPhiRange.h"
+#include "G4Kernel/TrackInformation.h"
 #include "CaloCellMaker.h"
 #include "TVector3.h"
 #include <cstdlib>
@@ -28,6 +30,7 @@ CaloCellMaker::CaloCellMaker( std::string name ) :
   declareProperty( "BunchIdEnd"       , m_bcid_end=8                          );
   declareProperty( "BunchDuration"    , m_bc_duration=25                      );
   declareProperty( "NumberOfSamplesPerBunch" , m_bc_nsamples=1                );
+  declareProperty( "RoIDeltaR"        , m_roiDeltaR=0                         );
   declareProperty( "OutputLevel"      , m_outputLevel=1                       );
 
 }
@@ -39,6 +42,15 @@ void CaloCellMaker::push_back( CaloTool* tool )
 }
 
 
+size_t CaloCellMaker::memory() const
+{
+  size_t bytes = 0;
+  for ( auto tool : m_toolHandles )
+    bytes += tool->memory();
+  return bytes;
+}
+
+
 StatusCode CaloCellMaker::initialize()
 {
   // Set message level
@@ -118,6 +130,16 @@ StatusCode CaloCellMaker::pre_execute( EventContext &ctx ) const
   collection.record( std::unique_ptr<xAOD::CaloCellCollection>(new xAOD::CaloCellCollection(m_eta_min,m_eta_max,m_eta_bins,m_phi_min,
                                                                                             m_phi_max,m_phi_bins,m_rmin,m_rmax,
                                                                                             (CaloSample)m_sampling)));
+
+  // RoI mode: the steps outside of the created cells are ignored by the collection
+  std::vector<xAOD::seed_t> seeds;
+  if ( m_roiDeltaR > 0 ){
+    SG::ReadHandle<xAOD::EventInfoContainer> event(m_eventKey, ctx);
+    if( !event.isValid() ){
+      MSG_FATAL( "It's not possible to read the xAOD::EventInfoContainer from this Context" );
+    }
+    seeds = (**event.ptr()).front()->allSeeds();
+  }
   // Read the file
   std::ifstream file( m_caloCellFile );
 
@@ -134,6 +156,16 @@ StatusCode CaloCellMaker::pre_execute( EventContext &ctx ) const
       std::string hash;
       file >> sampling >> eta >> phi >> deta >> dphi >> rmin >> rmax >> hash;
 
+      if ( !seeds.empty() ){
+        bool inside = false;
+        for ( const auto &seed : seeds ){
+          float dr_eta = eta - seed.eta;
+          float dr_phi = CaloPhiRange::diff( phi, seed.phi );
+          if ( dr_eta*dr_eta + dr_phi*dr_phi < m_roiDeltaR*m_roiDeltaR ){ inside = true; break; }
+        }
+        if ( !inside ) continue;
+      }
+
       // Create the calorimeter cell
       auto *cell = new xAOD::RawCell( eta, phi, deta, dphi, rmin, rmax, hash, (CaloSample)sampling,
                                       m_bc_duration, m_bc_nsamples, m_bcid_start, m_bcid_end, m_bcid_truth);
@@ -165,8 +197,9 @@ StatusCode CaloCellMaker::execute( EventContext &ctx , const G4Step *step ) cons
   xAOD::RawCell *cell=nullptr;
   collection->retrieve( vpos, cell );
   
+  // The main event tracks (and its secondaries) are tagged by the tracking action
   if(cell)  
-    cell->Fill( step );
+    cell->Fill( step, TrackInformation::fromMainEvent( step->GetTrack() ) );
   
   return StatusCode::SUCCESS;
 }
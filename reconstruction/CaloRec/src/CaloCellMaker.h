@@ -31,6 +31,8 @@ class CaloCellMaker : public Gaugi::Algorithm
     virtual StatusCode finalize() override;
     /*! Add tools to be executed into the post execute step. The order is matter here */
     void push_back( CaloTool *);
+    /*! Approximated memory footprint (in bytes) owned by the algorithm and its tools */
+    virtual size_t memory() const override;
 
   private:
    
@@ -54,6 +56,8 @@ class CaloCellMaker : public Gaugi::Algorithm
     int m_bc_nsamples;
     /*! The time space (in ns) between two bunch crossings */
     float m_bc_duration;
+    /*! Only create the cells inside of this Delta R around the seeds (zero is all cells) */
+    float m_roiDeltaR;
     /*! The tool list that will be executed into the post execute step */
     std::vector< CaloTool* > m_toolHandles;
 
@@ -7,6 +7,8 @@
 #include "src/RawNtupleMaker.h"
 #include "src/PulseGenerator.h"
 #include "src/OptimalFilter.h"
+#include "src/PileupLibraryMaker.h"
+#include "src/PileupOverlay.h"
 
 
 #ifdef __CINT__
@@ -25,6 +27,8 @@
 #pragma link C++ class CaloClusterMaker+;
 #pragma link C++ class PulseGenerator+;
 #pragma link C++ class OptimalFilter+;
+#pragma link C++ class PileupLibraryMaker+;
+#pragma link C++ class PileupOverlay+;
 #pragma link C++ struct raw_cell_t+;
 #pragma link C++ class std::vector< raw_cell_t >+;
 
@@ -30,6 +30,12 @@ StatusCode OptimalFilter::finalize()
 }
 
 
+size_t OptimalFilter::memory() const
+{
+  return m_ofweights.capacity()*sizeof(float);
+}
+
+
 
 StatusCode OptimalFilter::executeTool( const xAOD::EventInfo * /*evt*/, xAOD::RawCell *cell ) const
 {
@@ -18,6 +18,8 @@ class OptimalFilter : public CaloTool
     virtual StatusCode executeTool( const xAOD::EventInfo *, xAOD::CaloCell * ) const override;
     virtual StatusCode executeTool( const xAOD::EventInfo *, xAOD::CaloCluster * ) const override;
     virtual StatusCode executeTool( const xAOD::EventInfo *, xAOD::TruthParticle * ) const override;
+    /*! Approximated memory footprint (in bytes) of the weights */
+    virtual size_t memory() const override;
 
 
   private:
@@ -0,0 +1,171 @@
+
+#include "CaloCellCollection.h"
+#include "EventInfo/EventInfoContainer.h"
+#include "PileupLibraryMaker.h"
+#include "PileupOverlay.h"
+#include "TTree.h"
+#include <cstdio>
+
+using namespace SG;
+using namespace Gaugi;
+
+
+
+PileupLibraryMaker::PileupLibraryMaker( std::string name ) : 
+  IMsgService(name),
+  Algorithm()
+{
+  declareProperty( "CollectionKeys" , m_collectionKeys={}             );
+  declareProperty( "NtupleName"     , m_ntupleName="pileup"           );
+  declareProperty( "EventKey"       , m_eventKey="EventInfo"          );
+  declareProperty( "OutputLevel"    , m_outputLevel=1                 );
+}
+
+
+
+PileupLibraryMaker::~PileupLibraryMaker()
+{;}
+
+
+StatusCode PileupLibraryMaker::initialize()
+{
+  setMsgLevel(m_outputLevel);
+  return StatusCode::SUCCESS;
+}
+
+
+StatusCode PileupLibraryMaker::bookHistograms( StoreGate &store ) const
+{
+  // Create all local variables since this must be a const method
+  int bc_nsamples = 0;
+  int interactions = 0;
+  std::vector<unsigned> cell;
+  std::vector<int> sample;
+  std::vector<float> energy;
+ 
+  store.cd();
+  TTree *tree = new TTree( m_ntupleName.c_str(), "");
+  
+  tree->Branch(  "bc_nsamples"  , &bc_nsamples  );
+  tree->Branch(  "interactions" , &interactions );
+  tree->Branch(  "cell"         , &cell         );
+  tree->Branch(  "sample"       , &sample       );
+  tree->Branch(  "energy"       , &energy       );
+
+  store.add( tree );
+  
+  return StatusCode::SUCCESS;
+}
+
+
+StatusCode PileupLibraryMaker::pre_execute( EventContext &/*ctx*/ ) const
+{
+  return StatusCode::SUCCESS;
+}
+
+
+StatusCode PileupLibraryMaker::execute( EventContext &/*ctx*/, const G4Step * /*step*/ ) const
+{
+  return StatusCode::SUCCESS;
+}
+
+
+StatusCode PileupLibraryMaker::finalize()
+{
+  return StatusCode::SUCCESS;
+}
+
+
+StatusCode PileupLibraryMaker::post_execute( EventContext &/*ctx*/ ) const
+{
+  return StatusCode::SUCCESS;
+}
+
+
+StatusCode PileupLibraryMaker::fillHistograms( EventContext &ctx , StoreGate &store ) const
+{
+  store.cd();
+  TTree *tree = store.tree(m_ntupleName);
+
+  int bc_nsamples = 0;
+  int interactions = 0;
+  std::vector<unsigned> *cell = nullptr;
+  std::vector<int> *sample = nullptr;
+  std::vector<float> *energy = nullptr;
+
+  InitBranch( tree, "bc_nsamples" , &bc_nsamples  );
+  InitBranch( tree, "interactions", &interactions );
+  InitBranch( tree, "cell"        , &cell         );
+  InitBranch( tree, "sample"      , &sample       );
+  InitBranch( tree, "energy"      , &energy       );
+
+  cell->clear(); sample->clear(); energy->clear();
+
+  SG::ReadHandle<xAOD::EventInfoContainer> event(m_eventKey, ctx);
+  if( !event.isValid() ){
+    MSG_FATAL( "It's not possible to read the xAOD::EventInfoContainer from this Context" );
+  }
+  interactions = (**event.ptr()).front()->interactions();
+  if ( interactions != 1 ){
+    MSG_WARNING( "This event has " << interactions << " minimum bias interactions and will not be used by the overlay. "
+                 << "Generate the library input with --dump_only_minbias --pileupAvg 1." );
+  }
+
+  for ( auto key : m_collectionKeys ){
+
+    SG::ReadHandle<xAOD::CaloCellCollection> collection( key, ctx );
+    
+    if( !collection.isValid() ){
+      MSG_WARNING( "It's not possible to read the xAOD::CaloCellCollection from this Context using this key: " << key );
+      continue;
+    }
+
+    int sampling = (int)collection->sampling();
+
+    for ( const auto &pair : **collection.ptr() )
+    {
+      const xAOD::RawCell *raw = pair.second;
+      if ( raw->rawEnergy() == 0 ) continue;
+
+      // The hash follows the layer<sampling>_eta<eta_bin>_phi<phi_bin> format
+      unsigned eta_bin, phi_bin;
+      if ( std::sscanf( raw->hash().c_str(), "layer%*d_eta%u_phi%u", &eta_bin, &phi_bin ) != 2 ){
+        MSG_WARNING( "Unexpected cell hash " << raw->hash() << ". Skipping..." );
+        continue;
+      }
+
+      bc_nsamples = raw->bc_nsamples();
+      // The samples are stored with respect to the first sample of the bunch zero
+      int zero = -raw->bcid_start() * bc_nsamples;
+      const auto &samples = raw->rawEnergySamples();
+      for ( unsigned i = 0; i < samples.size(); ++i ){
+        if ( samples[i] == 0 ) continue;
+        cell->push_back( PileupLib::pack( sampling, eta_bin, phi_bin ) );
+        sample->push_back( (int)i - zero );
+        energy->push_back( samples[i] );
+      }
+    }// Loop over all cells
+  }// Loop over all collections
+
+  tree->Fill();
+
+  return StatusCode::SUCCESS;
+}
+
+
+
+template <class T>
+void PileupLibraryMaker::InitBranch(TTree* fChain, std::string branch_name, T* param) const
+{
+  std::string bname = branch_name;
+  if (fChain->GetAlias(bname.c_str()))
+     bname = std::string(fChain->GetAlias(bname.c_str()));
+
+  if (!fChain->FindBranch(bname.c_str()) ) {
+    MSG_WARNING( "unknown branch " << bname );
+    return;
+  }
+  fChain->SetBranchStatus(bname.c_str(), 1.);
+  fChain->SetBranchAddress(bname.c_str(), param);
+}
+
@@ -0,0 +1,52 @@
+#ifndef PileupLibraryMaker_h
+#define PileupLibraryMaker_h
+
+#include "GaugiKernel/StatusCode.h"
+#include "GaugiKernel/DataHandle.h"
+#include "GaugiKernel/Algorithm.h"
+#include "TTree.h"
+
+
+/*
+ * Dump the raw samples of the minimum bias events (simulated alone) into a library of
+ * per cell deposits used by the PileupOverlay. One entry per event with the packed cell
+ * key (sampling, eta bin, phi bin), the sample offset with respect to the bunch zero and
+ * the energy of each non empty sample. The number of interactions of the event is stored
+ * too, since the overlay only uses the entries with exactly one interaction.
+ */
+class PileupLibraryMaker : public Gaugi::Algorithm
+{
+
+  public:
+    /** Constructor **/
+    PileupLibraryMaker( std::string );
+    
+    virtual ~PileupLibraryMaker();
+    
+    virtual StatusCode initialize() override;
+
+    virtual StatusCode bookHistograms( SG::StoreGate &store ) const override;
+    
+    virtual StatusCode pre_execute( SG::EventContext &ctx ) const override;
+    
+    virtual StatusCode execute( SG::EventContext &ctx , const G4Step *step) const override;
+    
+    virtual StatusCode post_execute( SG::EventContext &ctx ) const override;
+    
+    virtual StatusCode fillHistograms( SG::EventContext &ctx, SG::StoreGate &store ) const override;
+    
+    virtual StatusCode finalize() override;
+
+
+  private:
+ 
+    template <class T> void InitBranch(TTree* fChain, std::string branch_name, T* param) const;
+   
+    std::vector<std::string> m_collectionKeys;
+    std::string m_ntupleName;
+    std::string m_eventKey;
+    int m_outputLevel;
+};
+
+#endif
+
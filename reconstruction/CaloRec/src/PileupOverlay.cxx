@@ -0,0 +1,205 @@
+
+#include "CaloCellCollection.h"
+#include "EventInfo/EventInfoContainer.h"
+#include "PileupOverlay.h"
+#include "Randomize.hh"
+#include "TFile.h"
+#include "TTree.h"
+#include <algorithm>
+
+using namespace SG;
+using namespace Gaugi;
+
+
+
+PileupOverlay::PileupOverlay( std::string name ) : 
+  IMsgService(name),
+  Algorithm(),
+  m_bc_nsamples(0)
+{
+  declareProperty( "CollectionKeys" , m_collectionKeys={}             );
+  declareProperty( "InputFiles"     , m_inputFiles={}                 );
+  declareProperty( "NtupleName"     , m_ntupleName="pileup"           );
+  declareProperty( "EventKey"       , m_eventKey="EventInfo"          );
+  declareProperty( "PileupAvg"      , m_pileupAvg=0                   );
+  declareProperty( "BunchIdStart"   , m_bcid_start=-24                );
+  declareProperty( "BunchIdEnd"     , m_bcid_end=7                    );
+  declareProperty( "OutputLevel"    , m_outputLevel=1                 );
+}
+
+
+
+PileupOverlay::~PileupOverlay()
+{;}
+
+
+StatusCode PileupOverlay::initialize()
+{
+  setMsgLevel(m_outputLevel);
+  
+  m_events.push_back(0);
+  for ( const auto &path : m_inputFiles )
+    read( path );
+
+  if ( m_pileupAvg > 0 && m_events.size() < 2 ){
+    MSG_FATAL( "There is no minimum bias event in the pileup library." );
+  }
+  MSG_INFO( "Pileup library with " << m_events.size()-1 << " events and " << m_keys.size() << " deposits." );
+  return StatusCode::SUCCESS;
+}
+
+
+bool PileupOverlay::read( const std::string &path )
+{
+  TFile *file = TFile::Open( path.c_str(), "READ" );
+  if ( !file || file->IsZombie() ){
+    MSG_ERROR( "It's not possible to open the pileup library " << path << ". Skipping..." );
+    delete file;
+    return false;
+  }
+  
+  TTree *tree = (TTree*)file->Get( m_ntupleName.c_str() );
+  if ( !tree ){
+    MSG_ERROR( "There is no " << m_ntupleName << " tree in " << path << ". Skipping..." );
+    delete file;
+    return false;
+  }
+
+  // Libraries without the number of interactions can not be checked
+  if ( !tree->GetBranch( "interactions" ) ){
+    MSG_ERROR( "There is no interactions branch in " << path << ". Rebuild the library. Skipping..." );
+    delete file;
+    return false;
+  }
+
+  int bc_nsamples = 0;
+  int interactions = 0;
+  std::vector<unsigned> *cell = nullptr;
+  std::vector<int> *sample = nullptr;
+  std::vector<float> *energy = nullptr;
+  tree->SetBranchAddress( "bc_nsamples" , &bc_nsamples  );
+  tree->SetBranchAddress( "interactions", &interactions );
+  tree->SetBranchAddress( "cell"        , &cell         );
+  tree->SetBranchAddress( "sample"      , &sample       );
+  tree->SetBranchAddress( "energy"      , &energy       );
+
+  Long64_t skipped = 0;
+  for ( Long64_t entry = 0; entry < tree->GetEntries(); ++entry ){
+    tree->GetEntry( entry );
+    // One library event is one interaction drawn by the overlay
+    if ( interactions != 1 ){
+      ++skipped;
+      continue;
+    }
+    // Empty events have no sample information
+    if ( !cell->empty() ){
+      if ( m_bc_nsamples && bc_nsamples != m_bc_nsamples ){
+        MSG_ERROR( "The number of samples per bunch of " << path << " do not match with the other files. Skipping..." );
+        break;
+      }
+      m_bc_nsamples = bc_nsamples;
+    }
+    m_keys.insert( m_keys.end(), cell->begin(), cell->end() );
+    m_offsets.insert( m_offsets.end(), sample->begin(), sample->end() );
+    m_energies.insert( m_energies.end(), energy->begin(), energy->end() );
+    m_events.push_back( m_keys.size() );
+  }
+
+  if ( skipped ){
+    MSG_WARNING( skipped << " events of " << path << " do not have exactly one interaction (built with --pileupAvg "
+                 << "different than one?). Skipping them..." );
+  }
+  MSG_INFO( "Read " << tree->GetEntries()-skipped << " minimum bias events from " << path );
+  file->Close();
+  delete file;
+  return true;
+}
+
+
+StatusCode PileupOverlay::bookHistograms( StoreGate &/*store*/ ) const
+{
+  return StatusCode::SUCCESS;
+}
+
+
+StatusCode PileupOverlay::pre_execute( EventContext &/*ctx*/ ) const
+{
+  return StatusCode::SUCCESS;
+}
+
+
+StatusCode PileupOverlay::execute( EventContext &/*ctx*/, const G4Step * /*step*/ ) const
+{
+  return StatusCode::SUCCESS;
+}
+
+
+StatusCode PileupOverlay::finalize()
+{
+  return StatusCode::SUCCESS;
+}
+
+
+StatusCode PileupOverlay::post_execute( EventContext &ctx ) const
+{
+  if ( m_pileupAvg <= 0 ) return StatusCode::SUCCESS;
+
+  // Collections by sampling
+  std::vector<const xAOD::CaloCellCollection*> collections;
+  for ( auto key : m_collectionKeys ){
+    SG::ReadHandle<xAOD::CaloCellCollection> collection( key, ctx );
+    if( !collection.isValid() ){
+      MSG_WARNING( "It's not possible to read the xAOD::CaloCellCollection from this Context using this key: " << key );
+      continue;
+    }
+    unsigned sampling = (unsigned)collection->sampling();
+    if ( sampling >= collections.size() ) collections.resize( sampling+1, nullptr );
+    collections[sampling] = collection.ptr();
+  }
+
+  const size_t nevents = m_events.size()-1;
+  double nPileupMean = 0;
+
+  for ( int bc_id = m_bcid_start; bc_id <= m_bcid_end; ++bc_id ){
+    
+    // Select the number of pileup events in this bunch crossing
+    long nPileup = G4Poisson( m_pileupAvg );
+    nPileupMean += nPileup;
+    
+    for ( long iPileup = 0; iPileup < nPileup; ++iPileup ){
+      
+      size_t evt = std::min( nevents-1, (size_t)( G4UniformRand()*nevents ) );
+      
+      for ( size_t i = m_events[evt]; i < m_events[evt+1]; ++i ){
+        unsigned key = m_keys[i];
+        unsigned sampling = PileupLib::sampling( key );
+        if ( sampling >= collections.size() || !collections[sampling] ) continue;
+        // Null for cells outside of the RoIs
+        auto *cell = collections[sampling]->at( PileupLib::eta_bin(key), PileupLib::phi_bin(key) );
+        if ( !cell ) continue;
+        // Shift the library sample (bunch zero) to this bunch crossing
+        cell->addEnergy( m_offsets[i] + ( bc_id - cell->bcid_start() ) * cell->bc_nsamples(), m_energies[i] );
+      }
+    }
+  }
+
+  // Event info
+  SG::ReadHandle<xAOD::EventInfoContainer> event(m_eventKey, ctx);
+  
+  if( !event.isValid() ){
+    MSG_FATAL( "It's not possible to read the xAOD::EventInfoContainer from this Context" );
+  }
+
+  // The pileup was not generated with the main event, so the event average comes from here
+  auto evt = const_cast<xAOD::EventInfo*>( (**event.ptr()).front() );
+  evt->setAvgmu( nPileupMean / ( m_bcid_end - m_bcid_start + 1 ) );
+
+  return StatusCode::SUCCESS;
+}
+
+
+StatusCode PileupOverlay::fillHistograms( EventContext &/*ctx*/ , StoreGate &/*store*/ ) const
+{
+  return StatusCode::SUCCESS;
+}
+
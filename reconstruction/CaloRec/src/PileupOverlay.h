@@ -0,0 +1,78 @@
+#ifndef PileupOverlay_h
+#define PileupOverlay_h
+
+#include "GaugiKernel/StatusCode.h"
+#include "GaugiKernel/DataHandle.h"
+#include "GaugiKernel/Algorithm.h"
+
+
+namespace PileupLib{
+
+  /*! Packed cell key used by the pileup library */
+  inline unsigned pack( int sampling, unsigned eta_bin, unsigned phi_bin )
+  {
+    return ( (unsigned)sampling << 24 ) | ( (eta_bin & 0xfff) << 12 ) | ( phi_bin & 0xfff );
+  };
+
+  inline int      sampling( unsigned key ) { return key >> 24;         };
+  inline unsigned eta_bin ( unsigned key ) { return (key >> 12) & 0xfff; };
+  inline unsigned phi_bin ( unsigned key ) { return key & 0xfff;       };
+}
+
+
+/*
+ * Minimum bias overlay. For each bunch crossing between BunchIdStart and BunchIdEnd a Poisson
+ * number of library events (see PileupLibraryMaker) is drawn and its deposits are added into the
+ * raw samples of the cells before the pulse generation. Each library event must hold exactly one
+ * interaction in the bunch zero, the other entries are not used. This must run before the CaloCellMakers
+ * in the sequence, so only the main event needs to be simulated by geant.
+ */
+class PileupOverlay : public Gaugi::Algorithm
+{
+
+  public:
+    /** Constructor **/
+    PileupOverlay( std::string );
+    
+    virtual ~PileupOverlay();
+    
+    virtual StatusCode initialize() override;
+
+    virtual StatusCode bookHistograms( SG::StoreGate &store ) const override;
+    
+    virtual StatusCode pre_execute( SG::EventContext &ctx ) const override;
+    
+    virtual StatusCode execute( SG::EventContext &ctx , const G4Step *step) const override;
+    
+    virtual StatusCode post_execute( SG::EventContext &ctx ) const override;
+    
+    virtual StatusCode fillHistograms( SG::EventContext &ctx, SG::StoreGate &store ) const override;
+    
+    virtual StatusCode finalize() override;
+
+
+  private:
+
+    /*! Read all library events from this file */
+    bool read( const std::string &path );
+
+    std::vector<std::string> m_collectionKeys;
+    std::vector<std::string> m_inputFiles;
+    std::string m_ntupleName;
+    std::string m_eventKey;
+    float m_pileupAvg;
+    int m_bcid_start;
+    int m_bcid_end;
+    int m_outputLevel;
+
+    // All library deposits (read only after the initialize, shared by all threads)
+    std::vector<unsigned> m_keys;
+    std::vector<int> m_offsets;
+    std::vector<float> m_energies;
+    // First deposit of each library event (plus the end)
+    std::vector<size_t> m_events;
+    int m_bc_nsamples;
+};
+
+#endif
+
@@ -11,6 +11,9 @@ PulseGenerator::PulseGenerator( std::string name ) :
   declareProperty( "NSamples"     , m_nsamples=7            );
   declareProperty( "ShaperFile"   , m_shaperFile            );
   declareProperty( "OutputLevel"  , m_outputLevel=1         );
+  declareProperty( "BunchIdStart" , m_bcid_start=-7         );
+  declareProperty( "BunchIdEnd"   , m_bcid_end=8            );
+  declareProperty( "BunchDuration", m_bc_duration=25        );
 }
 
 
@@ -26,6 +29,20 @@ StatusCode PulseGenerator::initialize()
   setMsgLevel( (MSG::Level)m_outputLevel );
   MSG_DEBUG( "Reading shaper values from: " << m_shaperFile );
   m_pulseGenerator = new CPK::TPulseGenerator( m_nsamples, m_shaperFile.c_str());
+
+  // The deterministic pulse (without pedestal) is linear with the amplitude, so the pulses of
+  // each bunch crossing are generated once and scaled by the cell energies
+  auto pulse_size = m_pulseGenerator->GetPulseSize();
+  m_unitPulses.clear();
+  for ( int bc = m_bcid_start;  bc <= m_bcid_end; ++bc )
+  {
+    auto pulse = m_pulseGenerator->GenerateDeterministicPulse( 1, 0, bc*m_bc_duration );
+    std::vector<double> unit(pulse_size);
+    for ( int j=0; j < pulse_size; ++j )
+      unit[j] = pulse->operator[](j);
+    delete pulse; // This must be deleted to avoid memory leak since spk uses "new" internally
+    m_unitPulses.push_back( unit );
+  }
   return StatusCode::SUCCESS;
 }
 
@@ -38,29 +55,34 @@ StatusCode PulseGenerator::finalize()
 
 StatusCode PulseGenerator::executeTool( const xAOD::EventInfo * /*evt*/, xAOD::RawCell *cell ) const
 {
+  if ( cell->bcid_start() != m_bcid_start || cell->bcid_end() != m_bcid_end || cell->bc_duration() != m_bc_duration ){
+    MSG_ERROR( "The cell bunch crossings (" << cell->bcid_start() << ", " << cell->bcid_end() << ", " << cell->bc_duration()
+               << " ns) are not the ones of the pulse generator (" << m_bcid_start << ", " << m_bcid_end << ", "
+               << m_bc_duration << " ns)." );
+    return StatusCode::FAILURE;
+  }
+
   auto pulse_size = m_pulseGenerator->GetPulseSize();
   
-  // Get all energies for each bunch crossing 
-  auto rawEnergySamples = cell->rawEnergySamples();
+  // Get all energies for each bunch crossing (no copy)
+  const auto &rawEnergySamples = cell->rawEnergySamplesRef();
 
-  // Create an pulse with zeros with n samples
-  std::vector<float> pulse_sum(pulse_size, 0.0);
+  // The pulse is accumulated in place. The cell keeps its capacity between events
+  auto &pulse_sum = cell->pulseRef();
+  pulse_sum.assign( pulse_size, 0.0 );
   // Loop over each bunch crossing
-  for ( int bc = cell->bcid_start(), i=0;  bc <= cell->bcid_end(); ++bc, ++i )
+  for ( unsigned i=0; i < m_unitPulses.size() && i < rawEnergySamples.size(); ++i )
   {
-    // Generate the pulse
-    auto pulse = m_pulseGenerator->GenerateDeterministicPulse( rawEnergySamples[i], 0, bc*cell->bc_duration() );
+    // Nothing to accumulate for empty bunches
+    if ( rawEnergySamples[i] == 0 ) continue;
     // Add gaussian noise
     // m_pulseGenerator[cell->layer()]->AddGaussianNoise(pulse);
     // Accumulate into pulse sum (Sum all pulses)
+    const auto &pulse = m_unitPulses[i];
     for ( int j=0; j < pulse_size; ++j )
-      pulse_sum[j] += (float)pulse->operator[](j);
-    delete pulse; // This must be deleted to avoid memory leak since spk uses "new" internally
+      pulse_sum[j] += (float)( rawEnergySamples[i] * pulse[j] );
   }
 
-
-  // Add the pulse centered in the bunch crossing zero
-  cell->setPulse( pulse_sum );
   return StatusCode::SUCCESS;
 }
 
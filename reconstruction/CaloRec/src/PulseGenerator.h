@@ -4,6 +4,7 @@
 #include "GaugiKernel/StatusCode.h"
 #include "CaloTool.h"
 #include "TPulseGenerator.h"
+#include <vector>
 
 
 
@@ -26,7 +27,7 @@ class PulseGenerator : public CaloTool
 
 
   private:
- 
+
     /*! Number of samples to be generated */
     int m_nsamples;
     /*! The shaper configuration path */
@@ -35,6 +36,12 @@ class PulseGenerator : public CaloTool
     CPK::TPulseGenerator  *m_pulseGenerator;
     /*! Output level message */
     int m_outputLevel;
+    /*! Bunch crossings of the cells (same of the CaloCellMaker) */
+    int m_bcid_start;
+    int m_bcid_end;
+    float m_bc_duration;
+    /*! Unit amplitude pulses for each bunch crossing. Built at the initialize and only read by the threads */
+    std::vector< std::vector<double> > m_unitPulses; //!
 };
 
 #endif
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+from Gaugi.messenger    import LoggingLevel, Logger
+import argparse
+import subprocess
+import time
+import sys,os
+
+
+mainLogger = Logger.getModuleLogger("fastsim_validation")
+parser = argparse.ArgumentParser(description = '', add_help = False)
+parser = argparse.ArgumentParser()
+
+
+parser.add_argument('-i','--inputFile', action='store', dest='inputFile', required = True,
+                    help = "The event input file generated by the Pythia event generator (same for both samples).")
+
+parser.add_argument('-o','--outputFile', action='store', dest='outputFile', required = False, default="fastsim_validation.root",
+                    help = "The root file with the full and fast simulation distributions.")
+
+parser.add_argument('--evt','--numberOfEvents', action='store', dest='numberOfEvents', required = False, type=int, default=None,
+                    help = "The number of events to be reconstructed.")
+
+parser.add_argument('-nt','--numberOfThreads', action='store', dest='numberOfThreads', required = False, type=int, default=1,
+                    help = "The number of threads used by the reconstruction.")
+
+parser.add_argument('--cal','--calorimeter', action='store', dest='Calorimeter', required = False, default="ATLAS",
+                    help = "Choose the calorimeter (ATLAS or Generic)")
+
+parser.add_argument('-s','--seed', action='store', dest='seed', required = False, type=int, default=512,
+                    help = "The geant seed.")
+
+parser.add_argument('--pvalue', action='store', dest='pvalue', required = False, type=float, default=0.01,
+                    help = "The minimum Kolmogorov-Smirnov probability to accept the fast simulation.")
+
+parser.add_argument('--full', action='store', dest='full', required = False, default=None,
+                    help = "Use this full simulation file instead of running the reconstruction.")
+
+parser.add_argument('--fast', action='store', dest='fast', required = False, default=None,
+                    help = "Use this fast simulation file instead of running the reconstruction.")
+
+
+if len(sys.argv)==1:
+  parser.print_help()
+  sys.exit(1)
+
+args = parser.parse_args()
+
+
+# ( branch, bins, xmin, xmax )
+variables = [ ('cl_et'     , 100, 0   , 100e3 ),
+              ('cl_e1'     , 100, 0   , 50e3  ),
+              ('cl_e2'     , 100, 0   , 100e3 ),
+              ('cl_e3'     , 100, 0   , 10e3  ),
+              ('cl_reta'   , 100, 0.8 , 1.05  ),
+              ('cl_rphi'   , 100, 0.8 , 1.05  ),
+              ('cl_rhad'   , 100, -0.05, 0.1  ),
+              ('cl_eratio' , 100, 0   , 1.    ),
+              ('cl_weta2'  , 100, 0.005, 0.02 ),
+              ('cl_f1'     , 100, -0.1, 0.6   ),
+              ('cl_f3'     , 100, -0.05, 0.1  ),
+              ('cl_e233'   , 100, 0   , 100e3 ),
+              ('cl_e237'   , 100, 0   , 100e3 ),
+              ('cl_e277'   , 100, 0   , 100e3 ),
+             ]
+
+
+
+def reconstruct( output, fast ):
+  """
+    Run the reconstruction and return the wall time (in seconds).
+  """
+  command = [ sys.executable, os.path.dirname(os.path.realpath(__file__))+'/reco_trf.py',
+              '-i', args.inputFile, '-o', output,
+              '-nt', str(args.numberOfThreads),
+              '--cal', args.Calorimeter,
+              '--seed', str(args.seed),
+              '--outputLevel', '6' ]
+  if args.numberOfEvents:
+    command += ['--evt', str(args.numberOfEvents)]
+  if fast:
+    command += ['--fastSimulation']
+  mainLogger.info( ' '.join(command) )
+  start = time.time()
+  if subprocess.call( command ) != 0:
+    mainLogger.fatal( "The reconstruction failed: %s"%' '.join(command) )
+    sys.exit(1)
+  return time.time() - start
+
+
+
+times = {}
+full = args.full
+if not full:
+  full = 'fastsim_validation.full.root'
+  times['full'] = reconstruct( full, False )
+fast = args.fast
+if not fast:
+  fast = 'fastsim_validation.fast.root'
+  times['fast'] = reconstruct( fast, True )
+
+
+import ROOT
+ROOT.gROOT.SetBatch(True)
+ROOT.TH1.AddDirectory(False)
+
+
+def fill( path, tag ):
+  f = ROOT.TFile.Open( path )
+  tree = f.Get("events")
+  if not tree:
+    mainLogger.fatal( "There is no events tree in %s"%path )
+    sys.exit(1)
+  hists = {}
+  for name, bins, xmin, xmax in variables:
+    h = ROOT.TH1F( name+'_'+tag, name+';'+name+';Count', bins, xmin, xmax )
+    # Only the clusters matched with a seed
+    tree.Project( h.GetName(), name, "cl_match" )
+    hists[name] = h
+  nevents = tree.GetEntries()
+  f.Close()
+  return hists, nevents
+
+
+hfull, nfull = fill( full, 'full' )
+hfast, nfast = fill( fast, 'fast' )
+
+
+output = ROOT.TFile( args.outputFile, 'RECREATE' )
+failed = False
+mainLogger.info( "%12s %12s %12s %12s %12s %10s"%("variable", "mean full", "mean fast", "rms full", "rms fast", "KS prob") )
+for name, _, _, _ in variables:
+  a = hfull[name]; b = hfast[name]
+  prob = a.KolmogorovTest( b ) if a.GetEntries() > 0 and b.GetEntries() > 0 else 0
+  message = "%12s %12.5g %12.5g %12.5g %12.5g %10.4f"%(name, a.GetMean(), b.GetMean(), a.GetRMS(), b.GetRMS(), prob)
+  if prob < args.pvalue:
+    mainLogger.warning( message + " <- incompatible" )
+    failed = True
+  else:
+    mainLogger.info( message )
+
+  canvas = ROOT.TCanvas( name, name, 600, 500 )
+  a.SetLineColor( ROOT.kBlack ); b.SetLineColor( ROOT.kRed )
+  if a.Integral() > 0: a.Scale( 1./a.Integral() )
+  if b.Integral() > 0: b.Scale( 1./b.Integral() )
+  a.Draw('hist'); b.Draw('hist same')
+  legend = ROOT.TLegend( 0.6, 0.75, 0.88, 0.88 )
+  legend.AddEntry( a, 'Full simulation', 'l' )
+  legend.AddEntry( b, 'Fast simulation (KS = %.3f)'%prob, 'l' )
+  legend.Draw()
+  output.cd()
+  a.Write(); b.Write(); canvas.Write()
+output.Close()
+
+mainLogger.info( "Clusters: %d (full) and %d (fast)"%(nfull, nfast) )
+if 'full' in times and 'fast' in times:
+  mainLogger.info( "Reconstruction time: %.1f s (full) and %.1f s (fast), speedup %.2f"%(times['full'], times['fast'],
+                   times['full']/times['fast'] if times['fast'] > 0 else 0) )
+mainLogger.info( "Distributions written into %s"%args.outputFile )
+
+sys.exit( 1 if failed else 0 )
@@ -41,6 +41,15 @@ parser.add_argument('--bc_id_end', action='store', dest='bc_id_end', required =
 parser.add_argument('--bc_duration', action='store', dest='bc_duration', required = False, type=int, default=25,
                     help = "The bunch crossing duration (in nanoseconds).")
 
+parser.add_argument('--poolSize', action='store', dest='poolSize', required = False, type=int, default=0,
+                    help = "Recycle the minbias events from a pool with this size (default is zero, no recycling).")
+
+parser.add_argument('--poolMaxReuse', action='store', dest='poolMaxReuse', required = False, type=int, default=0,
+                    help = "Regenerate a pool event after this number of uses (default is zero, no limit). Single thread and no checkpoint only.")
+
+parser.add_argument('--poolFile', action='store', dest='poolFile', required = False, default="",
+                    help = "Read the minbias pool from this file (written there if it does not exist).")
+
 
 #
 # Extra parameters
@@ -52,6 +61,33 @@ parser.add_argument('--outputLevel', action='store', dest='outputLevel', require
 parser.add_argument('-s','--seed', action='store', dest='seed', required = False, type=int, default=0,
                     help = "The pythia seed (zero is the clock system)")
 
+parser.add_argument('-nt','--numberOfThreads', action='store', dest='numberOfThreads', required = False, type=int, default=1,
+                    help = "The number of generator threads (the events do not depend on it).")
+
+parser.add_argument('--disableVeto', action='store_true', dest='disableVeto', required = False,
+                    help = "Do not veto the main events before the hadronization (Zee and JF17).")
+
+parser.add_argument('--initCache', action='store', dest='initCache', required = False, default="",
+                    help = "Reuse the pythia initialization tables from this directory (shared by all jobs).")
+
+parser.add_argument('--checkpoint', action='store', dest='checkpoint', required = False, type=int, default=0,
+                    help = "Flush the output and record a checkpoint each N events (zero is disabled).")
+
+parser.add_argument('--resume', action='store_true', dest='resume', required = False,
+                    help = "Resume from the checkpoint of the output file (same seed, remaining events).")
+
+parser.add_argument('--metricsFile', action='store', dest='metricsFile', required = False, default="",
+                    help = "Write periodic progress/throughput snapshots into this file.")
+
+parser.add_argument('--metricsFormat', action='store', dest='metricsFormat', required = False, default="json",
+                    help = "The metrics file format (json or prometheus).")
+
+#
+# Used by energy estimation group
+#
+
+parser.add_argument('--dump_only_minbias', action='store_true', dest='dump_only_minbias', required = False,
+                    help = "Dump only minimum bias (exactly pileupAvg events per bunch without window). The pileup library needs --pileupAvg 1.")
 
 
 
@@ -76,18 +112,36 @@ generator = EventGenerator( "EventGenerator",
                             BunchIdEnd     = args.bc_id_end,
                             OutputLevel    = args.outputLevel,
                             Seed           = args.seed,
+                            MetricsFile    = args.metricsFile,
+                            MetricsFormat  = args.metricsFormat,
+                            NumberOfThreads= args.numberOfThreads,
+                            InitCacheDir   = args.initCache,
+                            PoolSize       = args.poolSize,
+                            PoolMaxReuse   = args.poolMaxReuse,
+                            PoolFile       = args.poolFile,
+                            CheckpointInterval = args.checkpoint,
+                            Resume         = args.resume,
                             )
 
+if args.dump_only_minbias:
+  generator.setProperty( "UseWindow"   , False )
+  generator.setProperty( "FixedPileup" , True  )
+
+
 
+if args.dump_only_minbias:
+  mainLogger.info("Dumping only minimum bias. The event filter will be ignored.")
 
-if args.filter == "Zee":
+elif args.filter == "Zee":
   from PythiaGenerator import Zee
   tool = Zee( "Zee",
               MainFile       = args.mainFile,
               EtaMax         = 1.4,
               MinPt          = 15*GeV,
               OutputLevel    = args.outputLevel,
-              Seed           = args.seed)
+              Seed           = args.seed,
+              UseVeto        = not args.disableVeto,
+              InitCacheDir   = args.initCache)
 
   generator.push_back( tool )
 
@@ -100,7 +154,9 @@ elif args.filter == "JF17":
                MinPt          = 17*GeV,
                Select         = 2,
                OutputLevel    = args.outputLevel,
-               Seed           = args.seed)
+               Seed           = args.seed,
+               UseVeto        = not args.disableVeto,
+               InitCacheDir   = args.initCache)
 
   generator.push_back( tool )
 
@@ -0,0 +1,44 @@
+#!/usr/bin/env python3
+
+from Gaugi.messenger import LoggingLevel, Logger
+from Gaugi.messenger.macros import *
+from G4Kernel.OutputMerger import merge_outputs
+import argparse
+
+
+mainLogger = Logger.getModuleLogger("merge")
+parser = argparse.ArgumentParser(description = '', add_help = False)
+parser = argparse.ArgumentParser()
+
+parser.add_argument('-o','--outputFile', action='store',
+    dest='outputFile', required = True,
+    help = "The merged output file.")
+
+parser.add_argument('-i','--inputFiles', action='store',
+    dest='inputFiles', required = True, nargs='+',
+    help = "The files to be merged.")
+
+parser.add_argument('-j','--mergeWorkers', action='store',
+    dest='mergeWorkers', required = False, default = 2, type=int,
+    help = "The maximum number of batches merged at the same time")
+
+parser.add_argument('--mergeBatch', action='store',
+    dest='mergeBatch', required = False, default = 10, type=int,
+    help = "The number of files merged into each partial file")
+
+parser.add_argument('--keep', action='store_true',
+    dest='keep', required = False,
+    help = "Keep the input files (they are removed only if the output has all their entries)")
+
+
+import sys,os
+if len(sys.argv)==1:
+  parser.print_help()
+  sys.exit(1)
+args = parser.parse_args()
+
+ok = merge_outputs( args.outputFile, args.inputFiles,
+                    maxWorkers = args.mergeWorkers,
+                    batchSize  = args.mergeBatch,
+                    remove     = not args.keep )
+sys.exit( 0 if ok else 1 )
@@ -3,82 +3,252 @@
 
 from Gaugi.messenger import LoggingLevel, Logger
 from Gaugi.messenger.macros import *
+from G4Kernel.OutputMerger import OutputMerger
 import argparse
 
 
 class Parallel( Logger ):
 
-  def __init__(self, command, njobs, maxJobs, output ):
+  #
+  # The requested events are split in small ranges with a deterministic seed per range. Each
+  # worker pulls the next range when it is idle, so the fast workers take more ranges and a
+  # failure only loses (and retries) one range. The range outputs are merged in batches, by
+  # up to mergeWorkers parallel merges, while the other ranges are still running.
+  #
+  # The command can use the {FIRST}, {NEVENTS} and {SEED} placeholders. Otherwise the number of
+  # events and the seed are appended as --evt and --seed, so a command without {FIRST} must
+  # generate its events (each range would read the same input events). Without the number of
+  # events, each job runs the command as is (njobs ranges).
+  #
+  # The finished ranges and partial files are recorded into the journal (output + .journal). A
+  # resumed run takes the seeds of the journal and only runs the missing ranges, so the final
+  # output is the same of an uninterrupted run.
+  #
+  def __init__(self, command, njobs, maxJobs, output, nevents=None, rangeSize=100, seed=0,
+               retries=2, mergeBatch=10, mergeWorkers=2, resume=False ):
     Logger.__init__(self)
-    self.process_pipe = []
-    self.output_to_merge = []
     import random
+    import threading
     import time
     random.seed(time.time())
     self._base_id = random.randrange(100000)
-    self._jobList = list(range(njobs))
+    # The base seed is taken from the clock if zero (reported to repeat the run)
+    self._seed    = seed if seed else random.randrange(1, 900000000)
     self._maxJobs = maxJobs
     self._command = command
     self._output  = output
+    self._retries = retries
+    self._mergeBatch = max(mergeBatch, 2)
+    self._mergeWorkers = mergeWorkers
+    self._journal = output + '.journal'
+    self._journalLock = threading.Lock()
+    self._resume  = resume
+
+    # ranges: (range id, first event, number of events)
+    if nevents is None:
+      self._ranges = [ (job_id, None, None) for job_id in range(njobs) ]
+    else:
+      self._ranges = [ (job_id, first, min(rangeSize, nevents-first)) for job_id, first in
+                        enumerate(range(0, nevents, rangeSize)) ]
+
+
+  def seed( self, job_id ):
+    # Same seed for the same base seed and range, whatever the worker
+    import random
+    return random.Random( '%d:%d' % (self._seed, job_id) ).randrange(1, 900000000)
+
+
+  def job_command( self, job_id, first, nevents, output ):
+    command = self._command
+    if nevents is not None:
+      if not '{NEVENTS}' in command:
+        command += ' --evt {NEVENTS}'
+      if not '{SEED}' in command:
+        command += ' --seed {SEED}'
+      command = command.replace('{FIRST}', str(first)).replace('{NEVENTS}', str(nevents)).replace('{SEED}', str(self.seed(job_id)))
+    return command + (' -o %s') % output
+
+
+  def record( self, line ):
+    # One line per finished step, on disk before the next one (also called by the merge workers)
+    import os
+    with self._journalLock, open( self._journal, 'a' ) as f:
+      f.write( line + '\n' )
+      f.flush()
+      os.fsync( f.fileno() )
+
+
+  def restore( self ):
+    # Returns the partial files and the finished ranges (range id, file) of the journal
+    import os
+    parts = []; done = []
+    if not self._resume or not os.path.exists( self._journal ):
+      if os.path.exists( self._journal ):
+        os.remove( self._journal )
+      self.record( 'base_id %d' % self._base_id )
+      self.record( 'seed %d' % self._seed )
+      return parts, done
+    for line in open( self._journal ):
+      words = line.split()
+      if not words:
+        continue
+      if words[0] == 'base_id':
+        self._base_id = int(words[1])
+      elif words[0] == 'seed':
+        self._seed = int(words[1])
+      elif words[0] == 'done' and os.path.exists( words[2] ):
+        done.append( (int(words[1]), words[2]) )
+      elif words[0] == 'part' and os.path.exists( words[1] ):
+        parts.append( (words[1], [int(w) for w in words[2].split(',')]) )
+    # The ranges of a partial file are already merged. Their files are still on disk if the
+    # job was killed after the part was recorded and before they were removed
+    merged = set( job_id for _, ids in parts for job_id in ids )
+    for job_id, fname in done:
+      if job_id in merged:
+        os.remove( fname )
+    done = [ (job_id, fname) for job_id, fname in done if job_id not in merged ]
+    MSG_INFO( self, 'Resuming with %d partial files and %d finished ranges (base seed %d)', len(parts), len(done), self._seed )
+    return parts, done
+
 
   def run( self ):
-    import os, time
+    import os, queue, threading
     import subprocess
-    from pprint import pprint
-    while len(self._jobList) > 0:
-      if len(self.process_pipe) < int(self._maxJobs):
-        time.sleep(2)
-        job_id = len(self._jobList)
-        self._jobList.pop()
-        oname = ('output_%d_%d.root') % (self._base_id, job_id) 
-        self.output_to_merge.append( ('output_%d_%d.root') % (self._base_id, job_id) )
-        command = self._command + (' -o %s') % (self.output_to_merge[-1])
-        MSG_INFO( self,  ('adding process into the stack with id %d')%(job_id) )
-        pprint(command)
-        proc = subprocess.Popen(command.split(' '))
-        self.process_pipe.append( (job_id, proc) )
-      for proc in self.process_pipe:
-        if not proc[1].poll() is None:
-          MSG_INFO( self,  ('pop process id (%d) from the stack')%(proc[0]) )
-          self.process_pipe.remove(proc)
-    
-    # Check pipe process
-    # Protection for the last jobs
-    while len(self.process_pipe)>0:
-      for proc in self.process_pipe:
-        if not proc[1].poll() is None:
-          #MSG_INFO( self,  ('pop process id (%d) from the stack')%(proc[0]), extra={'color':'0;35'})
-          MSG_INFO( self,  ('pop process id (%d) from the stack')%(proc[0]) )
-          self.process_pipe.remove(proc)
-
-    # Merge
-    command = "hadd -f "+self._output
-    for fname in self.output_to_merge:
-      command += ' '+fname
-    os.system(command)
-    for fname in self.output_to_merge:
-      os.system( 'rm -rf '+fname)
+
+    parts, done = self.restore()
+    skip = set( job_id for _, job_id_list in parts for job_id in job_id_list ) | set( job_id for job_id, _ in done )
+    self._ranges = [ r for r in self._ranges if not r[0] in skip ]
+
+    # Each merged batch is recorded, so the resumed run does not need its range outputs
+    merger = OutputMerger( self._output, maxWorkers=self._mergeWorkers, batchSize=self._mergeBatch,
+                           prefix=('output_%d') % self._base_id,
+                           onMerge=lambda part, ids: self.record( 'part %s %s' % (part, ','.join(str(job_id) for job_id in ids)) ) )
+    for part, ids in parts:
+      merger.add_part( part, ids )
+    for job_id, fname in done:
+      merger.add( fname, job_id )
+
+    MSG_INFO( self, 'Running %d ranges with %d workers (base seed %d)', len(self._ranges), self._maxJobs, self._seed )
+    ranges   = queue.Queue()
+    finished = queue.Queue()
+    for r in self._ranges:
+      ranges.put( r + (0,) )
+    failed = []
+    lock = threading.Lock()
+    pending = [len(self._ranges)]
+    if not self._ranges:
+      for _ in range(int(self._maxJobs)):
+        ranges.put( None )
+      finished.put( None )
+
+    def worker():
+      while True:
+        r = ranges.get()
+        if r is None:
+          return
+        job_id, first, nevents, attempt = r
+        oname = ('output_%d_%d.root') % (self._base_id, job_id)
+        command = self.job_command( job_id, first, nevents, oname )
+        MSG_INFO( self, 'running range %d (attempt %d): %s', job_id, attempt, command )
+        # Blocks this worker only (no polling)
+        if subprocess.call( command.split(' ') ) == 0 and os.path.exists( oname ):
+          finished.put( (job_id, oname) )
+        elif attempt < self._retries:
+          MSG_WARNING( self, 'range %d failed. Retrying...', job_id )
+          ranges.put( (job_id, first, nevents, attempt+1) )
+          continue
+        else:
+          MSG_ERROR( self, 'range %d failed after %d attempts', job_id, attempt+1 )
+          failed.append( job_id )
+        with lock:
+          pending[0] -= 1
+          if pending[0] == 0:
+            # Release the other workers and the merger
+            for _ in range(int(self._maxJobs)):
+              ranges.put( None )
+            finished.put( None )
+
+    threads = [ threading.Thread( target=worker ) for _ in range(int(self._maxJobs)) ]
+    for t in threads:
+      t.start()
+
+    # Incremental merge: each batch of finished ranges goes into a partial file
+    while True:
+      item = finished.get()
+      if item is None:
+        break
+      self.record( 'done %d %s' % item )
+      job_id, fname = item
+      merger.add( fname, job_id )
+
+    for t in threads:
+      t.join()
+
+    if failed:
+      # Keep the journal and the finished ranges to resume
+      merger.wait()
+      MSG_ERROR( self, 'The ranges %s failed. Run again with --resume to complete the output.', sorted(failed) )
+      return False
+
+    # Final merge of the partial files and the last outputs
+    if not merger.close():
+      return False
+    os.remove( self._journal )
+    return True
+
 
 
 mainLogger = Logger.getModuleLogger("prun.job")
 parser = argparse.ArgumentParser(description = '', add_help = False)
 parser = argparse.ArgumentParser()
 
-parser.add_argument('-o','--outputFile', action='store', 
+parser.add_argument('-o','--outputFile', action='store',
     dest='outputFile', required = True,
     help = "The input files.")
 
-parser.add_argument('-c','--command', action='store', 
+parser.add_argument('-c','--command', action='store',
     dest='command', required = True,
     help = "The command job")
 
-parser.add_argument('-mt','--numberOfThreads', action='store', 
+parser.add_argument('-mt','--numberOfThreads', action='store',
     dest='numberOfThreads', required = False, default = 1, type=int,
     help = "The number of threads")
 
-parser.add_argument('-n','--numberOfJobs', action='store', 
+parser.add_argument('-n','--numberOfJobs', action='store',
     dest='numberOfJobs', required = False, default = 1, type=int,
-    help = "The number of jobs")
+    help = "The number of jobs (used only without the number of events)")
+
+parser.add_argument('--evt','--numberOfEvents', action='store',
+    dest='numberOfEvents', required = False, default = None, type=int,
+    help = "The total number of events, split in ranges pulled by the idle workers")
+
+parser.add_argument('--rangeSize', action='store',
+    dest='rangeSize', required = False, default = 100, type=int,
+    help = "The number of events of each range")
+
+parser.add_argument('-s','--seed', action='store',
+    dest='seed', required = False, default = 0, type=int,
+    help = "The base seed of the ranges (zero is the clock system)")
+
+parser.add_argument('--retries', action='store',
+    dest='retries', required = False, default = 2, type=int,
+    help = "The number of times that a failed range is retried")
+
+parser.add_argument('--resume', action='store_true',
+    dest='resume', required = False,
+    help = "Resume from the journal of the output file (only the missing ranges are run)")
+
+parser.add_argument('--mergeBatch', action='store',
+    dest='mergeBatch', required = False, default = 10, type=int,
+    help = "Merge the finished ranges in batches of this size while the others are running")
+
+parser.add_argument('--mergeWorkers', action='store',
+    dest='mergeWorkers', required = False, default = 2, type=int,
+    help = "The maximum number of batches merged at the same time")
+
+parser.add_argument('--generator', action='store_true',
+    dest='generator', required = False,
+    help = "The command generates its events (e.g. generator.py), so the ranges do not need {FIRST}")
 
 
 
@@ -88,7 +258,17 @@ if len(sys.argv)==1:
   sys.exit(1)
 args = parser.parse_args()
 
-prun = Parallel( args.command, args.numberOfJobs, args.numberOfThreads, args.outputFile )
-prun.run()
-
+# Without {FIRST}, all ranges of a command with input (e.g. reco_trf.py -i) would take the same events
+if args.numberOfEvents is not None and not '{FIRST}' in args.command and not args.generator:
+  mainLogger.fatal( "The command has no {FIRST} to split its input in ranges. Use --generator if it generates its events." )
+  sys.exit(1)
 
+prun = Parallel( args.command, args.numberOfJobs, args.numberOfThreads, args.outputFile,
+                 nevents    = args.numberOfEvents,
+                 rangeSize  = args.rangeSize,
+                 seed       = args.seed,
+                 retries    = args.retries,
+                 mergeBatch = args.mergeBatch,
+                 mergeWorkers = args.mergeWorkers,
+                 resume     = args.resume )
+sys.exit( 0 if prun.run() else 1 )
@@ -27,6 +27,9 @@ parser.add_argument('--outputLevel', action='store', dest='outputLevel', require
 parser.add_argument('-nt','--numberOfThreads', action='store', dest='numberOfThreads', required = False, type=int, default=1,
                     help = "The number of threads")
 
+parser.add_argument('--mergeWorkers', action='store', dest='mergeWorkers', required = False, type=int, default=2,
+                    help = "The maximum number of parallel merges of the thread files.")
+
 parser.add_argument('--evt','--numberOfEvents', action='store', dest='numberOfEvents', required = False, type=int, default=None,
                     help = "The number of events to apply the reconstruction.")
 
@@ -120,16 +123,9 @@ acc.run(args.numberOfEvents)
 
 
 
-# Merge all files
-command = "hadd -f " + args.outputFile + ' '
-for fname in outputFileList:
-  command+=fname + ' '
-print( command )
-os.system(command)
-
-# remove thread files
-for fname in outputFileList:
-  os.system( 'rm '+ fname )
+# Merge all thread files (the inputs are removed only if all entries are in the output)
+if not merge_outputs( args.outputFile, outputFileList, maxWorkers = args.mergeWorkers ):
+  sys.exit(1)
 
 
 
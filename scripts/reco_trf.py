@@ -8,6 +8,7 @@ from CaloRec            import CaloNtupleMaker
 from CaloRec            import CaloClusterMaker
 from CaloRingerBuilder  import *
 from CaloRec            import RawNtupleMaker
+from CaloRec            import PileupOverlay, PileupLibraryMaker
 import numpy as np
 import argparse
 import sys,os
@@ -18,8 +19,23 @@ parser = argparse.ArgumentParser(description = '', add_help = False)
 parser = argparse.ArgumentParser()
 
 
-parser.add_argument('-i','--inputFile', action='store', dest='inputFile', required = False,
-                    help = "The event input file generated by the Pythia event generator.")
+parser.add_argument('-i','--inputFile', action='store', dest='inputFile', required = False, nargs='+', default=[],
+                    help = "The event input files generated by the Pythia event generator (read as a single chain).")
+
+parser.add_argument('--inputFormat', action='store', dest='inputFormat', required = False, default="particles",
+                    help = "The input format: particles (event generator), hepmc3 (ASCII) or hepmc3root.")
+
+parser.add_argument('--seedStatus', action='store', dest='seedStatus', required = False, type=int, nargs='+', default=[],
+                    help = "HepMC status of the particles used as seeds (HepMC input only).")
+
+parser.add_argument('--seedParticles', action='store', dest='seedParticles', required = False, type=int, nargs='+', default=[],
+                    help = "Pdg ids (absolute value) of the particles used as seeds (HepMC input only).")
+
+parser.add_argument('--seedMinEt', action='store', dest='seedMinEt', required = False, type=float, default=0,
+                    help = "Minimum transverse energy of the seeds in GeV (HepMC input only).")
+
+parser.add_argument('--firstEvent', action='store', dest='firstEvent', required = False, type=int, default=0,
+                    help = "The first entry of the input chain to be simulated.")
 
 parser.add_argument('-o','--outputFile', action='store', dest='outputFile', required = False,
                     help = "The reconstructed event file generated by lzt/geant4 framework.")
@@ -30,6 +46,9 @@ parser.add_argument('--outputLevel', action='store', dest='outputLevel', require
 parser.add_argument('-nt','--numberOfThreads', action='store', dest='numberOfThreads', required = False, type=int, default=1,
                     help = "The number of threads")
 
+parser.add_argument('--mergeWorkers', action='store', dest='mergeWorkers', required = False, type=int, default=2,
+                    help = "The maximum number of parallel merges of the thread files.")
+
 parser.add_argument('--evt','--numberOfEvents', action='store', dest='numberOfEvents', required = False, type=int, default=None,
                     help = "The number of events to apply the reconstruction.")
 
@@ -39,6 +58,78 @@ parser.add_argument('--visualization', action='store_true', dest='visualization'
 parser.add_argument('--cal','--calorimeter', action='store', dest='Calorimeter', required = False,
                     help = "Choose the calorimeter")
 
+parser.add_argument('--stepAccounting', action='store_true', dest='stepAccounting', required = False,
+                    help = "Count the geant steps and tracks per region and particle.")
+
+parser.add_argument('--memoryAccounting', action='store_true', dest='memoryAccounting', required = False,
+                    help = "Sample the memory footprint per event context key, algorithm and the process RSS.")
+
+parser.add_argument('--allocAccounting', action='store_true', dest='allocAccounting', required = False,
+                    help = "Count the heap allocations per algorithm phase (needs the LZT_ALLOC_COUNTING build).")
+
+parser.add_argument('--allocationGuard', action='store', dest='allocationGuard', required = False, type=float, default=-1,
+                    help = "Fail the job if an algorithm allocates more than this per step (with --allocAccounting, -1 to only report).")
+
+parser.add_argument('--checkpoint', action='store', dest='checkpoint', required = False, type=int, default=0,
+                    help = "Flush the thread files and record their completed events each N events of a thread (zero is disabled).")
+
+parser.add_argument('--resume', action='store_true', dest='resume', required = False,
+                    help = "Resume from the checkpoint of the output file (same seed, only the missing events).")
+
+parser.add_argument('--metricsFile', action='store', dest='metricsFile', required = False, default="",
+                    help = "Write periodic progress/throughput snapshots into this file.")
+
+parser.add_argument('--metricsFormat', action='store', dest='metricsFormat', required = False, default="json",
+                    help = "The metrics file format (json or prometheus).")
+
+parser.add_argument('-s','--seed', action='store', dest='seed', required = False, type=int, default=0,
+                    help = "The geant seed (zero is the clock system)")
+
+parser.add_argument('--stepRecord', action='store', dest='stepRecord', required = False, default="",
+                    help = "Record all geant steps into this file (one file per thread) to be replayed later.")
+
+parser.add_argument('--fastSimulation', action='store_true', dest='fastSimulation', required = False,
+                    help = "Parametrize the EM showers in the EM1, EM2 and EM3 regions (ATLAS and Generic only).")
+
+parser.add_argument('--showerLibrary', action='store', dest='showerLibrary', required = False, nargs='+', default=[],
+                    help = "Replay the frozen showers of these library files for the soft e+/e-/gamma (ATLAS and Generic only).")
+
+parser.add_argument('--buildShowerLibrary', action='store', dest='buildShowerLibrary', required = False, default="",
+                    help = "Write the showers of the soft e+/e-/gamma into this library file (one file per thread).")
+
+parser.add_argument('--physicsList', action='store', dest='physicsList', required = False, default="FTFP_BERT",
+                    help = "The geant reference physics list.")
+
+parser.add_argument('--productionCuts', action='store', dest='productionCuts', required = False, nargs='+', default=[],
+                    help = "Range cuts per region as REGION=mm (e.g. HAD1=10 DeadMatBeforeECal=5).")
+
+parser.add_argument('--coarseCuts', action='store_true', dest='coarseCuts', required = False,
+                    help = "Use coarse range cuts (1 cm) in the dead material and in the hadronic calorimeter.")
+
+parser.add_argument('--trackTriage', action='store_true', dest='trackTriage', required = False,
+                    help = "Kill the neutrinos and the tracks after the readout window or outside of the calorimeter.")
+
+parser.add_argument('--triageMaxTime', action='store', dest='triageMaxTime', required = False, type=float, default=200,
+                    help = "The latest time (ns) used by the track triage.")
+
+parser.add_argument('--triageMinEnergy', action='store', dest='triageMinEnergy', required = False, nargs='+', default=[],
+                    help = "Kill the new tracks below the kinetic energy as PDG=MeV (e.g. 2112=1).")
+
+parser.add_argument('--roi', action='store', dest='roi', required = False, type=float, default=0,
+                    help = "RoI mode: only simulate and read out inside of this Delta R around the seeds (zero is disabled).")
+
+parser.add_argument('--pileupLibrary', action='store', dest='pileupLibrary', required = False, nargs='+', default=[],
+                    help = "Overlay the minimum bias deposits of these library files in place of the simulated pileup.")
+
+parser.add_argument('--pileupAvg', action='store', dest='pileupAvg', required = False, type=float, default=0,
+                    help = "The pileup average used by the overlay.")
+
+parser.add_argument('--buildPileupLibrary', action='store_true', dest='buildPileupLibrary', required = False,
+                    help = "Dump the cell deposits of each (minimum bias only, one interaction) event into the pileup library tree.")
+
+parser.add_argument('--replay', action='store', dest='replayFiles', required = False, nargs='+', default=[],
+                    help = "Replay the recorded steps through the reconstruction chain without geant.")
+
 if len(sys.argv)==1:
   parser.print_help()
   sys.exit(1)
@@ -50,12 +141,44 @@ print (args)
 if not '.root' in args.outputFile:
   args.outputFile+='.root'
 
+# The replay runs in a single thread
+if args.replayFiles:
+  args.numberOfThreads = 1
+
 # Add index for each thread
 outputFileList = []
 for thread in range( args.numberOfThreads ):
   outputFileList.append( args.outputFile.replace( '.root', "_%d.root"%thread ) )
 
 
+# Range cuts per region. The explicit cuts override the coarse ones
+cuts = {}
+if args.coarseCuts:
+  cuts.update( { region : 10. for region in ["DeadMatBeforeECal", "DeadMaterialBeforeHCal", "HAD1", "HAD2", "HAD3"] } )
+for cut in args.productionCuts:
+  region, value = cut.split('=')
+  cuts[region] = float(value)
+
+physics = { 'PhysicsList' : args.physicsList }
+if cuts:
+  physics.update( { 'ProductionCutRegions' : list(cuts.keys()), 'ProductionCuts' : list(cuts.values()) } )
+
+if args.trackTriage:
+  physics.update( { 'UseTrackTriage' : True, 'TriageMaxTime' : args.triageMaxTime } )
+  if args.triageMinEnergy:
+    physics.update( { 'TriageParticles' : [ int(v.split('=')[0]) for v in args.triageMinEnergy ],
+                      'TriageMinEnergy' : [ float(v.split('=')[1]) for v in args.triageMinEnergy ] } )
+
+if args.roi > 0:
+  physics.update( { 'RoIDeltaR' : args.roi } )
+
+
+# Fast simulation options of the LAr detectors
+fastsim = { 'UseFastSimulation' : args.fastSimulation }
+if args.showerLibrary:
+  fastsim.update( { 'UseShowerLibrary' : True, 'ShowerLibraryFiles' : args.showerLibrary } )
+
+
 from DetectorATLASModel import DetectorConstruction as ATLAS
 from DetectorGenericModel import DetectorConstruction as Generic
 from DetectorScintiModel import DetectorConstruction as Scinti
@@ -66,41 +189,100 @@ if args.Calorimeter == "ATLAS":
   from DetectorATLASModel import CaloCellBuilder
   
   acc = ComponentAccumulator("ComponentAccumulator",
-                            ATLAS("GenericATLASDetector"),
+                            ATLAS("GenericATLASDetector", **fastsim),
                             RunVis=args.visualization,
                             NumberOfThreads = args.numberOfThreads,
-                            OutputFile = args.outputFile)
+                            OutputFile = args.outputFile,
+                            UseStepAccounting = args.stepAccounting,
+                            UseMemoryAccounting = args.memoryAccounting,
+                            UseAllocAccounting = args.allocAccounting,
+                            AllocationGuard = args.allocationGuard,
+                            MetricsFile = args.metricsFile,
+                            MetricsFormat = args.metricsFormat,
+                            Seed = args.seed,
+                            CheckpointInterval = args.checkpoint,
+                            Resume = args.resume,
+                            StepRecordFile = args.stepRecord,
+                            ShowerLibraryFile = args.buildShowerLibrary,
+                            **physics)
 
 if args.Calorimeter == "Generic":
 
   from DetectorGenericModel import CaloCellBuilder
   
   acc = ComponentAccumulator("ComponentAccumulator",
-                            Generic("GenericATLASDetector"),
+                            Generic("GenericATLASDetector", **fastsim),
                             RunVis=args.visualization,
                             NumberOfThreads = args.numberOfThreads,
-                            OutputFile = args.outputFile)
+                            OutputFile = args.outputFile,
+                            UseStepAccounting = args.stepAccounting,
+                            UseMemoryAccounting = args.memoryAccounting,
+                            UseAllocAccounting = args.allocAccounting,
+                            AllocationGuard = args.allocationGuard,
+                            MetricsFile = args.metricsFile,
+                            MetricsFormat = args.metricsFormat,
+                            Seed = args.seed,
+                            CheckpointInterval = args.checkpoint,
+                            Resume = args.resume,
+                            StepRecordFile = args.stepRecord,
+                            ShowerLibraryFile = args.buildShowerLibrary,
+                            **physics)
                             
 if args.Calorimeter == "Scintillator":
 
+  if args.fastSimulation or args.showerLibrary:
+    mainLogger.warning( "The fast simulation is not available for the scintillator calorimeter. Using the full simulation." )
   from DetectorScintiModel import CaloCellBuilder
 
   acc = ComponentAccumulator("ComponentAccumulator",
                             Scinti("ScintiDetector"),
                             RunVis=args.visualization,
                             NumberOfThreads = args.numberOfThreads,
-                            OutputFile = args.outputFile)
-
-
-gun = EventReader( "PythiaGenerator",
-                   EventKey   = recordable("EventInfo"),
-                   FileName   = args.inputFile)
+                            OutputFile = args.outputFile,
+                            UseStepAccounting = args.stepAccounting,
+                            UseMemoryAccounting = args.memoryAccounting,
+                            UseAllocAccounting = args.allocAccounting,
+                            AllocationGuard = args.allocationGuard,
+                            MetricsFile = args.metricsFile,
+                            MetricsFormat = args.metricsFormat,
+                            Seed = args.seed,
+                            CheckpointInterval = args.checkpoint,
+                            Resume = args.resume,
+                            StepRecordFile = args.stepRecord,
+                            ShowerLibraryFile = args.buildShowerLibrary,
+                            **physics)
+
+
+if args.replayFiles:
+  # Same chain, but the steps come from the record files instead of geant
+  acc = StepReplay( "StepReplay",
+                    InputFiles = args.replayFiles,
+                    OutputFile = outputFileList[0],
+                    EventKey   = recordable("EventInfo") )
+  if args.numberOfEvents:
+    acc.setNumberOfEvents( args.numberOfEvents )
+else:
+  # Empty lists can not be converted into properties
+  seeds = {}
+  if args.seedStatus:
+    seeds['SeedStatus'] = args.seedStatus
+  if args.seedParticles:
+    seeds['SeedParticles'] = args.seedParticles
+  gun = EventReader( "PythiaGenerator",
+                     EventKey       = recordable("EventInfo"),
+                     InputFiles     = args.inputFile,
+                     FirstEvent     = args.firstEvent,
+                     InputFormat    = args.inputFormat,
+                     SeedMinEt      = args.seedMinEt,
+                     NumberOfEvents = args.numberOfEvents if args.numberOfEvents else -1,
+                     **seeds)
 
 
 
 calorimeter = CaloCellBuilder("CaloCellATLASBuilder",
                               HistogramPath = "Expert/CaloCells",
-                              OutputLevel   = args.outputLevel)
+                              OutputLevel   = args.outputLevel,
+                              RoIDeltaR     = args.roi)
 
 
 
@@ -174,8 +356,25 @@ ntuple = CaloNtupleMaker( "CaloNtupleMaker",
 
 
 
-gun.merge(acc)
+collectionKeys = [ recordable("Collection_"+key) for key in ["EM1","EM2","EM3","HAD1","HAD2","HAD3"] ]
+
+
+if not args.replayFiles:
+  gun.merge(acc)
+if args.pileupLibrary:
+  # Must run before the cell makers to add the deposits before the pulse generation
+  acc+= PileupOverlay( "PileupOverlay",
+                       CollectionKeys = collectionKeys,
+                       InputFiles     = args.pileupLibrary,
+                       EventKey       = recordable("EventInfo"),
+                       PileupAvg      = args.pileupAvg,
+                       OutputLevel    = args.outputLevel)
 calorimeter.merge(acc)
+if args.buildPileupLibrary:
+  acc+= PileupLibraryMaker( "PileupLibraryMaker",
+                            CollectionKeys = collectionKeys,
+                            EventKey       = recordable("EventInfo"),
+                            OutputLevel    = args.outputLevel)
 acc+= cluster
 acc+= truth_cluster
 
@@ -186,16 +385,12 @@ acc += ntuple
 #acc += raw
 acc.run(args.numberOfEvents)
 
-# Merge all files
-command = "hadd -f " + args.outputFile + ' '
-for fname in outputFileList:
-  command+=fname + ' '
-print( command )
-os.system(command)
+# The events of a resumed run are also in the part files of its checkpoint (only those)
+outputFileList += acc.checkpointParts()
 
-# remove thread files
-for fname in outputFileList:
-  os.system( 'rm '+ fname )
+# Merge all thread files (the inputs are removed only if all entries are in the output)
+if not merge_outputs( args.outputFile, outputFileList, maxWorkers = args.mergeWorkers ):
+  sys.exit(1)
 
 
 
@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+from Gaugi.messenger    import LoggingLevel, Logger
+import argparse
+import subprocess
+import json
+import time
+import sys,os
+
+
+mainLogger = Logger.getModuleLogger("regression")
+parser = argparse.ArgumentParser(description = '', add_help = False)
+parser = argparse.ArgumentParser()
+
+#
+# Sample arguments
+#
+
+parser.add_argument('--filter', action='store', dest='filter', required = True,
+                    help = "The event filter (Zee or JF17).")
+
+parser.add_argument('--evt','--numberOfEvents', action='store', dest='numberOfEvents', required = False, type=int, default=20,
+                    help = "The number of events to be generated and reconstructed.")
+
+parser.add_argument('--pileupAvg', action='store', dest='pileupAvg', required = False, type=int, default=0,
+                    help = "The pileup average (default is zero).")
+
+parser.add_argument('--bc_id_start', action='store', dest='bc_id_start', required = False, type=int, default=-8,
+                    help = "The bunch crossing id start.")
+
+parser.add_argument('--bc_id_end', action='store', dest='bc_id_end', required = False, type=int, default=7,
+                    help = "The bunch crossing id end.")
+
+parser.add_argument('-s','--seed', action='store', dest='seed', required = False, type=int, default=512,
+                    help = "The pythia and geant seed. Must be fixed to compare against the baseline.")
+
+parser.add_argument('-nt','--numberOfThreads', action='store', dest='numberOfThreads', required = False, type=int, default=1,
+                    help = "The number of threads used by the reconstruction.")
+
+parser.add_argument('--allocationGuard', action='store', dest='allocationGuard', required = False, type=float, default=-1,
+                    help = "Only check that no algorithm allocates more than this per step (LZT_ALLOC_COUNTING build). No baseline comparison.")
+
+parser.add_argument('--cal','--calorimeter', action='store', dest='Calorimeter', required = False, default="ATLAS",
+                    help = "Choose the calorimeter")
+
+#
+# Baseline arguments
+#
+
+parser.add_argument('-o','--outputFile', action='store', dest='outputFile', required = False, default=None,
+                    help = "The json file with the results (default: <sample>.json).")
+
+parser.add_argument('-b','--baseline', action='store', dest='baseline', required = False,
+                    default=os.environ.get('LZT_PATH','.')+'/benchmark/data/regression_baseline.json',
+                    help = "The json file with the baseline results.")
+
+parser.add_argument('-t','--tolerance', action='store', dest='tolerance', required = False, type=float, default=0.15,
+                    help = "The relative tolerance allowed with respect to the baseline.")
+
+parser.add_argument('--updateBaseline', action='store_true', dest='updateBaseline', required = False,
+                    help = "Store this result as the new baseline for this sample.")
+
+
+if len(sys.argv)==1:
+  parser.print_help()
+  sys.exit(1)
+
+args = parser.parse_args()
+
+
+configs = { 'Zee'  : 'zee_config.cmnd',
+            'JF17' : 'jet_config.cmnd' }
+
+if not args.filter in configs.keys():
+  mainLogger.fatal( "The event filter (%s) is not supported. Use Zee or JF17."%args.filter )
+
+
+
+def execute( command ):
+  """
+    Run the command and return the wall time (in seconds) and the peak RSS (in bytes) of the process.
+  """
+  mainLogger.info( ' '.join(command) )
+  start = time.time()
+  proc = subprocess.Popen( command )
+  _, status, usage = os.wait4( proc.pid, 0 )
+  wall = time.time() - start
+  proc.returncode = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -1
+  if proc.returncode != 0:
+    mainLogger.fatal( "The command failed with status %d: %s"%(proc.returncode, ' '.join(command)) )
+    sys.exit(1)
+  # linux reports the max RSS in kilobytes, darwin in bytes
+  rss = usage.ru_maxrss if sys.platform == "darwin" else usage.ru_maxrss*1024
+  return wall, rss
+
+
+
+def last_snapshot( path ):
+  """
+    Read the last snapshot (json line) written by the metrics exporter.
+  """
+  if not os.path.exists(path):
+    return None
+  with open(path) as f:
+    lines = [ line for line in f.read().split('\n') if line.strip() ]
+  return json.loads(lines[-1]) if lines else None
+
+
+
+sample   = "%s_mu%d_nt%d"%(args.filter, args.pileupAvg, args.numberOfThreads)
+basepath = os.path.dirname(os.path.realpath(__file__))
+evtFile  = sample + ".EVT.root"
+recoFile = sample + ".ESD.root"
+metrics  = sample + ".metrics.json"
+if os.path.exists(metrics):
+  os.remove(metrics)
+
+
+# Event generation (always single thread)
+gen_time, gen_rss = execute( [ sys.executable, basepath+'/generator.py',
+                               '-i', os.environ['LZT_PATH']+'/generator/PythiaGenerator/data/'+configs[args.filter],
+                               '-o', evtFile,
+                               '--filter', args.filter,
+                               '--evt', str(args.numberOfEvents),
+                               '--pileupAvg', str(args.pileupAvg),
+                               '--bc_id_start', str(args.bc_id_start),
+                               '--bc_id_end', str(args.bc_id_end),
+                               '--seed', str(args.seed),
+                               '--outputLevel', '6' ] )
+
+# Simulation and reconstruction
+reco_time, reco_rss = execute( [ sys.executable, basepath+'/reco_trf.py',
+                                 '-i', evtFile,
+                                 '-o', recoFile,
+                                 '-nt', str(args.numberOfThreads),
+                                 '--evt', str(args.numberOfEvents),
+                                 '--cal', args.Calorimeter,
+                                 '--seed', str(args.seed),
+                                 '--metricsFile', metrics,
+                                 '--outputLevel', '6' ] +
+                               ( ['--allocAccounting', '--allocationGuard', str(args.allocationGuard)] if args.allocationGuard >= 0 else [] ) )
+
+# The reco job fails if the allocation guard is not respected. The counters slow down the job, so there
+# is nothing to compare against the throughput baseline
+if args.allocationGuard >= 0:
+  mainLogger.info( "No algorithm allocates more than %g times per step"%args.allocationGuard )
+  sys.exit(0)
+
+
+# The exporter starts before the geometry/physics initialization, the loop time is counted from the first
+# event. Everything else is the initialization and the merge
+snapshot   = last_snapshot( metrics )
+loop_time  = snapshot.get('loop_elapsed', 0) if snapshot else 0
+loop_time  = loop_time if loop_time > 0 else reco_time
+nevents    = snapshot['events'] if snapshot and snapshot['events'] > 0 else args.numberOfEvents
+
+result = {
+    'sample'                 : sample,
+    'filter'                 : args.filter,
+    'pileup'                 : args.pileupAvg,
+    'threads'                : args.numberOfThreads,
+    'events'                 : nevents,
+    'seed'                   : args.seed,
+    'calorimeter'            : args.Calorimeter,
+    'host'                   : os.uname()[1],
+    'time'                   : time.time(),
+    'events_per_second'      : nevents/loop_time if loop_time > 0 else 0,
+    'phases'                 : { 'generation'     : gen_time,
+                                 'initialization' : reco_time - loop_time,
+                                 'event_loop'     : loop_time },
+    'peak_rss_bytes'         : reco_rss,
+    'generation_rss_bytes'   : gen_rss,
+    'output_bytes_per_event' : os.path.getsize(recoFile)/float(nevents),
+}
+
+outputFile = args.outputFile if args.outputFile else sample + '.json'
+with open( outputFile, 'w' ) as f:
+  json.dump( result, f, indent=2, sort_keys=True )
+mainLogger.info( "Results written into %s"%outputFile )
+
+
+# Compare against the baseline
+baseline = {}
+if os.path.exists(args.baseline):
+  with open(args.baseline) as f:
+    baseline = json.load(f)
+
+if args.updateBaseline:
+  baseline[sample] = result
+  with open( args.baseline, 'w' ) as f:
+    json.dump( baseline, f, indent=2, sort_keys=True )
+  mainLogger.info( "Baseline updated for %s into %s"%(sample, args.baseline) )
+  sys.exit(0)
+
+# Reported as skipped by ctest (SKIP_RETURN_CODE), never as passed
+if not sample in baseline.keys():
+  mainLogger.warning( "There is no baseline for %s in %s. Run with --updateBaseline on the reference machine."%(sample, args.baseline) )
+  sys.exit(77)
+
+
+# ( name, True if higher is better )
+checks = [ ('events_per_second'     , True  ),
+           ('peak_rss_bytes'        , False ),
+           ('output_bytes_per_event', False ) ]
+
+failed = False
+ref = baseline[sample]
+for name, higher_is_better in checks:
+  value = result[name]; expected = ref[name]
+  ratio = value/expected if expected else 1.
+  regression = ratio < 1-args.tolerance if higher_is_better else ratio > 1+args.tolerance
+  message = "%25s: %g (baseline %g, ratio %.3f)"%(name, value, expected, ratio)
+  if regression:
+    mainLogger.error( message + " <- regression" )
+    failed = True
+  else:
+    mainLogger.info( message )
+
+for phase, value in result['phases'].items():
+  mainLogger.info( "%25s: %.2f s (baseline %.2f s)"%(phase, value, ref['phases'].get(phase, 0)) )
+
+sys.exit( 1 if failed else 0 )
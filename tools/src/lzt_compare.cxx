@@ -0,0 +1,458 @@
+
+/*
+ * @file lzt_compare.cxx
+ * @brief Compare two lorenzett output files (ntuples and monitoring histograms)
+ *        branch by branch. The entries are matched by (EventNumber, seed index)
+ *        so files produced with a different number of threads (and merged with
+ *        hadd) can be compared. Trees without EventNumber (e.g. particles) are
+ *        matched by entry.
+ *
+ *        usage: lzt_compare reference.root test.root [options]
+ *
+ *          --abs <value>               default absolute tolerance (0)
+ *          --rel <value>               default relative tolerance (1e-6)
+ *          --tol <pattern>=<abs>,<rel> tolerance for the branches/histograms matching the pattern (can be repeated)
+ *          --tree <pattern>            only compare the trees matching the pattern (can be repeated)
+ *          --skip <pattern>            skip the objects matching the pattern (default: *Accounting*)
+ *          --no-hists                  do not compare the histograms
+ *          --verbose                   print the summary of all branches, not only the differing ones
+ *
+ *        The patterns are shell wildcards (fnmatch) over the object path (e.g. "events/cl_cell_*").
+ *        Returns 0 if both files are equivalent, 1 if not and 2 for bad arguments.
+ */
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TLeaf.h"
+#include "TBranch.h"
+#include "TKey.h"
+#include "TH1.h"
+#include "TTreeFormula.h"
+#include "TError.h"
+#include "GaugiKernel/PrettyTable.h"
+
+#include <fnmatch.h>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+
+
+namespace{
+
+  struct tolerance_t{
+    double abs;
+    double rel;
+  };
+
+
+  struct stats_t{
+    unsigned long long compared=0;
+    unsigned long long failed=0;
+    unsigned long long size_mismatch=0;
+    double max_abs=0;
+    double max_rel=0;
+    double sum_abs=0;
+  };
+
+
+  /*! The first difference (in event order) found in a tree */
+  struct first_diff_t{
+    bool found=false;
+    long long event=0;
+    int seed=0;
+    std::string branch;
+    int instance=0;
+    double ref=0;
+    double test=0;
+    std::string where;
+  };
+
+
+  struct config_t{
+    tolerance_t def{0, 1e-6};
+    std::vector<std::pair<std::string, tolerance_t>> tolerances;
+    std::vector<std::string> trees;
+    std::vector<std::string> skip{"*Accounting*"};
+    bool hists=true;
+    bool verbose=false;
+  };
+
+
+  bool match( const std::vector<std::string> &patterns, const std::string &name )
+  {
+    for ( const auto &p : patterns )
+      if ( fnmatch( p.c_str(), name.c_str(), 0 ) == 0 ) return true;
+    return false;
+  }
+
+
+  /*! The last matching --tol wins, so specific patterns can be given after generic ones */
+  tolerance_t tolerance( const config_t &cfg, const std::string &name )
+  {
+    tolerance_t tol = cfg.def;
+    for ( const auto &it : cfg.tolerances )
+      if ( fnmatch( it.first.c_str(), name.c_str(), 0 ) == 0 ) tol = it.second;
+    return tol;
+  }
+
+
+  /*! Return true if both values agree within the tolerance and update the statistics */
+  bool compare( double a, double b, const tolerance_t &tol, stats_t &stats )
+  {
+    stats.compared++;
+    if ( std::isnan(a) && std::isnan(b) ) return true;
+    if ( a == b ) return true;
+    double diff = std::abs(a-b);
+    double scale = std::max( std::abs(a), std::abs(b) );
+    double rel = scale > 0 ? diff/scale : 0;
+    if ( std::isnan(diff) ) diff = rel = INFINITY;
+    stats.sum_abs += diff;
+    stats.max_abs = std::max( stats.max_abs, diff );
+    stats.max_rel = std::max( stats.max_rel, rel );
+    if ( diff <= tol.abs || rel <= tol.rel ) return true;
+    stats.failed++;
+    return false;
+  }
+
+
+  /*! Only numeric leaves (and vectors of them) can be compared value by value */
+  bool numeric( TLeaf *leaf )
+  {
+    std::string type = leaf->GetTypeName();
+    static const std::vector<std::string> basic = { "Bool_t", "Char_t", "UChar_t", "Short_t", "UShort_t", "Int_t",
+      "UInt_t", "Long_t", "ULong_t", "Long64_t", "ULong64_t", "Float_t", "Double_t", "bool", "char", "short",
+      "int", "unsigned int", "long", "unsigned long", "float", "double" };
+    for ( const auto &b : basic ){
+      if ( type == b || type == "vector<" + b + ">" ) return true;
+    }
+    return false;
+  }
+
+
+  /*! The name used by TTreeFormula (branch name for split objects, leaf name otherwise) */
+  std::string leaf_name( TLeaf *leaf )
+  {
+    TBranch *branch = leaf->GetBranch();
+    return branch->GetNleaves() == 1 ? branch->GetName() : leaf->GetName();
+  }
+
+
+  typedef std::pair<long long, int> entry_key_t;
+
+
+  /*! Map (EventNumber, occurrence) into the entry number. Use the entry itself when there is no EventNumber */
+  std::map<entry_key_t, Long64_t> index( TTree *tree, bool byEvent )
+  {
+    std::map<entry_key_t, Long64_t> keys;
+    std::unique_ptr<TTreeFormula> evt( byEvent ? new TTreeFormula( "EventNumber", "EventNumber", tree ) : nullptr );
+    std::map<long long, int> occurrence;
+    for ( Long64_t entry=0; entry < tree->GetEntries(); ++entry ){
+      if ( !evt ){
+        keys[ entry_key_t(entry, 0) ] = entry;
+        continue;
+      }
+      tree->LoadTree(entry);
+      evt->GetNdata();
+      long long event = (long long)evt->EvalInstance(0);
+      keys[ entry_key_t(event, occurrence[event]++) ] = entry;
+    }
+    return keys;
+  }
+
+
+  /*! Compare two trees with the same name. Return true if they are equivalent */
+  bool compare_tree( const std::string &path, TTree *ref, TTree *test, const config_t &cfg )
+  {
+    std::cout << "Comparing tree " << path << " (" << ref->GetEntries() << " x " << test->GetEntries() << " entries)" << std::endl;
+    bool equal = true;
+
+    // Collect the common leaves
+    std::vector<std::string> names;
+    for ( auto *obj : *ref->GetListOfLeaves() ){
+      TLeaf *leaf = (TLeaf*)obj;
+      if ( !numeric(leaf) ) continue;
+      std::string name = leaf_name(leaf);
+      if ( !test->GetLeaf( name.c_str() ) && !test->FindLeaf( name.c_str() ) ){
+        std::cout << "  " << name << " is missing in the test file" << std::endl;
+        equal = false;
+        continue;
+      }
+      names.push_back( name );
+    }
+    for ( auto *obj : *test->GetListOfLeaves() ){
+      TLeaf *leaf = (TLeaf*)obj;
+      std::string name = leaf_name(leaf);
+      if ( numeric(leaf) && !ref->GetLeaf( name.c_str() ) && !ref->FindLeaf( name.c_str() ) ){
+        std::cout << "  " << name << " is missing in the reference file" << std::endl;
+        equal = false;
+      }
+    }
+
+    std::vector<std::unique_ptr<TTreeFormula>> fref, ftest;
+    std::vector<tolerance_t> tols;
+    std::vector<stats_t> stats( names.size() );
+    for ( const auto &name : names ){
+      fref.emplace_back ( new TTreeFormula( name.c_str(), name.c_str(), ref  ) );
+      ftest.emplace_back( new TTreeFormula( name.c_str(), name.c_str(), test ) );
+      tols.push_back( tolerance( cfg, path + "/" + name ) );
+    }
+
+    bool byEvent = ref->FindLeaf("EventNumber") && test->FindLeaf("EventNumber");
+    if ( !byEvent )
+      std::cout << "  There is no EventNumber branch. The entries will be matched by position." << std::endl;
+
+    auto kref  = index( ref , byEvent );
+    auto ktest = index( test, byEvent );
+
+    std::unique_ptr<TTreeFormula> seed_eta( ref->FindLeaf("seed_eta") ? new TTreeFormula("seed_eta", "seed_eta", ref) : nullptr );
+    std::unique_ptr<TTreeFormula> seed_phi( ref->FindLeaf("seed_phi") ? new TTreeFormula("seed_phi", "seed_phi", ref) : nullptr );
+
+    first_diff_t first;
+    unsigned long long missing=0, extra=0, differing_entries=0;
+
+    // The map is ordered, so the first difference is the first event (and seed) with a difference
+    for ( const auto &it : kref )
+    {
+      auto found = ktest.find( it.first );
+      if ( found == ktest.end() ){
+        missing++;
+        continue;
+      }
+      ref->LoadTree( it.second );
+      test->LoadTree( found->second );
+      bool entry_equal = true;
+
+      for ( unsigned b=0; b < names.size(); ++b )
+      {
+        int nref  = fref[b]->GetNdata();
+        int ntest = ftest[b]->GetNdata();
+        if ( nref != ntest ){
+          stats[b].size_mismatch++;
+          stats[b].failed++;
+        }
+        for ( int i=0; i < std::min(nref, ntest); ++i )
+        {
+          double a = fref[b]->EvalInstance(i);
+          double v = ftest[b]->EvalInstance(i);
+          if ( compare( a, v, tols[b], stats[b] ) ) continue;
+          entry_equal = false;
+          if ( !first.found ){
+            first.found = true; first.event = it.first.first; first.seed = it.first.second;
+            first.branch = names[b]; first.instance = i; first.ref = a; first.test = v;
+            if ( seed_eta && seed_phi ){
+              std::stringstream ss;
+              seed_eta->GetNdata(); seed_phi->GetNdata();
+              ss << " (seed_eta = " << seed_eta->EvalInstance(0) << ", seed_phi = " << seed_phi->EvalInstance(0) << ")";
+              first.where = ss.str();
+            }
+          }
+        }
+        if ( nref != ntest ){
+          entry_equal = false;
+          if ( !first.found ){
+            first.found = true; first.event = it.first.first; first.seed = it.first.second;
+            first.branch = names[b]; first.instance = -1; first.ref = nref; first.test = ntest;
+          }
+        }
+      }
+      if ( !entry_equal ) differing_entries++;
+    }
+
+    for ( const auto &it : ktest )
+      if ( !kref.count( it.first ) ) extra++;
+
+    // Summary
+    PrettyTable<std::string, unsigned long long, unsigned long long, unsigned long long, double, double, double>
+      table( {"branch", "compared", "failed", "size mismatch", "max abs", "max rel", "mean abs"} );
+    table.setColumnFormat( {PrettyTableColumnFormat::AUTO, PrettyTableColumnFormat::AUTO, PrettyTableColumnFormat::AUTO,
+                            PrettyTableColumnFormat::AUTO, PrettyTableColumnFormat::SCIENTIFIC,
+                            PrettyTableColumnFormat::SCIENTIFIC, PrettyTableColumnFormat::SCIENTIFIC} );
+    unsigned nfailed=0;
+    for ( unsigned b=0; b < names.size(); ++b ){
+      const auto &s = stats[b];
+      if ( s.failed ) nfailed++;
+      if ( s.failed || cfg.verbose )
+        table.addRow( names[b], s.compared, s.failed, s.size_mismatch, s.max_abs, s.max_rel,
+                      s.compared ? s.sum_abs/s.compared : 0 );
+    }
+    if ( nfailed || cfg.verbose ) table.print( std::cout );
+
+    std::cout << "  " << kref.size() - missing << " matched entries, " << differing_entries << " differing, "
+              << missing << " only in the reference, " << extra << " only in the test file. "
+              << names.size() - nfailed << "/" << names.size() << " branches within the tolerance." << std::endl;
+
+    if ( first.found ){
+      std::cout << "  First difference: " << ( byEvent ? "EventNumber = " : "entry = " ) << first.event
+                << ", seed = " << first.seed << first.where << ", branch " << first.branch;
+      if ( first.instance < 0 )
+        std::cout << " has " << first.ref << " values in the reference and " << first.test << " in the test file";
+      else
+        std::cout << "[" << first.instance << "]: " << std::setprecision(9) << first.ref << " != " << first.test;
+      std::cout << std::endl;
+    }
+
+    return equal && !first.found && !missing && !extra;
+  }
+
+
+  /*! Compare the bin contents (including under/overflow) and errors */
+  bool compare_hist( const std::string &path, TH1 *ref, TH1 *test, const config_t &cfg )
+  {
+    if ( ref->GetNcells() != test->GetNcells() ){
+      std::cout << "Histogram " << path << " has " << ref->GetNcells() << " bins in the reference and "
+                << test->GetNcells() << " in the test file" << std::endl;
+      return false;
+    }
+    tolerance_t tol = tolerance( cfg, path );
+    stats_t stats;
+    int first=-1;
+    for ( int bin=0; bin < ref->GetNcells(); ++bin ){
+      bool ok = compare( ref->GetBinContent(bin), test->GetBinContent(bin), tol, stats );
+      ok = compare( ref->GetBinError(bin), test->GetBinError(bin), tol, stats ) && ok;
+      if ( !ok && first < 0 ) first = bin;
+    }
+    if ( stats.failed ){
+      std::cout << "Histogram " << path << ": " << stats.failed << " values differ (max abs = " << stats.max_abs
+                << ", max rel = " << stats.max_rel << "). First bin: " << first << " ("
+                << ref->GetBinContent(first) << " != " << test->GetBinContent(first) << ")" << std::endl;
+    }
+    return stats.failed == 0;
+  }
+
+
+  /*! Walk both files and compare the objects with the same path */
+  bool compare_dir( TDirectory *ref, TDirectory *test, const std::string &path, const config_t &cfg,
+                    unsigned &nhists, unsigned &ntrees )
+  {
+    bool equal = true;
+    for ( auto *obj : *ref->GetListOfKeys() )
+    {
+      TKey *key = (TKey*)obj;
+      std::string name = key->GetName();
+      std::string full = path.empty() ? name : path + "/" + name;
+      if ( match( cfg.skip, full ) ) continue;
+
+      // Only the highest cycle
+      if ( ref->GetKey( name.c_str() ) != key ) continue;
+
+      TObject *oref = key->ReadObj();
+      TObject *otest = test->Get( name.c_str() );
+      bool is_tree = oref->InheritsFrom( TTree::Class() );
+      bool is_hist = oref->InheritsFrom( TH1::Class() );
+      bool is_dir  = oref->InheritsFrom( TDirectory::Class() );
+      bool selected = is_dir || ( is_tree && ( cfg.trees.empty() || match(cfg.trees, full) ) ) || ( is_hist && cfg.hists );
+
+      if ( selected && !otest ){
+        std::cout << full << " is missing in the test file" << std::endl;
+        equal = false;
+      }else if ( selected && !otest->InheritsFrom( oref->IsA() ) ){
+        std::cout << full << " has a different type in the test file" << std::endl;
+        equal = false;
+      }else if ( selected && is_dir ){
+        equal = compare_dir( (TDirectory*)oref, (TDirectory*)otest, full, cfg, nhists, ntrees ) && equal;
+      }else if ( selected && is_tree ){
+        ntrees++;
+        equal = compare_tree( full, (TTree*)oref, (TTree*)otest, cfg ) && equal;
+      }else if ( selected && is_hist ){
+        nhists++;
+        equal = compare_hist( full, (TH1*)oref, (TH1*)otest, cfg ) && equal;
+      }
+    }
+    return equal;
+  }
+
+
+  bool parse_tolerance( const std::string &arg, config_t &cfg )
+  {
+    auto eq = arg.rfind('=');
+    auto comma = arg.rfind(',');
+    if ( eq == std::string::npos || comma == std::string::npos || comma < eq ) return false;
+    tolerance_t tol{ std::atof( arg.substr(eq+1, comma-eq-1).c_str() ), std::atof( arg.substr(comma+1).c_str() ) };
+    cfg.tolerances.push_back( std::make_pair( arg.substr(0, eq), tol ) );
+    return true;
+  }
+
+
+  void usage()
+  {
+    std::cout << "usage: lzt_compare reference.root test.root [--abs value] [--rel value] [--tol pattern=abs,rel]"
+              << " [--tree pattern] [--skip pattern] [--no-hists] [--verbose]" << std::endl;
+  }
+
+}
+
+
+
+int main( int argc, char** argv )
+{
+  config_t cfg;
+  std::vector<std::string> files;
+  bool user_skip=false;
+
+  for ( int i=1; i < argc; ++i )
+  {
+    std::string arg = argv[i];
+    bool has_value = i+1 < argc;
+    if ( arg == "--abs" && has_value ){
+      cfg.def.abs = std::atof( argv[++i] );
+    }else if ( arg == "--rel" && has_value ){
+      cfg.def.rel = std::atof( argv[++i] );
+    }else if ( arg == "--tol" && has_value ){
+      if ( !parse_tolerance( argv[++i], cfg ) ){
+        std::cerr << "Invalid tolerance " << argv[i] << ". Use pattern=abs,rel" << std::endl;
+        return 2;
+      }
+    }else if ( arg == "--tree" && has_value ){
+      cfg.trees.push_back( argv[++i] );
+    }else if ( arg == "--skip" && has_value ){
+      if ( !user_skip ) cfg.skip.clear();
+      user_skip=true;
+      cfg.skip.push_back( argv[++i] );
+    }else if ( arg == "--no-hists" ){
+      cfg.hists=false;
+    }else if ( arg == "--verbose" ){
+      cfg.verbose=true;
+    }else if ( arg == "-h" || arg == "--help" ){
+      usage();
+      return 0;
+    }else if ( arg.rfind("--", 0) == 0 ){
+      std::cerr << "Unknown option " << arg << std::endl;
+      usage();
+      return 2;
+    }else{
+      files.push_back( arg );
+    }
+  }
+
+  if ( files.size() != 2 ){
+    usage();
+    return 2;
+  }
+
+  gErrorIgnoreLevel = kError;
+
+  std::unique_ptr<TFile> ref( TFile::Open( files[0].c_str(), "READ" ) );
+  std::unique_ptr<TFile> test( TFile::Open( files[1].c_str(), "READ" ) );
+  if ( !ref || ref->IsZombie() || !test || test->IsZombie() ){
+    std::cerr << "Not possible to open " << files[0] << " or " << files[1] << std::endl;
+    return 2;
+  }
+
+  std::cout << "Reference: " << files[0] << std::endl;
+  std::cout << "Test     : " << files[1] << std::endl;
+  std::cout << "Default tolerance: abs = " << cfg.def.abs << ", rel = " << cfg.def.rel << std::endl;
+
+  unsigned nhists=0, ntrees=0;
+  bool equal = compare_dir( ref.get(), test.get(), "", cfg, nhists, ntrees );
+
+  std::cout << "Compared " << ntrees << " trees and " << nhists << " histograms: "
+            << ( equal ? "EQUIVALENT" : "DIFFERENT" ) << std::endl;
+  return equal ? 0 : 1;
+}
+